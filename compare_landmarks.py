@@ -1,3 +1,4 @@
+import sys
 import numpy as np
 
 def parse_landmarks(filename):
@@ -20,12 +21,32 @@ def parse_landmarks(filename):
         frames.append(np.array(current_frame))
     return frames
 
-cpu_frames = parse_landmarks('landmarks_cpu.txt')
-gpu_frames = parse_landmarks('landmarks_gpu.txt')
+# Usage: compare_landmarks.py [reference.txt] [candidate.txt] [--size WxH] [--max-mean-px T]
+# (LANDMARK_OUTPUT_FILE dumps; defaults to landmarks_cpu.txt / landmarks_gpu.txt)
+# --size reports errors in pixels of a WxH frame instead of normalized units.
+# --max-mean-px exits with status 1 when the mean landmark error over all
+# frames exceeds T pixels (the same gate the OpenCV-DNN runtime applies to
+# its int8 landmark model).
+argv = sys.argv[1:]
+opts = {}
+for flag in ('--size', '--max-mean-px'):
+    if flag in argv:
+        i = argv.index(flag)
+        opts[flag] = argv[i + 1]
+        del argv[i:i + 2]
+scale = np.array([1.0, 1.0, 1.0])
+if '--size' in opts:
+    w, h = opts['--size'].lower().split('x')
+    scale = np.array([float(w), float(h), float(w)])
+cpu_path = argv[0] if len(argv) > 0 else 'landmarks_cpu.txt'
+gpu_path = argv[1] if len(argv) > 1 else 'landmarks_gpu.txt'
+cpu_frames = [f * scale for f in parse_landmarks(cpu_path)]
+gpu_frames = [f * scale for f in parse_landmarks(gpu_path)]
 
 print(f"Loaded {len(cpu_frames)} CPU frames and {len(gpu_frames)} GPU frames")
 
 min_frames = min(len(cpu_frames), len(gpu_frames))
+all_dist = []
 
 if len(cpu_frames) > 1 and len(gpu_frames) > 1:
     print(f"\nCPU internal tracking drift (Frame 1 vs Frame 0): {np.max(np.abs(cpu_frames[1] - cpu_frames[0])):.6f}")
@@ -34,13 +55,17 @@ if len(cpu_frames) > 1 and len(gpu_frames) > 1:
 for f in range(min_frames):
     cpu = cpu_frames[f]
     gpu = gpu_frames[f]
+    if cpu.shape != gpu.shape:
+        print(f"\nFrame {f}: skipped (landmark count {len(cpu)} vs {len(gpu)})")
+        continue
     
     diff = gpu - cpu
     rmse = np.sqrt(np.mean(diff**2))
     max_diff = np.max(np.abs(diff), axis=0)
     mean_diff = np.mean(diff, axis=0)
     
-    dist = np.sqrt(np.sum(diff**2, axis=1))
+    dist = np.sqrt(np.sum(diff[:, :2]**2, axis=1))
+    all_dist.append(dist)
     worst_indices = np.argsort(dist)[::-1][:10]
     
     print(f"\nFrame {f}:")
@@ -53,3 +78,12 @@ for f in range(min_frames):
         print("\nTop 5 Landmarks Comparison (X, Y):")
         for i in range(5):
             print(f"  L[{i}]: CPU({cpu[i,0]:.4f}, {cpu[i,1]:.4f}) vs GPU({gpu[i,0]:.4f}, {gpu[i,1]:.4f})")
+
+if all_dist:
+    d = np.concatenate(all_dist)
+    unit = 'px' if '--size' in opts else '(normalized)'
+    print(f"\nOverall over {len(all_dist)} frame(s): mean error {np.mean(d):.4f} {unit}, "
+          f"RMSE {np.sqrt(np.mean(d**2)):.4f}, max {np.max(d):.4f}")
+    if '--max-mean-px' in opts and np.mean(d) > float(opts['--max-mean-px']):
+        print(f"FAIL: mean error above {opts['--max-mean-px']}")
+        sys.exit(1)
@@ -8,7 +8,19 @@ The .task file is a ZIP containing two TFLite models:
 
 Usage:
   pip install tf2onnx tensorflow-lite flatbuffers
-  python3 convert_models.py face_landmarker.task
+  python3 convert_models.py face_landmarker.task [--dynamic-batch] [--int8 --calib DIR]
+
+--dynamic-batch makes the leading (batch) dimension symbolic so the OpenCV-DNN
+runtime can run several frames / face crops per inference (face_detect_batch).
+Needs `pip install onnx`. TensorRT still builds its engines at batch 1.
+
+--int8 also writes face_landmarks_int8.onnx, an int8-quantized landmark model
+for the OpenCV-DNN runtime (MP_OCV_LANDMARKS=int8), which checks it against
+the float model before using it. The model is fully quantized (weights and
+activations, QOperator format), calibrated on the images in DIR resized to
+256x256 (ideally face crops), so --int8 requires --calib DIR. Weight-only
+(dynamic) quantization is not offered: its ops cannot be loaded by OpenCV
+DNN. Needs `pip install onnx onnxruntime`.
 
 The ONNX files will be created in the same directory as the .task file.
 Place them alongside the .task file for the mozza_mp_gpu plugin to find.
@@ -66,12 +78,115 @@ def tflite_to_onnx(tflite_path: str, onnx_path: str) -> bool:
         return False
 
 
+def make_batch_dynamic(onnx_path: str) -> bool:
+    """Turn the fixed batch dimension of 1 into a symbolic 'N'."""
+    try:
+        import onnx
+        from onnx import numpy_helper
+    except ImportError:
+        print("  ERROR: onnx not found. Install with: pip install onnx")
+        return False
+
+    model = onnx.load(onnx_path)
+    graph = model.graph
+    for vi in list(graph.input) + list(graph.output):
+        dims = vi.type.tensor_type.shape.dim
+        if dims:
+            dims[0].ClearField("dim_value")
+            dims[0].dim_param = "N"
+
+    # tf2onnx bakes the batch into Reshape targets; 0 copies it from the input.
+    inits = {t.name: t for t in graph.initializer}
+    consts = {n.output[0]: n for n in graph.node if n.op_type == "Constant"}
+    patched = 0
+    for node in graph.node:
+        if node.op_type != "Reshape" or len(node.input) < 2:
+            continue
+        name = node.input[1]
+        if name in inits:
+            tensor = inits[name]
+        elif name in consts:
+            tensor = consts[name].attribute[0].t
+        else:
+            continue
+        shape = numpy_helper.to_array(tensor).copy()
+        if shape.ndim == 1 and len(shape) > 1 and shape[0] == 1:
+            shape[0] = 0
+            tensor.CopyFrom(numpy_helper.from_array(shape, tensor.name))
+            patched += 1
+
+    # Intermediate shapes were inferred for batch 1; let runtimes re-infer them.
+    del graph.value_info[:]
+    onnx.checker.check_model(model)
+    onnx.save(model, onnx_path)
+    print(f"  OK: dynamic batch ({patched} reshape(s) patched)")
+    return True
+
+
+def quantize_landmarks(onnx_path: str, int8_path: str, calib_dir: str) -> bool:
+    """Write a statically quantized int8 copy of the landmark model."""
+    try:
+        import numpy as np
+        import onnx
+        from onnxruntime import quantization as q
+    except ImportError:
+        print("  ERROR: onnxruntime not found. Install with: pip install onnx onnxruntime")
+        return False
+
+    try:
+        import cv2
+    except ImportError:
+        print("  ERROR: OpenCV not found. Install with: pip install opencv-python")
+        return False
+    files = sorted(os.path.join(calib_dir, f) for f in os.listdir(calib_dir)
+                   if f.lower().endswith((".png", ".jpg", ".jpeg", ".bmp")))
+    if not files:
+        print(f"  ERROR: no calibration images in {calib_dir}")
+        return False
+    input_name = onnx.load(onnx_path).graph.input[0].name
+
+    class Reader(q.CalibrationDataReader):
+        def __init__(self):
+            self.it = iter(files)
+
+        def get_next(self):
+            for path in self.it:
+                img = cv2.imread(path)
+                if img is None:
+                    continue
+                img = cv2.cvtColor(cv2.resize(img, (256, 256), interpolation=cv2.INTER_AREA),
+                                   cv2.COLOR_BGR2RGB)
+                return {input_name: (img.astype(np.float32) / 255.0)[None]}
+            return None
+
+    q.quantize_static(onnx_path, int8_path, Reader(),
+                      quant_format=q.QuantFormat.QOperator,
+                      activation_type=q.QuantType.QUInt8,
+                      weight_type=q.QuantType.QInt8,
+                      per_channel=True)
+    print(f"  OK: {int8_path} (static, {len(files)} calibration image(s))")
+    return True
+
+
 def main():
-    if len(sys.argv) < 2:
-        print(f"Usage: {sys.argv[0]} <face_landmarker.task>")
+    argv = sys.argv[1:]
+    calib_dir = None
+    if "--calib" in argv:
+        i = argv.index("--calib")
+        calib_dir = argv[i + 1] if i + 1 < len(argv) else None
+        del argv[i:i + 2]
+    args = [a for a in argv if not a.startswith("--")]
+    dynamic_batch = "--dynamic-batch" in argv
+    int8 = "--int8" in argv
+    if len(args) < 1:
+        print(f"Usage: {sys.argv[0]} <face_landmarker.task> [--dynamic-batch] [--int8 --calib DIR]")
+        sys.exit(1)
+    if int8 and not calib_dir:
+        print("ERROR: --int8 needs --calib DIR (calibration images, ideally face crops). "
+              "Weight-only (dynamic) quantization is not supported: OpenCV DNN cannot load it.")
         sys.exit(1)
 
-    task_path = sys.argv[1]
+    task_path = args[0]
     if not os.path.exists(task_path):
         print(f"ERROR: File not found: {task_path}")
         sys.exit(1)
@@ -107,6 +222,8 @@ def main():
         det_onnx = os.path.join(output_dir, "face_detector.onnx")
         if det_tflite and not tflite_to_onnx(det_tflite, det_onnx):
             print("WARNING: Detector conversion failed")
+        elif det_tflite and dynamic_batch and not make_batch_dynamic(det_onnx):
+            print("WARNING: Detector kept at batch 1")
 
         # Step 3: Convert landmarks
         print("\n[3/3] Converting face landmarks...")
@@ -126,10 +243,20 @@ def main():
         lm_onnx = os.path.join(output_dir, "face_landmarks.onnx")
         if lm_tflite and not tflite_to_onnx(lm_tflite, lm_onnx):
             print("WARNING: Landmarks conversion failed")
+        elif lm_tflite and dynamic_batch and not make_batch_dynamic(lm_onnx):
+            print("WARNING: Landmarks kept at batch 1")
+        if int8 and os.path.exists(lm_onnx):
+            print("\n[+] Quantizing face landmarks to int8...")
+            if not quantize_landmarks(lm_onnx, os.path.join(output_dir, "face_landmarks_int8.onnx"),
+                                      calib_dir):
+                print("WARNING: int8 landmark model not created")
 
     # Summary
     print("\n=== Summary ===")
-    for name in ["face_detector.onnx", "face_landmarks.onnx"]:
+    names = ["face_detector.onnx", "face_landmarks.onnx"]
+    if int8:
+        names.append("face_landmarks_int8.onnx")
+    for name in names:
         path = os.path.join(output_dir, name)
         if os.path.exists(path):
             sz = os.path.getsize(path)
@@ -1,6 +1,12 @@
 // GStreamer video filter that uses the mp_runtime C ABI via loader
-// and overlays 2D landmarks directly in RGBA.
+// and overlays 2D landmarks directly in RGBA (or on the luma plane for
+// NV12/I420, which the runtime ingests without a videoconvert).
 // Element: facelandmarks
+// The read-only "cpu-allocation" property reports this instance's share of
+// the runtime's process-wide CPU budget (API v7).
+// With "attach-meta" (default) the landmarks also travel downstream as a
+// GstMozzaLandmarksMeta, which mozza_mp uses instead of detecting again;
+// set draw=false to use the element as a pure detector.
 
 #include <gst/gst.h>
 #include <gst/video/video.h>
@@ -14,6 +20,7 @@
 
 #include "mp_runtime.h"
 #include "mp_runtime_loader.h"
+#include "mozza_landmarks_meta.h"
 
 #ifndef PACKAGE
 #define PACKAGE "facelandmarks"
@@ -36,8 +43,16 @@ struct _GstFaceLandmarks {
   gint     radius;
   guint    color_rgba; // 0xRRGGBBAA
   gint     num_threads;
+  gint     prewarm;    // synthetic inferences at start()
+  gint     prewarm_w;
+  gint     prewarm_h;
+  gfloat   detect_scale;    // ingest downscale for the detector
+  gint     detect_max_side;
+  gboolean attach_meta;     // attach GstMozzaLandmarksMeta to each buffer
 
   MpFaceCtx* mp_ctx;   // opaque runtime context
+  guint64    frames;
+  MpCpuAllocation cpu_alloc;  // last polled CPU budget share (object lock)
 };
 
 G_END_DECLS
@@ -49,15 +64,22 @@ enum {
   PROP_DRAW,
   PROP_RADIUS,
   PROP_COLOR,
-  PROP_NUM_THREADS
+  PROP_NUM_THREADS,
+  PROP_PREWARM,
+  PROP_PREWARM_W,
+  PROP_PREWARM_H,
+  PROP_DETECT_SCALE,
+  PROP_DETECT_MAX_SIDE,
+  PROP_CPU_ALLOCATION,
+  PROP_ATTACH_META
 };
 
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE(
   "sink", GST_PAD_SINK, GST_PAD_ALWAYS,
-  GST_STATIC_CAPS("video/x-raw(memory:GLMemory), format=RGBA; video/x-raw, format=RGBA"));
+  GST_STATIC_CAPS("video/x-raw(memory:GLMemory), format=RGBA; video/x-raw, format={ RGBA, NV12, I420 }"));
 static GstStaticPadTemplate src_template  = GST_STATIC_PAD_TEMPLATE(
   "src",  GST_PAD_SRC,  GST_PAD_ALWAYS,
-  GST_STATIC_CAPS("video/x-raw(memory:GLMemory), format=RGBA; video/x-raw, format=RGBA"));
+  GST_STATIC_CAPS("video/x-raw(memory:GLMemory), format=RGBA; video/x-raw, format={ RGBA, NV12, I420 }"));
 
 G_DEFINE_TYPE(GstFaceLandmarks, gst_face_landmarks, GST_TYPE_VIDEO_FILTER)
 
@@ -97,9 +119,35 @@ static void draw_dot(uint8_t* base, int W, int H, int stride, int cx, int cy,
   }
 }
 
+// YUV frames: blend the dot into luma only (BT.601 luma of the colour).
+static void draw_dot_luma(uint8_t* base, int W, int H, int stride, int cx, int cy,
+                          int radius, uint32_t rgba) {
+  if (radius < 1) radius = 1;
+  const int R = (rgba >> 24) & 0xFF;
+  const int G = (rgba >> 16) & 0xFF;
+  const int B = (rgba >>  8) & 0xFF;
+  const int A = (rgba >>  0) & 0xFF;
+  const int Y = ((66 * R + 129 * G + 25 * B + 128) >> 8) + 16;
+
+  const int x0 = std::max(0, cx - radius), x1 = std::min(W - 1, cx + radius);
+  const int y0 = std::max(0, cy - radius), y1 = std::min(H - 1, cy + radius);
+  const int r2 = radius * radius;
+
+  for (int y = y0; y <= y1; ++y) {
+    const int dy = y - cy;
+    for (int x = x0; x <= x1; ++x) {
+      const int dx = x - cx;
+      if (dx*dx + dy*dy <= r2) {
+        uint8_t* p = base + y * stride + x;
+        *p = static_cast<uint8_t>((*p * (255 - A) + Y * A) / 255);
+      }
+    }
+  }
+}
+
 static void overlay_landmarks(uint8_t* data, int W, int H, int stride,
                               const MpFaceResult& res,
-                              int radius, uint32_t rgba) {
+                              int radius, uint32_t rgba, bool luma) {
   for (int i = 0; i < res.faces_count; ++i) {
     const MpFace& face = res.faces[i];
     for (int j = 0; j < face.landmarks_count; ++j) {
@@ -107,7 +155,8 @@ static void overlay_landmarks(uint8_t* data, int W, int H, int stride,
       // assume normalized [0,1] (your runtime can document). Clamp just in case.
       const int x = std::clamp(static_cast<int>(std::lround(lm.x * W)), 0, W - 1);
       const int y = std::clamp(static_cast<int>(std::lround(lm.y * H)), 0, H - 1);
-      draw_dot(data, W, H, stride, x, y, radius, rgba);
+      if (luma) draw_dot_luma(data, W, H, stride, x, y, radius, rgba);
+      else      draw_dot(data, W, H, stride, x, y, radius, rgba);
     }
   }
 }
@@ -126,6 +175,12 @@ static void gst_face_landmarks_set_property(GObject* obj, guint prop_id,
     case PROP_RADIUS:    self->radius     = std::max(1, g_value_get_int(value)); break;
     case PROP_COLOR:     self->color_rgba = g_value_get_uint(value);             break;
     case PROP_NUM_THREADS: self->num_threads = g_value_get_int(value); break;
+    case PROP_PREWARM:   self->prewarm    = g_value_get_int(value);             break;
+    case PROP_PREWARM_W: self->prewarm_w  = g_value_get_int(value);             break;
+    case PROP_PREWARM_H: self->prewarm_h  = g_value_get_int(value);             break;
+    case PROP_DETECT_SCALE:    self->detect_scale    = g_value_get_float(value); break;
+    case PROP_DETECT_MAX_SIDE: self->detect_max_side = g_value_get_int(value);   break;
+    case PROP_ATTACH_META:     self->attach_meta     = g_value_get_boolean(value); break;
     default: G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
   }
 }
@@ -140,10 +195,41 @@ static void gst_face_landmarks_get_property(GObject* obj, guint prop_id,
     case PROP_RADIUS:     g_value_set_int    (value, self->radius);       break;
     case PROP_COLOR:      g_value_set_uint   (value, self->color_rgba);   break;
     case PROP_NUM_THREADS:g_value_set_int    (value, self->num_threads);  break;
+    case PROP_PREWARM:    g_value_set_int    (value, self->prewarm);      break;
+    case PROP_PREWARM_W:  g_value_set_int    (value, self->prewarm_w);    break;
+    case PROP_PREWARM_H:  g_value_set_int    (value, self->prewarm_h);    break;
+    case PROP_DETECT_SCALE:    g_value_set_float(value, self->detect_scale);    break;
+    case PROP_DETECT_MAX_SIDE: g_value_set_int  (value, self->detect_max_side); break;
+    case PROP_ATTACH_META:     g_value_set_boolean(value, self->attach_meta);   break;
+    case PROP_CPU_ALLOCATION: {
+      GST_OBJECT_LOCK(self);
+      const MpCpuAllocation a = self->cpu_alloc;
+      GST_OBJECT_UNLOCK(self);
+      g_value_take_string(value, g_strdup_printf(
+          "budget=%d contexts=%d inference=%d warp=%d warp-pool=%d overcommit=%d generation=%u",
+          a.budget, a.contexts, a.inference_threads, a.warp_threads, a.warp_pool, a.overcommit,
+          a.generation));
+      break;
+    }
     default: G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
   }
 }
 
+// Polls this instance's share of the runtime's CPU budget (v7).
+static void refresh_cpu_allocation(GstFaceLandmarks* self) {
+  if (!MpApiHas(7) || !MpApi().face_get_allocation) return;
+  MpCpuAllocation a{};
+  if (MpApi().face_get_allocation(self->mp_ctx, &a) != 0) return;
+  GST_OBJECT_LOCK(self);
+  const bool changed = a.generation != self->cpu_alloc.generation ||
+                       a.inference_threads != self->cpu_alloc.inference_threads;
+  self->cpu_alloc = a;
+  GST_OBJECT_UNLOCK(self);
+  if (changed)
+    GST_INFO_OBJECT(self, "CPU budget: %d cores over %d context(s); inference %d",
+                    a.budget, a.contexts, a.inference_threads);
+}
+
 // ── Lifecycle ────────────────────────────────────────────────────────────────
 static gboolean gst_face_landmarks_start(GstBaseTransform* base) {
   auto* self = GST_FACE_LANDMARKS(base);
@@ -165,12 +251,19 @@ static gboolean gst_face_landmarks_start(GstBaseTransform* base) {
   opts.with_geometry   = 0;
   opts.num_threads     = self->num_threads;
   opts.delegate        = "cpu";
+  opts.prewarm_frames  = self->prewarm;
+  opts.prewarm_width   = self->prewarm_w;
+  opts.prewarm_height  = self->prewarm_h;
+  opts.detect_scale    = self->detect_scale;
+  opts.detect_max_side = self->detect_max_side;
 
   if (MpApi().face_create(&opts, &self->mp_ctx) != 0 || !self->mp_ctx) {
     const char* loader_err = mp_runtime_loader::last_error();
     GST_FIXME_OBJECT(self, "face_create() failed: %s", loader_err ? loader_err : "unknown");
     return FALSE;
   }
+  self->frames = 0;
+  refresh_cpu_allocation(self);
   return TRUE;
 }
 
@@ -180,17 +273,36 @@ static gboolean gst_face_landmarks_stop(GstBaseTransform* base) {
     MpApi().face_close(&self->mp_ctx);   // signature is (MpFaceCtx**)
     self->mp_ctx = nullptr;
   }
+  GST_OBJECT_LOCK(self);
+  self->cpu_alloc = MpCpuAllocation{};
+  GST_OBJECT_UNLOCK(self);
   return TRUE;
 }
 
 static gboolean gst_face_landmarks_set_info(GstVideoFilter*, GstCaps*, GstVideoInfo*,
                                             GstCaps*, GstVideoInfo*) { return TRUE; }
 
+// NV12/I420 planes reach the runtime only from API v4 on; with an older
+// runtime (or none) the caps are narrowed to RGBA.
+static GstCaps* gst_face_landmarks_transform_caps(GstBaseTransform* bt, GstPadDirection dir,
+                                                  GstCaps* caps, GstCaps* filter) {
+  GstCaps* out =
+      GST_BASE_TRANSFORM_CLASS(gst_face_landmarks_parent_class)->transform_caps(bt, dir, caps, filter);
+  if (MpApiHas(4)) return out;
+  GstCaps* rgba = gst_caps_from_string(
+      "video/x-raw(memory:GLMemory), format=RGBA; video/x-raw, format=RGBA");
+  GstCaps* res = gst_caps_intersect(out, rgba);
+  gst_caps_unref(rgba);
+  gst_caps_unref(out);
+  return res;
+}
+
 // ── Per-frame work ───────────────────────────────────────────────────────────
 static GstFlowReturn gst_face_landmarks_transform_frame_ip(GstVideoFilter* vf,
                                                            GstVideoFrame* f) {
   auto* self = GST_FACE_LANDMARKS(vf);
   if (!self->mp_ctx) return GST_FLOW_OK;
+  if (++self->frames % 30 == 0) refresh_cpu_allocation(self);
 
   const int W      = GST_VIDEO_FRAME_WIDTH(f);
   const int H      = GST_VIDEO_FRAME_HEIGHT(f);
@@ -204,13 +316,31 @@ static GstFlowReturn gst_face_landmarks_transform_frame_ip(GstVideoFilter* vf,
   img.stride = stride;
   img.format = MP_IMAGE_RGBA8888;
 
+  // 4:2:0 input goes to the runtime as planes; it converts (and downscales)
+  // in one pass, so no RGBA copy of the frame is made for detection.
+  const GstVideoFormat fmt = GST_VIDEO_FRAME_FORMAT(f);
+  const bool yuv = (fmt == GST_VIDEO_FORMAT_NV12 || fmt == GST_VIDEO_FORMAT_I420);
+  if (yuv) {
+    img.format = (fmt == GST_VIDEO_FORMAT_NV12) ? MP_IMAGE_NV12 : MP_IMAGE_I420;
+    for (guint p = 0; p < GST_VIDEO_FRAME_N_PLANES(f) && p < 3; ++p) {
+      img.planes[p]  = static_cast<const uint8_t*>(GST_VIDEO_FRAME_PLANE_DATA(f, p));
+      img.strides[p] = GST_VIDEO_FRAME_PLANE_STRIDE(f, p);
+    }
+  }
+
   const GstClockTime pts = GST_BUFFER_PTS(f->buffer);
   const int64_t ts_us = (pts == GST_CLOCK_TIME_NONE) ? 0 : static_cast<int64_t>(GST_TIME_AS_USECONDS(pts));
 
   MpFaceResult out{};
   if (MpApi().face_detect(self->mp_ctx, &img, ts_us, &out) == 0) {
+    if (self->attach_meta) {
+      // One landmark set per buffer: a later detector replaces an earlier one.
+      if (GstMozzaLandmarksMeta* old = gst_buffer_get_mozza_landmarks_meta(f->buffer))
+        gst_buffer_remove_meta(f->buffer, &old->meta);
+      gst_buffer_add_mozza_landmarks_meta(f->buffer, &out, W, H);
+    }
     if (self->draw) {
-      overlay_landmarks(data, W, H, stride, out, self->radius, self->color_rgba);
+      overlay_landmarks(data, W, H, stride, out, self->radius, self->color_rgba, yuv);
     }
     MpApi().face_free_result(&out);   // note: face_free_result (name matches loader)
   } else {
@@ -260,6 +390,42 @@ static void gst_face_landmarks_class_init(GstFaceLandmarksClass* klass) {
       g_param_spec_int("threads", "Number of threads",
                        "Number of CPU threads for MediaPipe (0=default)",
                        0, 32, 4, G_PARAM_READWRITE));
+  g_object_class_install_property(
+      gobject_class, PROP_PREWARM,
+      g_param_spec_int("prewarm", "Prewarm frames",
+                       "Synthetic inferences run at start() to avoid a first-frame stall (0=off)",
+                       0, 16, 0, G_PARAM_READWRITE));
+  g_object_class_install_property(
+      gobject_class, PROP_PREWARM_W,
+      g_param_spec_int("prewarm-width", "Prewarm width",
+                       "Width of the synthetic prewarm frame",
+                       16, 7680, 1280, G_PARAM_READWRITE));
+  g_object_class_install_property(
+      gobject_class, PROP_PREWARM_H,
+      g_param_spec_int("prewarm-height", "Prewarm height",
+                       "Height of the synthetic prewarm frame",
+                       16, 4320, 720, G_PARAM_READWRITE));
+  g_object_class_install_property(
+      gobject_class, PROP_DETECT_SCALE,
+      g_param_spec_float("detect-scale", "Detection input scale",
+                         "Downscale frames by this factor before detection (landmarks stay full-frame)",
+                         0.05f, 1.f, 1.f, G_PARAM_READWRITE));
+  g_object_class_install_property(
+      gobject_class, PROP_DETECT_MAX_SIDE,
+      g_param_spec_int("detect-max-side", "Detection max side",
+                       "Cap the longest side fed to detection in pixels (0=off)",
+                       0, 8192, 0, G_PARAM_READWRITE));
+  g_object_class_install_property(
+      gobject_class, PROP_CPU_ALLOCATION,
+      g_param_spec_string("cpu-allocation", "CPU allocation",
+                          "This instance's share of the process CPU budget (read-only)",
+                          "", G_PARAM_READABLE));
+  g_object_class_install_property(
+      gobject_class, PROP_ATTACH_META,
+      g_param_spec_boolean("attach-meta", "Attach landmarks meta",
+                           "Attach the landmarks to each buffer (GstMozzaLandmarksMeta) for "
+                           "downstream mozza_mp instances",
+                           TRUE, G_PARAM_READWRITE));
 
   gst_element_class_set_static_metadata(GST_ELEMENT_CLASS(klass),
       "Face Landmarks (mp_runtime)", "Filter/Effect/Video",
@@ -273,6 +439,7 @@ static void gst_face_landmarks_class_init(GstFaceLandmarksClass* klass) {
 
   basetr_class->start = gst_face_landmarks_start;
   basetr_class->stop  = gst_face_landmarks_stop;
+  basetr_class->transform_caps = gst_face_landmarks_transform_caps;
 
   vfilter_class->set_info           = gst_face_landmarks_set_info;
   vfilter_class->transform_frame_ip = gst_face_landmarks_transform_frame_ip;
@@ -285,7 +452,15 @@ static void gst_face_landmarks_init(GstFaceLandmarks* self) {
   self->radius     = 2;
   self->color_rgba = 0x00FF00FFu;
   self->num_threads = 4;
+  self->prewarm    = 0;
+  self->prewarm_w  = 1280;
+  self->prewarm_h  = 720;
+  self->detect_scale    = 1.0f;
+  self->detect_max_side = 0;
+  self->attach_meta     = TRUE;
   self->mp_ctx     = nullptr;
+  self->frames     = 0;
+  self->cpu_alloc  = MpCpuAllocation{};
 }
 
 static void gst_face_landmarks_finalize(GObject* object) {
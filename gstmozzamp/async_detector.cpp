@@ -0,0 +1,106 @@
+// gstmozzamp/async_detector.cpp
+#include "async_detector.hpp"
+
+#include <chrono>
+
+#include "mp_runtime_loader.h"
+#include "mozza_landmarks_meta.h"
+
+AsyncDetector::AsyncDetector(DetectFn detect, std::function<void()> thread_init)
+    : detect_(std::move(detect)), thread_init_(std::move(thread_init)) {
+  gst_video_info_init(&info_);
+  worker_ = std::thread([this] { run(); });
+}
+
+AsyncDetector::~AsyncDetector() {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  if (worker_.joinable()) worker_.join();
+  if (frame_) gst_buffer_unref(frame_);
+  if (latest_.landmarks) gst_buffer_unref(latest_.landmarks);
+}
+
+bool AsyncDetector::offer(const GstVideoFrame* f, int64_t ts_us, guint64 frame) {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (busy_ || stop_) return false;
+    busy_ = true;  // the worker does not touch frame_ until pending_ is set
+  }
+  if (!frame_ || !gst_video_info_is_equal(&info_, &f->info)) {
+    if (frame_) gst_buffer_unref(frame_);
+    info_ = f->info;
+    frame_ = gst_buffer_new_allocate(nullptr, GST_VIDEO_INFO_SIZE(&info_), nullptr);
+  }
+  GstVideoFrame dst;
+  bool copied = frame_ && gst_video_frame_map(&dst, &info_, frame_, GST_MAP_WRITE);
+  if (copied) {
+    copied = gst_video_frame_copy(&dst, f);
+    gst_video_frame_unmap(&dst);
+  }
+
+  std::lock_guard<std::mutex> lock(mu_);
+  if (!copied) {
+    busy_ = false;
+    return false;
+  }
+  frame_ts_us_ = ts_us;
+  frame_index_ = frame;
+  pending_ = true;
+  cv_.notify_all();
+  return true;
+}
+
+bool AsyncDetector::latest(Latest* out) {
+  std::lock_guard<std::mutex> lock(mu_);
+  if (!have_latest_) return false;
+  *out = latest_;
+  if (out->landmarks) gst_buffer_ref(out->landmarks);
+  return true;
+}
+
+void AsyncDetector::take_timing(double* mean_ms, double* p99_ms, double* max_ms, size_t* runs) {
+  std::lock_guard<std::mutex> lock(mu_);
+  *runs = timing_.size();
+  timing_.take(mean_ms, p99_ms, max_ms);
+}
+
+void AsyncDetector::run() {
+  if (thread_init_) thread_init_();
+  std::unique_lock<std::mutex> lk(mu_);
+  for (;;) {
+    cv_.wait(lk, [this] { return stop_ || pending_; });
+    if (stop_) return;
+    pending_ = false;
+    const int64_t ts_us = frame_ts_us_;
+    const guint64 index = frame_index_;
+    lk.unlock();
+
+    const auto t0 = std::chrono::steady_clock::now();
+    GstBuffer* landmarks = nullptr;
+    GstVideoFrame f;
+    if (gst_video_frame_map(&f, &info_, frame_, GST_MAP_READ)) {
+      MpFaceResult out{};
+      if (detect_(&f, ts_us, &out) == 0) {
+        landmarks = gst_buffer_new();
+        gst_buffer_add_mozza_landmarks_meta(landmarks, &out, GST_VIDEO_INFO_WIDTH(&info_),
+                                            GST_VIDEO_INFO_HEIGHT(&info_));
+        MpApi().face_free_result(&out);
+      }
+      gst_video_frame_unmap(&f);
+    }
+    const double us = (double)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - t0).count();
+
+    lk.lock();
+    if (latest_.landmarks) gst_buffer_unref(latest_.landmarks);
+    latest_.landmarks = landmarks;
+    latest_.frame = index;
+    latest_.ts_us = ts_us;
+    have_latest_ = true;
+    timing_.add(us);
+    busy_ = false;
+  }
+}
@@ -0,0 +1,71 @@
+// gstmozzamp/async_detector.hpp
+// Detection off the streaming thread, for mozza_detect async-detect=true.
+//
+// One worker thread detects on frames handed over with offer(). A frame is
+// only taken while the worker is idle, so the worker always starts on the
+// newest frame and the streaming thread copies at most one frame per
+// detection. The streaming thread never waits for a result: it attaches
+// whatever latest() holds, which lags the current frame by the detection time.
+#pragma once
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "mp_runtime.h"
+#include "timing_window.hpp"
+
+class AsyncDetector {
+ public:
+  // Same contract as MpRuntimeApi::face_detect; runs on the worker.
+  using DetectFn = std::function<int(const GstVideoFrame*, int64_t ts_us, MpFaceResult* out)>;
+
+  // thread_init runs first on the worker (thread placement).
+  AsyncDetector(DetectFn detect, std::function<void()> thread_init);
+  ~AsyncDetector();  // joins the worker; a detection in flight is finished first
+  AsyncDetector(const AsyncDetector&) = delete;
+  AsyncDetector& operator=(const AsyncDetector&) = delete;
+
+  // Copies f for the worker if it is idle; returns false (and copies
+  // nothing) while it is still busy with an earlier frame.
+  bool offer(const GstVideoFrame* f, int64_t ts_us, guint64 frame);
+
+  struct Latest {
+    GstBuffer* landmarks = nullptr;  // carries a GstMozzaLandmarksMeta; nullptr = none
+    guint64 frame = 0;               // frame index it was detected on
+    int64_t ts_us = 0;               // detector timestamp of that frame
+  };
+  // Latest finished detection; false before the first one. A failed
+  // detection is reported with landmarks == nullptr. The caller owns the
+  // returned buffer reference.
+  bool latest(Latest* out);
+
+  // Detection time on the worker over the window, in ms; starts a new window.
+  void take_timing(double* mean_ms, double* p99_ms, double* max_ms, size_t* runs);
+
+ private:
+  void run();
+
+  DetectFn detect_;
+  std::function<void()> thread_init_;
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  bool stop_ = false;
+  bool busy_ = false;       // a frame is being copied in or detected
+  bool pending_ = false;    // frame_ holds a frame the worker has not taken
+  GstBuffer* frame_ = nullptr;  // reused between detections
+  GstVideoInfo info_{};
+  int64_t frame_ts_us_ = 0;
+  guint64 frame_index_ = 0;
+  bool have_latest_ = false;
+  Latest latest_;
+  TimingWindow timing_;
+  std::thread worker_;
+};
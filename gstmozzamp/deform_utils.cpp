@@ -4,56 +4,67 @@
 #include <cmath>
 
 
-// --- dfm → control groups --------------------------------------------------
+// --- dfm plan → control points ----------------------------------------------
+
+// Row r's weighted targets are summed: one file gives cur + alpha*(T - cur),
+// several add their moves.
+static inline void eval_row(const DfmPlan& p, size_t r, const cv::Point2f* L, float alpha,
+                            cv::Point2f& src, cv::Point2f& dst) {
+  const cv::Point2f cur = L[p.idx[r]];
+  cv::Point2f T(0.f, 0.f);
+  for (int k = p.term_begin[r]; k < p.term_begin[r + 1]; ++k)
+    T += p.a[k] * L[p.t0[k]] + p.b[k] * L[p.t1[k]] + p.c[k] * L[p.t2[k]];
+  src = cur;
+  dst = cur + alpha * (T - p.w[r] * cur);
+}
 
-static inline bool valid_idx(int i, int n) { return i >= 0 && i < n; }
+static inline bool row_fits(const DfmPlan& p, int r, int N) {
+  if (p.idx[r] >= N) return false;
+  for (int k = p.term_begin[r]; k < p.term_begin[r + 1]; ++k)
+    if (p.t0[k] >= N || p.t1[k] >= N || p.t2[k] >= N) return false;
+  return true;
+}
 
-void build_groups_from_dfm(const Deformations& dfm,
-                           const std::vector<cv::Point2f>& L, float alpha,
-                           std::vector<std::vector<cv::Point2f>>& srcGroups,
-                           std::vector<std::vector<cv::Point2f>>& dstGroups)
+void eval_dfm_plan(const DfmPlan& plan, const std::vector<cv::Point2f>& L, float alpha,
+                   DfmPoints& out)
 {
-  int gmax = -1; for (auto& e : dfm.entries) gmax = std::max(gmax, e.group);
-  srcGroups.assign(gmax + 1, {}); dstGroups.assign(gmax + 1, {});
+  const size_t n = plan.size();
+  out.src.resize(n);
+  out.dst.resize(n);
+
+  // The plan was validated at load: only its largest index is checked here.
+  if ((int)L.size() >= plan.min_landmarks) {
+    out.group_begin.assign(plan.group_begin.begin(), plan.group_begin.end());
+    for (size_t i = 0; i < n; ++i) eval_row(plan, i, L.data(), alpha, out.src[i], out.dst[i]);
+    return;
+  }
 
   const int N = (int)L.size();
-
-  for (auto& e : dfm.entries) {
-    // must have a valid control point AND all three anchors
-    if (!valid_idx(e.idx, N) ||
-        !valid_idx(e.t0, N) || !valid_idx(e.t1, N) || !valid_idx(e.t2, N)) {
-      // optional: log once per frame or behind a flag
-      // GST_WARNING_OBJECT(self, "DFM: skipping row (idx=%d,t0=%d,t1=%d,t2=%d) for N=%d",
-      //                    e.idx, e.t0, e.t1, e.t2, N);
-      continue;
+  size_t k = 0;
+  out.group_begin.clear();
+  for (size_t g = 0; g < plan.groups(); ++g) {
+    const size_t start = k;
+    for (int i = plan.group_begin[g]; i < plan.group_begin[g + 1]; ++i) {
+      if (!row_fits(plan, i, N)) continue;
+      eval_row(plan, i, L.data(), alpha, out.src[k], out.dst[k]);
+      ++k;
     }
-
-    const cv::Point2f cur = L[e.idx];
-    const cv::Point2f T   = e.a * L[e.t0] + e.b * L[e.t1] + e.c * L[e.t2];
-
-    const cv::Point2f dst = cur + alpha * (T - cur);
-    srcGroups[e.group].push_back(cur);
-    dstGroups[e.group].push_back(dst);
+    if (k > start) out.group_begin.push_back((int)start);
   }
-
-  // compact groups
-  std::vector<std::vector<cv::Point2f>> s2, d2;
-  for (auto& g : srcGroups) if (!g.empty()) s2.emplace_back(std::move(g));
-  for (auto& g : dstGroups) if (!g.empty()) d2.emplace_back(std::move(g));
-  srcGroups.swap(s2); dstGroups.swap(d2);
+  if (k > 0) out.group_begin.push_back((int)k);
+  out.src.resize(k);
+  out.dst.resize(k);
 }
 
-// --- per-group ROI MLS -------------------------------------------------------
-
 // --- per-group ROI MLS -------------------------------------------------------
 // deform_utils.cpp
-static cv::Rect tight_bounds_union(const std::vector<cv::Point2f>& a,
-                                   const std::vector<cv::Point2f>& b,
+static cv::Rect tight_bounds_union(const cv::Point2f* a, const cv::Point2f* b, size_t n,
                                    int W, int H, int pad) {
-  auto bounds = [&](const std::vector<cv::Point2f>& pts)->cv::Rect {
-    if (pts.empty()) return cv::Rect();
+  auto bounds = [&](const cv::Point2f* pts)->cv::Rect {
+    if (n == 0) return cv::Rect();
     float xmin=1e9f,ymin=1e9f,xmax=-1e9f,ymax=-1e9f;
-    for (auto& p: pts) { xmin=std::min(xmin,p.x); ymin=std::min(ymin,p.y);
+    for (size_t i=0;i<n;++i) { const cv::Point2f& p = pts[i];
+                         xmin=std::min(xmin,p.x); ymin=std::min(ymin,p.y);
                          xmax=std::max(xmax,p.x); ymax=std::max(ymax,p.y); }
     int x = std::max(0, (int)std::floor(xmin) - pad);
     int y = std::max(0, (int)std::floor(ymin) - pad);
@@ -67,14 +78,13 @@ static cv::Rect tight_bounds_union(const std::vector<cv::Point2f>& a,
 }
 
 void compute_MLS_on_ROI(cv::Mat& imgRGBA, mp_imgwarp::ImgWarp_MLS_Rigid& mls,
-                        const std::vector<cv::Point2f>& src,
-                        const std::vector<cv::Point2f>& dst,
-                        int pad)
+                        const cv::Point2f* src, const cv::Point2f* dst, size_t n,
+                        int pad, std::vector<cv::Point2f>& sL, std::vector<cv::Point2f>& dL)
 {
-  if (src.empty() || src.size()!=dst.size()) return;
+  if (n == 0) return;
 
   // ROI = union of before/after + pad
-  cv::Rect roi = tight_bounds_union(src, dst, imgRGBA.cols, imgRGBA.rows, pad);
+  cv::Rect roi = tight_bounds_union(src, dst, n, imgRGBA.cols, imgRGBA.rows, pad);
   if (roi.width <= 1 || roi.height <= 1) return;
 
   // Enforce a minimum patch so MLS has room to bend without visible seams
@@ -85,14 +95,13 @@ void compute_MLS_on_ROI(cv::Mat& imgRGBA, mp_imgwarp::ImgWarp_MLS_Rigid& mls,
   roi &= cv::Rect(0,0,imgRGBA.cols,imgRGBA.rows);
   if (roi.empty()) return;
 
-  std::vector<cv::Point2f> sL, dL;
-  sL.reserve(src.size() + 64);
-  dL.reserve(dst.size() + 64);
+  sL.clear();
+  dL.clear();
 
   // We need to know what ratio the internal MLS used
   // (Assuming ratio logic inside ImgWarp_MLS_Rigid is consistent)
   
-  for (size_t i=0;i<src.size();++i) {
+  for (size_t i=0;i<n;++i) {
     sL.emplace_back(src[i].x - roi.x, src[i].y - roi.y);
     dL.emplace_back(dst[i].x - roi.x, dst[i].y - roi.y);
   }
@@ -115,4 +124,41 @@ void compute_MLS_on_ROI(cv::Mat& imgRGBA, mp_imgwarp::ImgWarp_MLS_Rigid& mls,
   cv::Mat patch = imgRGBA(roi).clone();
   cv::Mat warped = mls.setAllAndGenerate(patch, sL, dL, patch.cols, patch.rows);
   if (!warped.empty()) warped.copyTo(imgRGBA(roi));
-}
\ No newline at end of file
+}
+// --- whole-face warp --------------------------------------------------------
+
+static void add_identity_anchors(const cv::Rect& roi, std::vector<cv::Point2f>& src,
+                                 std::vector<cv::Point2f>& dst, int inset = 2)
+{
+  if (roi.width <= 0 || roi.height <= 0) return;
+  const float x0 = (float)(roi.x + inset);
+  const float y0 = (float)(roi.y + inset);
+  const float x1 = (float)(roi.x + roi.width  - 1 - inset);
+  const float y1 = (float)(roi.y + roi.height - 1 - inset);
+  const cv::Point2f corners[4] = { {x0, y0}, {x1, y0}, {x1, y1}, {x0, y1} };
+  for (int i = 0; i < 4; ++i) { src.push_back(corners[i]); dst.push_back(corners[i]); }
+}
+
+bool warp_face_mls(cv::Mat& imgRGBA, mp_imgwarp::ImgWarp_MLS_Rigid& mls,
+                   const DfmPlan& plan, const std::vector<cv::Point2f>& L,
+                   float alpha, bool per_group_roi, int roi_pad, DfmPoints& pts)
+{
+  eval_dfm_plan(plan, L, alpha, pts);
+  if (pts.groups() == 0) return false;
+
+  if (per_group_roi) {
+    for (size_t g = 0; g < pts.groups(); ++g) {
+      const int b = pts.group_begin[g];
+      compute_MLS_on_ROI(imgRGBA, mls, &pts.src[b], &pts.dst[b], pts.group_begin[g + 1] - b,
+                         roi_pad, pts.roi_src, pts.roi_dst);
+    }
+    return false;
+  }
+
+  // The groups are already contiguous; the anchors go after them.
+  add_identity_anchors(cv::Rect(0, 0, imgRGBA.cols, imgRGBA.rows), pts.src, pts.dst, 2);
+  cv::Mat warped = mls.setAllAndGenerate(imgRGBA, pts.src, pts.dst, imgRGBA.cols, imgRGBA.rows);
+  if (warped.empty()) return false;
+  warped.copyTo(imgRGBA);
+  return true;
+}
@@ -5,15 +5,35 @@
 #include "dfm.hpp"
 #include "imgwarp/imgwarp_mls_rigid.h"
 
-// Build per-group src/dst point sets according to DFM rules
-void build_groups_from_dfm(const Deformations& dfm,
-                           const std::vector<cv::Point2f>& L, float alpha,
-                           std::vector<std::vector<cv::Point2f>>& srcGroups,
-                           std::vector<std::vector<cv::Point2f>>& dstGroups);
+// Control points of one face, kept between frames: once the buffers have
+// grown, evaluating a plan allocates nothing. Group g is rows
+// [group_begin[g], group_begin[g+1]) of src/dst.
+struct DfmPoints {
+  std::vector<cv::Point2f> src, dst;
+  std::vector<int> group_begin;
+  std::vector<cv::Point2f> roi_src, roi_dst;  // compute_MLS_on_ROI scratch
 
-// Apply MLS on a local ROI (in-place on RGBA frame)
+  size_t size() const { return group_begin.empty() ? 0 : (size_t)group_begin.back(); }
+  size_t groups() const { return group_begin.empty() ? 0 : group_begin.size() - 1; }
+};
+
+// Evaluate the plan on landmarks L (pixels): src = L[idx], dst moves it by
+// alpha towards its barycentric target. When L is shorter than the plan
+// needs, the rows out of range are skipped and emptied groups dropped.
+void eval_dfm_plan(const DfmPlan& plan, const std::vector<cv::Point2f>& L, float alpha,
+                   DfmPoints& out);
+
+// Apply MLS on a local ROI (in-place on RGBA frame); sL/dL are scratch.
 void compute_MLS_on_ROI(cv::Mat& imgRGBA, mp_imgwarp::ImgWarp_MLS_Rigid& mls,
-                        const std::vector<cv::Point2f>& src,
-                        const std::vector<cv::Point2f>& dst,
-                        int pad);
+                        const cv::Point2f* src, const cv::Point2f* dst, size_t n,
+                        int pad, std::vector<cv::Point2f>& sL, std::vector<cv::Point2f>& dL);
+
 
+// Warp one face in place from its landmarks L (pixels): a single MLS over the
+// whole frame (corners pinned) or, with per_group_roi, one MLS per DFM group.
+// pts holds the control points between calls.
+// Returns true when a whole-frame field was computed: mls keeps it, and
+// mls.genNewImg() applies it again to another frame of the same size.
+bool warp_face_mls(cv::Mat& imgRGBA, mp_imgwarp::ImgWarp_MLS_Rigid& mls,
+                   const DfmPlan& plan, const std::vector<cv::Point2f>& L,
+                   float alpha, bool per_group_roi, int roi_pad, DfmPoints& pts);
@@ -4,6 +4,7 @@
 #include <sstream>
 #include <string>
 #include <algorithm>
+#include <cstdlib>
 
 static inline void trim(std::string& s) {
   auto wsfront = std::find_if_not(s.begin(), s.end(), [](int c){return std::isspace(c);});
@@ -12,11 +13,51 @@ static inline void trim(std::string& s) {
   s = std::string(wsfront, wsback);
 }
 
-std::optional<Deformations> load_dfm(const std::string& path) {
+DfmPlan compile_dfm(const std::vector<DfmEntry>& entries) {
+  std::vector<const DfmEntry*> rows;
+  rows.reserve(entries.size());
+  for (auto& e : entries)
+    if (e.group >= 0 && e.idx >= 0 && e.t0 >= 0 && e.t1 >= 0 && e.t2 >= 0) rows.push_back(&e);
+  std::stable_sort(rows.begin(), rows.end(),
+                   [](const DfmEntry* l, const DfmEntry* r) { return l->group < r->group; });
+
+  // Entries moving the same landmark in the same group share one row.
+  std::vector<std::vector<const DfmEntry*>> merged;
+  size_t group_start = 0;
+  for (const DfmEntry* e : rows) {
+    if (merged.empty() || e->group != merged.back().front()->group) group_start = merged.size();
+    size_t r = group_start;
+    while (r < merged.size() && merged[r].front()->idx != e->idx) ++r;
+    if (r == merged.size()) merged.emplace_back();
+    merged[r].push_back(e);
+  }
+
+  DfmPlan p;
+  for (size_t r = 0; r < merged.size(); ++r) {
+    const DfmEntry& first = *merged[r].front();
+    if (r == 0 || first.group != merged[r - 1].front()->group) p.group_begin.push_back((int)r);
+    p.idx.push_back(first.idx);
+    p.term_begin.push_back((int)p.t0.size());
+    float w = 0.f;
+    for (const DfmEntry* e : merged[r]) {
+      p.t0.push_back(e->t0); p.t1.push_back(e->t1); p.t2.push_back(e->t2);
+      p.a.push_back(e->w * e->a); p.b.push_back(e->w * e->b); p.c.push_back(e->w * e->c);
+      w += e->w;
+      p.min_landmarks = std::max({p.min_landmarks, e->idx + 1, e->t0 + 1, e->t1 + 1, e->t2 + 1});
+    }
+    p.w.push_back(w);
+  }
+  if (!merged.empty()) {
+    p.group_begin.push_back((int)merged.size());
+    p.term_begin.push_back((int)p.t0.size());
+  }
+  return p;
+}
+
+static bool read_dfm_file(const std::string& path, float w, std::vector<DfmEntry>& out) {
   std::ifstream f(path);
-  if (!f) return std::nullopt;
+  if (!f) return false;
 
-  Deformations d;
   std::string line;
   while (std::getline(f, line)) {
     // drop BOM / CR / comments
@@ -33,8 +74,36 @@ std::optional<Deformations> load_dfm(const std::string& path) {
     if ( (ss >> e.group >> c >> e.idx >> c
             >> e.t0 >> c >> e.t1 >> c >> e.t2 >> c
             >> e.a  >> c >> e.b  >> c >> e.c) ) {
-      d.entries.push_back(e);
+      e.w = w;
+      out.push_back(e);
+    }
+  }
+  return true;
+}
+
+std::optional<Deformations> load_dfm(const std::string& spec) {
+  Deformations d;
+  std::stringstream list(spec);
+  std::string item;
+  int files = 0;
+  while (std::getline(list, item, ',')) {
+    trim(item);
+    if (item.empty()) continue;
+    float w = 1.f;
+    const auto at = item.rfind('@');
+    if (at != std::string::npos && at + 1 < item.size()) {
+      char* end = nullptr;
+      const float v = std::strtof(item.c_str() + at + 1, &end);
+      if (*end == '\0') {
+        w = v;
+        item.resize(at);
+        trim(item);
+      }
     }
+    if (!read_dfm_file(item, w, d.entries)) return std::nullopt;
+    ++files;
   }
+  if (files == 0) return std::nullopt;
+  d.plan = compile_dfm(d.entries);
   return d;
 }
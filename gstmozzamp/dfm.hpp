@@ -9,10 +9,37 @@ struct DfmEntry {
   int   idx;          // landmark index to move (MediaPipe index)
   int   t0, t1, t2;   // triangle indices
   float a, b, c;      // barycentric weights
+  float w = 1.f;      // weight of the file it came from (deform=file@w)
+};
+
+// The entries compiled for per-frame evaluation: rows with a negative id
+// dropped, and the entries that move the same landmark in the same group
+// (from several files) merged into one row that blends their targets. Rows
+// are sorted by group; non-empty groups are numbered 0..groups()-1 in
+// group-id order, group g covering rows [group_begin[g], group_begin[g+1]).
+// Row r sums the terms [term_begin[r], term_begin[r+1]), whose a/b/c carry
+// the file weight: target = sum(a*L[t0] + b*L[t1] + c*L[t2]) - w*L[idx].
+struct DfmPlan {
+  std::vector<int>   idx;           // per row
+  std::vector<float> w;             // per row, sum of its entries' weights
+  std::vector<int>   term_begin;    // size() + 1 offsets
+  std::vector<int>   t0, t1, t2;    // per term
+  std::vector<float> a, b, c;       // per term
+  std::vector<int>   group_begin;   // groups() + 1 offsets
+  int min_landmarks = 0;            // every row is valid for at least this many landmarks
+
+  size_t size() const { return idx.size(); }
+  size_t groups() const { return group_begin.empty() ? 0 : group_begin.size() - 1; }
 };
 
 struct Deformations {
-  std::vector<DfmEntry> entries;
+  std::vector<DfmEntry> entries;    // every file, in order
+  DfmPlan plan;                     // compiled from entries by load_dfm
 };
 
-std::optional<Deformations> load_dfm(const std::string& path);
\ No newline at end of file
+DfmPlan compile_dfm(const std::vector<DfmEntry>& entries);
+
+// spec is one .dfm path or a comma-separated list of them, each with an
+// optional "@weight" (default 1), e.g. "jaw.dfm@0.8,eyes.dfm". Fails when
+// any file cannot be read.
+std::optional<Deformations> load_dfm(const std::string& spec);
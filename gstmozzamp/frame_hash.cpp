@@ -0,0 +1,116 @@
+// gstmozzamp/frame_hash.cpp
+#include "frame_hash.hpp"
+
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+constexpr uint64_t kPrime32_1 = 0x9E3779B1ULL;
+constexpr uint64_t kPrime64_1 = 0x9E3779B185EBCA87ULL;
+
+// Stripe keys (words 0..7), scramble keys (2..9) and merge keys (4..11).
+alignas(16) constexpr uint64_t kKey[12] = {
+    0x3FBD7FE98C8090F0ULL, 0x44C8BDCE7AF262C4ULL, 0xED50316723872DFDULL,
+    0xCBD7F6076B56BB75ULL, 0x7BD1B518AF6DC573ULL, 0xB1154A4ABE3F42D6ULL,
+    0x1FFF2C8DBC497376ULL, 0x77B2C34E8EBB4A05ULL, 0x054AC0764A56551FULL,
+    0x0B575D374CD9CD7AULL, 0x24334A4F220BFC50ULL, 0x0D6D188D0D6246CFULL,
+};
+
+constexpr size_t kStripe = 64;
+
+inline uint64_t read64(const uint8_t* p) {
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+// acc[i] += lo32(d ^ k) * hi32(d ^ k), acc[i ^ 1] += d, for one stripe.
+inline void accumulate_stripe(uint64_t* acc, const uint8_t* p) {
+#if defined(__SSE2__)
+  for (int i = 0; i < 8; i += 2) {
+    const __m128i d  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 8 * i));
+    const __m128i dk = _mm_xor_si128(d, _mm_load_si128(reinterpret_cast<const __m128i*>(kKey + i)));
+    const __m128i prod = _mm_mul_epu32(dk, _mm_shuffle_epi32(dk, _MM_SHUFFLE(0, 3, 0, 1)));
+    const __m128i swap = _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+    __m128i* a = reinterpret_cast<__m128i*>(acc + i);
+    _mm_store_si128(a, _mm_add_epi64(_mm_load_si128(a), _mm_add_epi64(prod, swap)));
+  }
+#elif defined(__ARM_NEON)
+  for (int i = 0; i < 8; i += 2) {
+    const uint64x2_t d  = vreinterpretq_u64_u8(vld1q_u8(p + 8 * i));
+    const uint64x2_t dk = veorq_u64(d, vld1q_u64(kKey + i));
+    const uint64x2_t prod = vmull_u32(vmovn_u64(dk), vshrn_n_u64(dk, 32));
+    vst1q_u64(acc + i, vaddq_u64(vld1q_u64(acc + i), vaddq_u64(prod, vextq_u64(d, d, 1))));
+  }
+#else
+  for (int i = 0; i < 8; ++i) {
+    const uint64_t d = read64(p + 8 * i), dk = d ^ kKey[i];
+    acc[i ^ 1] += d;
+    acc[i] += (dk & 0xFFFFFFFFULL) * (dk >> 32);
+  }
+#endif
+}
+
+inline void scramble(uint64_t* acc) {
+  for (int i = 0; i < 8; ++i) {
+    uint64_t a = acc[i];
+    a ^= a >> 47;
+    a ^= kKey[i + 2];
+    acc[i] = a * kPrime32_1;
+  }
+}
+
+inline uint64_t mul_fold64(uint64_t a, uint64_t b) {
+  const unsigned __int128 p = static_cast<unsigned __int128>(a) * b;
+  return static_cast<uint64_t>(p) ^ static_cast<uint64_t>(p >> 64);
+}
+
+}  // namespace
+
+uint64_t hash_rows(const uint8_t* data, size_t stride, size_t row_bytes, int rows,
+                   uint64_t seed) {
+  alignas(16) uint64_t acc[8];
+  for (int i = 0; i < 8; ++i) acc[i] = seed + kKey[i] * (i + 1);
+
+  alignas(16) uint8_t tail[kStripe];
+  for (int y = 0; y < rows; ++y) {
+    const uint8_t* p = data + (size_t)y * stride;
+    size_t i = 0;
+    for (; i + kStripe <= row_bytes; i += kStripe) accumulate_stripe(acc, p + i);
+    if (i < row_bytes) {
+      // The rest of the row, zero-padded; the row length is in the merge.
+      std::memset(tail, 0, sizeof(tail));
+      std::memcpy(tail, p + i, row_bytes - i);
+      accumulate_stripe(acc, tail);
+    }
+    scramble(acc);
+  }
+
+  uint64_t h = ((uint64_t)row_bytes * kPrime64_1) ^ (uint64_t)rows;
+  for (int i = 0; i < 8; i += 2) h += mul_fold64(acc[i] ^ kKey[i + 4], acc[i + 1] ^ kKey[i + 5]);
+  // XXH3 avalanche
+  h ^= h >> 37;
+  h *= 0x165667919E3779F9ULL;
+  h ^= h >> 32;
+  return h;
+}
+
+uint64_t hash_video_frame(const GstVideoFrame* f) {
+  uint64_t h = ((uint64_t)GST_VIDEO_FRAME_FORMAT(f) << 48) ^
+               ((uint64_t)GST_VIDEO_FRAME_WIDTH(f) << 24) ^ (uint64_t)GST_VIDEO_FRAME_HEIGHT(f);
+  // In RGBA, NV12 and I420, plane p starts with component p.
+  for (guint p = 0; p < GST_VIDEO_FRAME_N_PLANES(f); ++p) {
+    const size_t row_bytes =
+        (size_t)GST_VIDEO_FRAME_COMP_WIDTH(f, p) * GST_VIDEO_FRAME_COMP_PSTRIDE(f, p);
+    h = hash_rows(static_cast<const uint8_t*>(GST_VIDEO_FRAME_PLANE_DATA(f, p)),
+                  GST_VIDEO_FRAME_PLANE_STRIDE(f, p), row_bytes,
+                  GST_VIDEO_FRAME_COMP_HEIGHT(f, p), h);
+  }
+  return h ? h : 1;
+}
@@ -0,0 +1,28 @@
+// gstmozzamp/frame_hash.hpp
+// Cheap 64-bit fingerprint of a video frame, used by skip-duplicates to spot
+// byte-identical repeats (slides, imagefreeze, frames repeated after packet
+// loss).
+//
+// Every row of every plane is hashed in full, XXH3-style: eight 64-bit lanes
+// take 64-byte stripes (keyed 32x32->64 multiplies plus the raw words, two
+// lanes per SSE2/NEON op) and are scrambled at the end of each row, so the
+// loop runs at memory bandwidth. It is a fingerprint, not XXH3-compatible
+// output. No row is skipped: mozza_warp re-emits its previous pixels when
+// the hash matches, so a change anywhere in the frame must show.
+//
+// mozza_detect hashes each frame once and stores it on the landmarks meta
+// (frame_hash); mozza_warp uses that instead of hashing again.
+
+#pragma once
+
+#include <gst/video/video.h>
+
+#include <cstddef>
+#include <cstdint>
+
+uint64_t hash_rows(const uint8_t* data, size_t stride, size_t row_bytes, int rows,
+                   uint64_t seed);
+
+// Hashes the visible pixels of all planes of f (RGBA, NV12, I420), seeded
+// with its format and size. Never 0, which the meta uses for "not hashed".
+uint64_t hash_video_frame(const GstVideoFrame* f);
@@ -0,0 +1,1201 @@
+// Face landmark detection through the flat C runtime; the result travels on
+// the buffer as GstMozzaLandmarksMeta. In-place, pixels are never touched.
+//
+// Element: mozza_detect
+// Props:
+//   model              : path to face_landmarker.task (string, required unless use-meta
+//                        and every buffer already carries landmarks)
+//   threads            : int, default 4 (CPU threads for inference)
+//   max-faces          : int, [1..16], default 1
+//   ignore-timestamps  : bool, default false (synthetic 30 fps timestamps for the detector)
+//   log-every          : uint, default 60 (periodic TIMING log interval; 0 disables)
+//   prewarm            : int, default 0 (synthetic inferences run in start(); 0 disables)
+//   prewarm-width      : int, default 1280 (prewarm frame width)
+//   prewarm-height     : int, default 720 (prewarm frame height)
+//   detect-scale       : float, (0..1], default 1.0 (downscale frames before detection)
+//   detect-max-side    : int, default 0 (cap the longest side fed to detection; 0 = off;
+//                        can be lowered while playing)
+//   batch-window-us    : int, default 0 (batch detection with other instances of the
+//                        same model, waiting at most this long; 0 = off)
+//   cpu-allocation     : string, read-only (this instance's share of the process
+//                        CPU budget, runtime API v7)
+//   cpu-set            : string, default NULL (CPU list such as "2-5" for the streaming
+//                        thread while it processes a frame, the async-detect worker
+//                        and the runtime's inference workers)
+//   rt-priority        : int, [0..99], default 0 (SCHED_FIFO priority for the same
+//                        threads; 0 = leave the policy alone)
+//   lock-memory        : bool, default false (mlockall the process once the runtime
+//                        context is ready)
+//   use-meta           : bool, default true (skip buffers that already carry landmarks,
+//                        e.g. from facelandmarks; false re-detects and replaces them)
+//   async-detect       : bool, default false (detect on a worker thread and attach the
+//                        latest finished landmarks without waiting for the current frame)
+//   max-stale-ms       : int, default 250 (async-detect: attach nothing when the latest
+//                        landmarks are older than this; 0 = no limit)
+//   detect-interval    : int, default 1 (run the detector every N frames and follow the
+//                        landmarks with optical flow in between; ignored with async-detect;
+//                        can be changed while playing)
+//   motion-gate        : float, default 0 (reuse the last detected landmarks while the
+//                        face region changes less than this mean luma difference per
+//                        pixel, 0..255; 0 = off; ignored with async-detect)
+//   skip-duplicates    : bool, default false (a frame identical to the previous one
+//                        gets its landmarks without detection)
+//   smooth             : float, [0..0.99], default 0 (One-Euro smoothing of the landmarks;
+//                        0 = off, higher = steadier; scales min-cutoff by 2 * (1 - smooth))
+//   min-cutoff         : float, default 2.0 (One-Euro cutoff at rest, Hz)
+//   beta               : float, default 0.05 (One-Euro cutoff slope with speed)
+//
+// Caps: video/x-raw, format={ RGBA, NV12, I420 }
+
+#include "gstmozzadetect.h"
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "mp_runtime.h"
+#include "mp_runtime_loader.h"
+#include "mp_batcher.h"
+#include "mp_thread_policy.h"
+#include "mozza_landmarks_meta.h"
+#include "timing_window.hpp"
+#include "async_detector.hpp"
+#include "landmark_tracker.hpp"
+#include "frame_hash.hpp"
+#include "one_euro.hpp"
+
+GST_DEBUG_CATEGORY_EXTERN(gst_mozza_mp_debug_category);
+#define GST_CAT_DEFAULT gst_mozza_mp_debug_category
+
+// Longest side of the grayscale frame the landmarks are tracked and gated on.
+static constexpr int kLumaMaxSide = 320;
+// motion-gate: detect at least every this many frames, so a face the
+// detector missed on a still shot is looked for again.
+static constexpr guint kGateMaxReuse = 60;
+
+// Downscaled luma of the current frame (detect-interval, motion-gate).
+struct LumaFrame {
+  cv::Mat small;                   // downscaled RGBA (RGBA input only)
+  cv::Mat gray;
+};
+
+// detect-interval: landmarks carried between full detections.
+struct TrackState {
+  LandmarkTracker tracker;
+  std::vector<cv::Point2f> pts;
+  std::vector<MpLandmark> lm;      // meta layout: n_faces * per_face
+  std::vector<MpFace> faces;
+  guint n_faces = 0;
+  guint per_face = 0;
+  guint since_detect = 0;          // frames since the last full detection
+};
+
+// motion-gate: the face region of the last detected frame and its landmarks.
+struct GateState {
+  cv::Mat ref;                     // luma of roi at the last detection
+  cv::Rect roi;                    // in the downscaled frame
+  cv::Size size;                   // downscaled frame size ref was taken at
+  GstBuffer* landmarks = nullptr;  // carries the meta of the last detection
+  guint reused = 0;                // frames served from it since
+  std::vector<MpFace> faces;       // scratch for the meta -> result view
+  ~GateState() { if (landmarks) gst_buffer_unref(landmarks); }
+};
+
+static_assert(sizeof(MpLandmark) == 3 * sizeof(float), "landmarks are filtered as floats");
+
+// detect-max-side lowered below the value the detector was created with:
+// the frame scaled down here, one cv::Mat per plane.
+struct ShrinkFrame {
+  cv::Mat planes[3];
+};
+
+// skip-duplicates: the previous frame's hash and the landmarks it left with.
+struct DupState {
+  uint64_t hash = 0;
+  GstBuffer* landmarks = nullptr;  // nullptr = the previous frame had none
+  std::vector<MpFace> faces;       // scratch for the meta -> result view
+  ~DupState() { if (landmarks) gst_buffer_unref(landmarks); }
+};
+
+struct _GstMozzaDetect {
+  GstVideoFilter parent;
+
+  // properties
+  gchar*   model_path;
+  gint     num_threads;
+  gint     max_faces;
+  gboolean ignore_ts;
+  guint    log_every;
+  gint     prewarm;         // synthetic inferences at start()
+  gint     prewarm_w;
+  gint     prewarm_h;
+  gfloat   detect_scale;    // ingest downscale for the detector
+  gint     detect_max_side;
+  gint     created_max_side; // detect_max_side the runtime context was created with
+  gint     batch_window_us; // 0 = detect alone
+  MpCpuAllocation cpu_alloc; // last polled CPU budget share (object lock)
+  gchar*   cpu_set;         // CPU list for processing threads, NULL = inherit
+  gint     rt_priority;     // SCHED_FIFO priority, 0 = inherit
+  gboolean lock_memory;
+  gboolean use_meta;        // leave landmarks attached upstream alone
+  gboolean async_detect;
+  gint     max_stale_ms;    // 0 = attach landmarks of any age
+  gint     detect_interval; // full detection every N frames, optical flow between
+  gfloat   motion_gate;     // mean luma difference below which detection is skipped
+  gboolean skip_duplicates;
+  gfloat   smooth;          // 0 = landmarks leave unfiltered
+  gfloat   min_cutoff;
+  gfloat   beta;
+  // mozza_mp adaptive-quality: detect-max-side / detect-interval queued from
+  // another thread (object lock), taken at the start of the next frame.
+  gint     quality_queued;  // atomic
+  gint     queued_max_side;
+  gint     queued_interval;
+
+  // runtime
+  MpFaceCtx* mp_ctx;
+  std::unique_ptr<mp_batcher::Member> batcher;
+  std::unique_ptr<AsyncDetector> async;   // async-detect worker
+  std::unique_ptr<ShrinkFrame> shrink;    // detect-max-side lowered while playing
+  std::unique_ptr<LumaFrame> luma;        // detect-interval or motion-gate
+  std::unique_ptr<TrackState> track;      // detect-interval > 1
+  std::unique_ptr<GateState> gate;        // motion-gate > 0
+  std::unique_ptr<DupState> dup;          // skip-duplicates
+  std::unique_ptr<OneEuroBank> smoother;  // smooth
+  int64_t  smooth_ts_us;    // timestamp of the last smoothed landmarks
+
+  // Stats
+  guint64 frame_count;
+  gboolean policy_warned;   // a thread policy failure was posted since start
+
+  // Timing
+  TimingWindow window;
+  MpRuntimeStats rt_stats_prev;   // runtime counters at the last TIMING line
+  // async-detect: age of the attached landmarks over the window
+  guint    stale_count;
+  guint64  stale_frames_sum;
+  guint64  stale_frames_max;
+  double   stale_ms_sum;
+  double   stale_ms_max;
+  guint    stale_dropped;   // frames left without landmarks by max-stale-ms
+  // detect-interval: tracking over the window
+  guint    tracked_frames;
+  guint    track_lost;      // early re-detects forced by the flow check
+  double   track_err_sum;   // tracked vs. detected, fraction of the face size
+  guint    track_err_count;
+  // motion-gate: detections skipped over the window
+  guint    gate_hits;
+  guint    detect_runs;     // frames that ran the detector (timed)
+  double   detect_us_sum;
+  double   gate_us_sum;     // time spent on the frames the gate served
+  double   detect_cost_us;  // last window's mean detection, kept across windows
+  guint    dup_hits;        // skip-duplicates: repeats served since the last line
+};
+
+// ── Properties ────────────────────────────────────────────────────────────────
+enum {
+  PROP_0,
+  PROP_MODEL_PATH,
+  PROP_NUM_THREADS,
+  PROP_MAX_FACES,
+  PROP_IGNORE_TS,
+  PROP_LOG_EVERY,
+  PROP_PREWARM,
+  PROP_PREWARM_W,
+  PROP_PREWARM_H,
+  PROP_DETECT_SCALE,
+  PROP_DETECT_MAX_SIDE,
+  PROP_BATCH_WINDOW_US,
+  PROP_CPU_ALLOCATION,
+  PROP_CPU_SET,
+  PROP_RT_PRIORITY,
+  PROP_LOCK_MEMORY,
+  PROP_USE_META,
+  PROP_ASYNC_DETECT,
+  PROP_MAX_STALE_MS,
+  PROP_DETECT_INTERVAL,
+  PROP_MOTION_GATE,
+  PROP_SKIP_DUPLICATES,
+  PROP_SMOOTH,
+  PROP_MIN_CUTOFF,
+  PROP_BETA,
+};
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE(
+  "sink", GST_PAD_SINK, GST_PAD_ALWAYS,
+  GST_STATIC_CAPS("video/x-raw(memory:GLMemory), format=RGBA; video/x-raw, format={ RGBA, NV12, I420 }"));
+static GstStaticPadTemplate src_template  = GST_STATIC_PAD_TEMPLATE(
+  "src",  GST_PAD_SRC,  GST_PAD_ALWAYS,
+  GST_STATIC_CAPS("video/x-raw(memory:GLMemory), format=RGBA; video/x-raw, format={ RGBA, NV12, I420 }"));
+
+G_DEFINE_TYPE(GstMozzaDetect, gst_mozza_detect, GST_TYPE_VIDEO_FILTER)
+
+// ── GObject props ────────────────────────────────────────────────────────────
+static void gst_mozza_detect_set_property(GObject* obj, guint prop_id,
+                                          const GValue* value, GParamSpec* pspec) {
+  auto* self = GST_MOZZA_DETECT(obj);
+  switch (prop_id) {
+    case PROP_MODEL_PATH:
+      g_free(self->model_path);
+      self->model_path = g_value_dup_string(value);
+      GST_INFO_OBJECT(self, "prop:model = %s", self->model_path ? self->model_path : "(null)");
+      break;
+    case PROP_NUM_THREADS:
+      self->num_threads = g_value_get_int(value);
+      GST_INFO_OBJECT(self, "prop:threads = %d", self->num_threads);
+      break;
+    case PROP_MAX_FACES:
+      self->max_faces = g_value_get_int(value);
+      GST_INFO_OBJECT(self, "prop:max-faces = %d", self->max_faces);
+      break;
+    case PROP_IGNORE_TS:
+      self->ignore_ts = g_value_get_boolean(value);
+      GST_INFO_OBJECT(self, "prop:ignore-timestamps = %s", self->ignore_ts ? "true" : "false");
+      break;
+    case PROP_LOG_EVERY:
+      self->log_every = g_value_get_uint(value);
+      GST_INFO_OBJECT(self, "prop:log-every = %u", self->log_every);
+      break;
+    case PROP_PREWARM:
+      self->prewarm = g_value_get_int(value);
+      GST_INFO_OBJECT(self, "prop:prewarm = %d", self->prewarm);
+      break;
+    case PROP_PREWARM_W:
+      self->prewarm_w = g_value_get_int(value);
+      GST_INFO_OBJECT(self, "prop:prewarm-width = %d", self->prewarm_w);
+      break;
+    case PROP_PREWARM_H:
+      self->prewarm_h = g_value_get_int(value);
+      GST_INFO_OBJECT(self, "prop:prewarm-height = %d", self->prewarm_h);
+      break;
+    case PROP_DETECT_SCALE:
+      self->detect_scale = g_value_get_float(value);
+      GST_INFO_OBJECT(self, "prop:detect-scale = %.3f", self->detect_scale);
+      break;
+    case PROP_DETECT_MAX_SIDE:
+      self->detect_max_side = g_value_get_int(value);
+      GST_INFO_OBJECT(self, "prop:detect-max-side = %d", self->detect_max_side);
+      break;
+    case PROP_BATCH_WINDOW_US:
+      self->batch_window_us = g_value_get_int(value);
+      GST_INFO_OBJECT(self, "prop:batch-window-us = %d", self->batch_window_us);
+      break;
+    case PROP_CPU_SET:
+      g_free(self->cpu_set);
+      self->cpu_set = g_value_dup_string(value);
+      GST_INFO_OBJECT(self, "prop:cpu-set = %s", self->cpu_set ? self->cpu_set : "(inherit)");
+      break;
+    case PROP_RT_PRIORITY:
+      self->rt_priority = g_value_get_int(value);
+      GST_INFO_OBJECT(self, "prop:rt-priority = %d", self->rt_priority);
+      break;
+    case PROP_LOCK_MEMORY:
+      self->lock_memory = g_value_get_boolean(value);
+      GST_INFO_OBJECT(self, "prop:lock-memory = %d", self->lock_memory);
+      break;
+    case PROP_USE_META:
+      self->use_meta = g_value_get_boolean(value);
+      GST_INFO_OBJECT(self, "prop:use-meta = %d", self->use_meta);
+      break;
+    case PROP_ASYNC_DETECT:
+      self->async_detect = g_value_get_boolean(value);
+      GST_INFO_OBJECT(self, "prop:async-detect = %d", self->async_detect);
+      break;
+    case PROP_MAX_STALE_MS:
+      self->max_stale_ms = g_value_get_int(value);
+      GST_INFO_OBJECT(self, "prop:max-stale-ms = %d", self->max_stale_ms);
+      break;
+    case PROP_DETECT_INTERVAL:
+      self->detect_interval = g_value_get_int(value);
+      GST_INFO_OBJECT(self, "prop:detect-interval = %d", self->detect_interval);
+      break;
+    case PROP_MOTION_GATE:
+      self->motion_gate = g_value_get_float(value);
+      GST_INFO_OBJECT(self, "prop:motion-gate = %.2f", self->motion_gate);
+      break;
+    case PROP_SKIP_DUPLICATES:
+      self->skip_duplicates = g_value_get_boolean(value);
+      GST_INFO_OBJECT(self, "prop:skip-duplicates = %s", self->skip_duplicates ? "true" : "false");
+      break;
+    case PROP_SMOOTH:
+      self->smooth = g_value_get_float(value);
+      GST_INFO_OBJECT(self, "prop:smooth = %.2f", self->smooth);
+      break;
+    case PROP_MIN_CUTOFF:
+      self->min_cutoff = g_value_get_float(value);
+      GST_INFO_OBJECT(self, "prop:min-cutoff = %.3f", self->min_cutoff);
+      break;
+    case PROP_BETA:
+      self->beta = g_value_get_float(value);
+      GST_INFO_OBJECT(self, "prop:beta = %.3f", self->beta);
+      break;
+    default: G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+  }
+}
+
+static void gst_mozza_detect_get_property(GObject* obj, guint prop_id,
+                                          GValue* value, GParamSpec* pspec) {
+  auto* self = GST_MOZZA_DETECT(obj);
+  switch (prop_id) {
+    case PROP_MODEL_PATH:      g_value_set_string (value, self->model_path);      break;
+    case PROP_NUM_THREADS:     g_value_set_int    (value, self->num_threads);     break;
+    case PROP_MAX_FACES:       g_value_set_int    (value, self->max_faces);       break;
+    case PROP_IGNORE_TS:       g_value_set_boolean(value, self->ignore_ts);       break;
+    case PROP_LOG_EVERY:       g_value_set_uint   (value, self->log_every);       break;
+    case PROP_PREWARM:         g_value_set_int    (value, self->prewarm);         break;
+    case PROP_PREWARM_W:       g_value_set_int    (value, self->prewarm_w);       break;
+    case PROP_PREWARM_H:       g_value_set_int    (value, self->prewarm_h);       break;
+    case PROP_DETECT_SCALE:    g_value_set_float  (value, self->detect_scale);    break;
+    case PROP_DETECT_MAX_SIDE:
+      GST_OBJECT_LOCK(self);
+      g_value_set_int(value, self->quality_queued ? self->queued_max_side : self->detect_max_side);
+      GST_OBJECT_UNLOCK(self);
+      break;
+    case PROP_BATCH_WINDOW_US: g_value_set_int    (value, self->batch_window_us); break;
+    case PROP_CPU_ALLOCATION: {
+      GST_OBJECT_LOCK(self);
+      const MpCpuAllocation a = self->cpu_alloc;
+      GST_OBJECT_UNLOCK(self);
+      g_value_take_string(value, g_strdup_printf(
+          "budget=%d contexts=%d inference=%d warp=%d warp-pool=%d overcommit=%d generation=%u",
+          a.budget, a.contexts, a.inference_threads, a.warp_threads, a.warp_pool, a.overcommit,
+          a.generation));
+      break;
+    }
+    case PROP_CPU_SET:         g_value_set_string (value, self->cpu_set);         break;
+    case PROP_RT_PRIORITY:     g_value_set_int    (value, self->rt_priority);     break;
+    case PROP_LOCK_MEMORY:     g_value_set_boolean(value, self->lock_memory);     break;
+    case PROP_USE_META:        g_value_set_boolean(value, self->use_meta);        break;
+    case PROP_ASYNC_DETECT:    g_value_set_boolean(value, self->async_detect);    break;
+    case PROP_MAX_STALE_MS:    g_value_set_int    (value, self->max_stale_ms);    break;
+    case PROP_DETECT_INTERVAL:
+      GST_OBJECT_LOCK(self);
+      g_value_set_int(value, self->quality_queued ? self->queued_interval : self->detect_interval);
+      GST_OBJECT_UNLOCK(self);
+      break;
+    case PROP_MOTION_GATE:     g_value_set_float  (value, self->motion_gate);     break;
+    case PROP_SKIP_DUPLICATES: g_value_set_boolean(value, self->skip_duplicates); break;
+    case PROP_SMOOTH:          g_value_set_float  (value, self->smooth);          break;
+    case PROP_MIN_CUTOFF:      g_value_set_float  (value, self->min_cutoff);      break;
+    case PROP_BETA:            g_value_set_float  (value, self->beta);            break;
+    default: G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+  }
+}
+
+void gst_mozza_detect_queue_quality(GstMozzaDetect* self, gint max_side, gint interval) {
+  g_return_if_fail(GST_IS_MOZZA_DETECT(self));
+  GST_OBJECT_LOCK(self);
+  self->queued_max_side = max_side;
+  self->queued_interval = CLAMP(interval, 1, 300);
+  g_atomic_int_set(&self->quality_queued, TRUE);
+  GST_OBJECT_UNLOCK(self);
+}
+
+// Takes what gst_mozza_detect_queue_quality left, on the streaming thread.
+// detect-max-side is also read by the async-detect worker, hence atomic.
+static void take_queued_quality(GstMozzaDetect* self) {
+  if (!g_atomic_int_get(&self->quality_queued)) return;
+  GST_OBJECT_LOCK(self);
+  g_atomic_int_set(&self->detect_max_side, self->queued_max_side);
+  self->detect_interval = self->queued_interval;
+  g_atomic_int_set(&self->quality_queued, FALSE);
+  GST_OBJECT_UNLOCK(self);
+  GST_DEBUG_OBJECT(self, "quality: detect-max-side=%d detect-interval=%d",
+                   self->detect_max_side, self->detect_interval);
+}
+
+// Polls this instance's share of the runtime's CPU budget (v7). The warps
+// run on OpenCV's process-wide pool, which is sized to what the budget
+// leaves for the warps of all instances; 0 runs them on the streaming
+// threads.
+static void refresh_cpu_allocation(GstMozzaDetect* self) {
+  if (!self->mp_ctx || !MpApiHas(7) || !MpApi().face_get_allocation) return;
+  MpCpuAllocation a{};
+  if (MpApi().face_get_allocation(self->mp_ctx, &a) != 0) return;
+  GST_OBJECT_LOCK(self);
+  const MpCpuAllocation prev = self->cpu_alloc;
+  self->cpu_alloc = a;
+  GST_OBJECT_UNLOCK(self);
+  if (a.generation == prev.generation && a.inference_threads == prev.inference_threads) return;
+  if (a.budget > 0 && a.warp_pool != cv::getNumThreads()) cv::setNumThreads(a.warp_pool);
+  GST_INFO_OBJECT(self, "CPU budget: %d cores over %d context(s); inference %d, warp %d (pool %d)",
+                  a.budget, a.contexts, a.inference_threads, a.warp_threads, a.warp_pool);
+  if (a.overcommit > 0)
+    GST_WARNING_OBJECT(self, "CPU budget: %d contexts on %d cores, %d thread(s) over budget",
+                       a.contexts, a.budget, a.overcommit);
+}
+
+// Posts a thread policy failure once per start; the parts that could be
+// applied still are.
+static void report_thread_policy(GstMozzaDetect* self, const char* thread_name,
+                                 const std::string& err) {
+  if (err.empty()) {
+    GST_INFO_OBJECT(self, "%s: cpu-set=%s rt-priority=%d", thread_name,
+                    self->cpu_set ? self->cpu_set : "(inherit)", self->rt_priority);
+    return;
+  }
+  if (self->policy_warned) return;
+  self->policy_warned = TRUE;
+  GST_ELEMENT_WARNING(self, RESOURCE, SETTINGS, ("Could not apply the thread policy"),
+                      ("%s; continuing without it", err.c_str()));
+}
+
+// Applies cpu-set / rt-priority for good to a thread the element owns (the
+// async-detect worker).
+static void apply_thread_policy(GstMozzaDetect* self, const char* thread_name) {
+  if (!(self->cpu_set && *self->cpu_set) && self->rt_priority <= 0) return;
+  report_thread_policy(self, thread_name, mp_thread_policy::apply(self->cpu_set, self->rt_priority));
+}
+
+// ── Lifecycle ────────────────────────────────────────────────────────────────
+// Creates the runtime context (and batcher) this instance detects with.
+static gboolean create_detector(GstMozzaDetect* self) {
+  if (!self->model_path || !g_file_test(self->model_path, G_FILE_TEST_EXISTS)) {
+    GST_ERROR_OBJECT(self, "missing/invalid model: set model=/path/to/face_landmarker.task");
+    return FALSE;
+  }
+  if (!MpApiOK()) {
+    GST_ERROR_OBJECT(self, "mp_runtime loader not initialized");
+    return FALSE;
+  }
+
+  MpFaceLandmarkerOptions opts{};
+  opts.model_path       = self->model_path;
+  opts.max_faces        = self->max_faces;
+  opts.with_blendshapes = 0;
+  opts.with_geometry    = 0;
+  opts.num_threads      = self->num_threads;
+  opts.delegate         = "cpu";
+  opts.prewarm_frames   = self->prewarm;
+  opts.prewarm_width    = self->prewarm_w;
+  opts.prewarm_height   = self->prewarm_h;
+  opts.detect_scale     = self->detect_scale;
+  opts.detect_max_side  = self->detect_max_side;
+  self->created_max_side = self->detect_max_side;
+  opts.cpu_set          = self->cpu_set;
+  opts.rt_priority      = self->rt_priority;
+  opts.lock_memory      = self->lock_memory;
+  if ((self->cpu_set || self->rt_priority > 0 || self->lock_memory) && !MpApiHas(8))
+    GST_ELEMENT_WARNING(self, RESOURCE, SETTINGS, ("Runtime ignores the thread policy"),
+                        ("runtime API v%d < 8: cpu-set / rt-priority / lock-memory only apply "
+                         "to the streaming thread", MpApi().api_version));
+
+  auto t0 = std::chrono::steady_clock::now();
+  int rc = MpApi().face_create(&opts, &self->mp_ctx);
+  auto t1 = std::chrono::steady_clock::now();
+  auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
+
+  if (rc != 0 || !self->mp_ctx) {
+    const char* loader_err = mp_runtime_loader::last_error();
+    GST_FIXME_OBJECT(self, "mp_face_landmarker_create failed (rc=%d) in %lld ms. Error: %s", rc, (long long)ms, loader_err ? loader_err : "(none)");
+    return FALSE;
+  }
+  GST_INFO_OBJECT(self, "FaceLandmarker ready in %lld us (incl. prewarm=%d)",
+                  (long long)std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count(),
+                  self->prewarm);
+  refresh_cpu_allocation(self);
+
+  if (self->batch_window_us > 0) {
+    if (!MpApiHas(6) || !MpApi().face_detect_batch)
+      GST_WARNING_OBJECT(self, "batch-window-us ignored: runtime %s (API v%d) does not batch",
+                         MpApi().runtime_build(), MpApi().api_version);
+    self->batcher = std::make_unique<mp_batcher::Member>(self->model_path, self->mp_ctx,
+                                                         self->batch_window_us);
+  }
+  return TRUE;
+}
+
+// Describes a mapped frame to the runtime. 4:2:0 input goes as planes; the
+// runtime converts (and downscales) in one pass, so no RGBA copy of the
+// frame is made for detection.
+static void frame_to_image(const GstVideoFrame* f, MpImage* img) {
+  *img = MpImage{};
+  img->data   = static_cast<const uint8_t*>(GST_VIDEO_FRAME_PLANE_DATA(f, 0));
+  img->width  = GST_VIDEO_FRAME_WIDTH(f);
+  img->height = GST_VIDEO_FRAME_HEIGHT(f);
+  img->stride = GST_VIDEO_FRAME_PLANE_STRIDE(f, 0);
+  img->format = MP_IMAGE_RGBA8888;
+
+  const GstVideoFormat fmt = GST_VIDEO_FRAME_FORMAT(f);
+  if (fmt == GST_VIDEO_FORMAT_NV12 || fmt == GST_VIDEO_FORMAT_I420) {
+    img->format = (fmt == GST_VIDEO_FORMAT_NV12) ? MP_IMAGE_NV12 : MP_IMAGE_I420;
+    for (guint p = 0; p < GST_VIDEO_FRAME_N_PLANES(f) && p < 3; ++p) {
+      img->planes[p]  = static_cast<const uint8_t*>(GST_VIDEO_FRAME_PLANE_DATA(f, p));
+      img->strides[p] = GST_VIDEO_FRAME_PLANE_STRIDE(f, p);
+    }
+  }
+}
+
+// The runtime only takes detect-max-side when the context is created. A
+// lower value set later is applied here: each plane is scaled so the longest
+// side fits, and img describes the scaled planes. The landmarks come back
+// normalized, so nothing else changes.
+static void shrink_image(GstMozzaDetect* self, const GstVideoFrame* f, int max_side,
+                         MpImage* img) {
+  const int w = GST_VIDEO_FRAME_WIDTH(f), h = GST_VIDEO_FRAME_HEIGHT(f);
+  if (std::max(w, h) <= max_side) return;
+  const double s = (double)max_side / std::max(w, h);
+  const int sw = std::max(2, (int)(w * s) & ~1);  // even, for the 4:2:0 chroma planes
+  const int sh = std::max(2, (int)(h * s) & ~1);
+  if (!self->shrink) self->shrink = std::make_unique<ShrinkFrame>();
+
+  const GstVideoFormat fmt = GST_VIDEO_FRAME_FORMAT(f);
+  for (guint p = 0; p < GST_VIDEO_FRAME_N_PLANES(f) && p < 3; ++p) {
+    const int type = fmt == GST_VIDEO_FORMAT_RGBA ? CV_8UC4
+                   : (fmt == GST_VIDEO_FORMAT_NV12 && p == 1) ? CV_8UC2 : CV_8UC1;
+    const int div = p == 0 ? 1 : 2;
+    const cv::Mat src(GST_VIDEO_FRAME_COMP_HEIGHT(f, p), GST_VIDEO_FRAME_COMP_WIDTH(f, p), type,
+                      GST_VIDEO_FRAME_PLANE_DATA(f, p), GST_VIDEO_FRAME_PLANE_STRIDE(f, p));
+    cv::Mat& dst = self->shrink->planes[p];
+    cv::resize(src, dst, cv::Size(sw / div, sh / div), 0, 0, cv::INTER_AREA);
+    if (img->format != MP_IMAGE_RGBA8888) {
+      img->planes[p]  = dst.data;
+      img->strides[p] = (int)dst.step;
+    }
+  }
+  img->data   = self->shrink->planes[0].data;
+  img->stride = (int)self->shrink->planes[0].step;
+  img->width  = sw;
+  img->height = sh;
+}
+
+static int detect_frame(GstMozzaDetect* self, const GstVideoFrame* f, int64_t ts_us,
+                        MpFaceResult* out) {
+  MpImage img;
+  frame_to_image(f, &img);
+  const int max_side = g_atomic_int_get(&self->detect_max_side);
+  if (max_side > 0 && (self->created_max_side == 0 || max_side < self->created_max_side))
+    shrink_image(self, f, max_side, &img);
+  return self->batcher ? self->batcher->detect(&img, ts_us, out)
+                       : MpApi().face_detect(self->mp_ctx, &img, ts_us, out);
+}
+
+static void reset_window_stats(GstMozzaDetect* self) {
+  self->stale_count = 0;
+  self->stale_frames_sum = self->stale_frames_max = 0;
+  self->stale_ms_sum = self->stale_ms_max = 0.0;
+  self->stale_dropped = 0;
+  self->tracked_frames = 0;
+  self->track_lost = 0;
+  self->track_err_sum = 0.0;
+  self->track_err_count = 0;
+  self->gate_hits = 0;
+  self->detect_runs = 0;
+  self->detect_us_sum = 0.0;
+  self->gate_us_sum = 0.0;
+  self->dup_hits = 0;
+}
+
+static gboolean gst_mozza_detect_start(GstBaseTransform* base) {
+  auto* self = GST_MOZZA_DETECT(base);
+
+  GST_INFO_OBJECT(self, "start()");
+  take_queued_quality(self);
+
+  // --- DIAGNOSTICS: Check environment variables for Threading ---
+  const char* omp = std::getenv("OMP_NUM_THREADS");
+  const char* xnn = std::getenv("XNNPACK_NUM_THREADS");
+  const char* tflite = std::getenv("TFLITE_NUM_THREADS");
+  GST_INFO_OBJECT(self, "--- THREADING DIAGNOSTICS ---");
+  GST_INFO_OBJECT(self, "Requested via Gst property: threads=%d", self->num_threads);
+  GST_INFO_OBJECT(self, "Env OMP_NUM_THREADS:     %s", omp ? omp : "UNSET (Defaults to 1)");
+  GST_INFO_OBJECT(self, "Env XNNPACK_NUM_THREADS: %s", xnn ? xnn : "UNSET (Defaults to 1)");
+  GST_INFO_OBJECT(self, "Env TFLITE_NUM_THREADS:  %s", tflite ? tflite : "UNSET (Defaults to 1)");
+  GST_INFO_OBJECT(self, "-----------------------------");
+
+  self->mp_ctx = nullptr;
+  if (self->use_meta && !self->model_path) {
+    GST_INFO_OBJECT(self, "no model: passing through landmarks attached upstream (GstMozzaLandmarksMeta) only");
+  } else if (!create_detector(self)) {
+    return FALSE;
+  } else if (self->async_detect) {
+    self->async = std::make_unique<AsyncDetector>(
+        [self](const GstVideoFrame* f, int64_t ts_us, MpFaceResult* out) {
+          return detect_frame(self, f, ts_us, out);
+        },
+        [self] { apply_thread_policy(self, "async-detect thread"); });
+    if (self->detect_interval > 1)
+      GST_WARNING_OBJECT(self, "detect-interval ignored with async-detect");
+    if (self->motion_gate > 0.f)
+      GST_WARNING_OBJECT(self, "motion-gate ignored with async-detect");
+  } else if (self->motion_gate > 0.f) {
+    self->gate = std::make_unique<GateState>();  // the tracker follows detect-interval per frame
+  }
+  if (self->skip_duplicates) self->dup = std::make_unique<DupState>();
+  self->smoother = std::make_unique<OneEuroBank>();  // smooth can be turned on while playing
+  self->smooth_ts_us = 0;
+  self->detect_cost_us = 0.0;
+
+  self->frame_count = 0;
+  self->window.us.clear();
+  self->rt_stats_prev = MpRuntimeStats{};
+  reset_window_stats(self);
+  self->policy_warned = FALSE;
+  return TRUE;
+}
+
+static gboolean gst_mozza_detect_stop(GstBaseTransform* base) {
+  auto* self = GST_MOZZA_DETECT(base);
+  self->async.reset();  // joins the worker before its context goes away
+  self->shrink.reset();
+  self->track.reset();
+  self->gate.reset();
+  self->dup.reset();
+  self->smoother.reset();
+  self->luma.reset();
+  self->batcher.reset();
+  if (self->mp_ctx) { MpApi().face_close(&self->mp_ctx); self->mp_ctx = nullptr; }
+  GST_OBJECT_LOCK(self);
+  self->cpu_alloc = MpCpuAllocation{};
+  GST_OBJECT_UNLOCK(self);
+  return TRUE;
+}
+
+static void gst_mozza_detect_finalize(GObject* object) {
+  auto* self = GST_MOZZA_DETECT(object);
+  self->async.reset();
+  self->shrink.reset();
+  self->track.reset();
+  self->gate.reset();
+  self->dup.reset();
+  self->smoother.reset();
+  self->luma.reset();
+  self->batcher.reset();
+  if (self->mp_ctx) { MpApi().face_close(&self->mp_ctx); self->mp_ctx = nullptr; }
+  g_clear_pointer(&self->model_path, g_free);
+  g_clear_pointer(&self->cpu_set,    g_free);
+  self->window.us.clear();
+  self->window.us.shrink_to_fit();
+  G_OBJECT_CLASS(gst_mozza_detect_parent_class)->finalize(object);
+}
+
+// NV12/I420 planes reach the runtime only from API v4 on; with an older
+// runtime (or none) the caps are narrowed to RGBA.
+static GstCaps* gst_mozza_detect_transform_caps(GstBaseTransform* bt, GstPadDirection dir,
+                                                GstCaps* caps, GstCaps* filter) {
+  GstCaps* out =
+      GST_BASE_TRANSFORM_CLASS(gst_mozza_detect_parent_class)->transform_caps(bt, dir, caps, filter);
+  if (MpApiHas(4)) return out;
+  GstCaps* rgba = gst_caps_from_string(
+      "video/x-raw(memory:GLMemory), format=RGBA; video/x-raw, format=RGBA");
+  GstCaps* res = gst_caps_intersect(out, rgba);
+  gst_caps_unref(rgba);
+  gst_caps_unref(out);
+  return res;
+}
+
+static gboolean gst_mozza_detect_set_info(GstVideoFilter*, GstCaps*, GstVideoInfo*, GstCaps*, GstVideoInfo*) { return TRUE; }
+
+// One TIMING detect line per log-every frames, with the runtime's stage
+// split and the batcher's fill over the same window. With async-detect the
+// detection times come from the worker, and the line also gives the age of
+// the landmarks that were attached.
+static void log_timing(GstMozzaDetect* self) {
+  double mean_ms, p99_ms, max_ms;
+  GString* extra = g_string_new(nullptr);
+  if (self->async) {
+    size_t runs = 0;
+    self->async->take_timing(&mean_ms, &p99_ms, &max_ms, &runs);
+    const double n = std::max(1u, self->stale_count);
+    if (self->dup) g_string_append_printf(extra, "  dup=%u", self->dup_hits);
+    GST_INFO_OBJECT(self,
+        "TIMING detect frame=%llu (window avg)  detect=%.2fms  (%.0f fps)  p99=%.2fms max=%.2fms"
+        "  async runs=%zu  stale=%.1f frames/%.1fms (max %llu/%.1fms)  too-old=%u%s",
+        (unsigned long long)self->frame_count, mean_ms,
+        mean_ms > 0.0 ? 1000.0 / mean_ms : 0.0, p99_ms, max_ms, runs,
+        self->stale_frames_sum / n, self->stale_ms_sum / n,
+        (unsigned long long)self->stale_frames_max, self->stale_ms_max, self->stale_dropped,
+        extra->str);
+    reset_window_stats(self);
+  } else {
+    const size_t frames = self->window.size();
+    self->window.take(&mean_ms, &p99_ms, &max_ms);
+    if (self->track)
+      g_string_append_printf(extra, "  tracked=%u/%zu  lost=%u  track-err=%.2f%%",
+          self->tracked_frames, frames, self->track_lost,
+          self->track_err_count ? 100.0 * self->track_err_sum / self->track_err_count : 0.0);
+    if (self->gate) {
+      // Saved: the detections the gate skipped, at this window's mean
+      // detection cost (or the last known one), minus the gate's own time.
+      if (self->detect_runs > 0) self->detect_cost_us = self->detect_us_sum / self->detect_runs;
+      const double saved_ms =
+          std::max(0.0, self->gate_hits * self->detect_cost_us - self->gate_us_sum) / 1000.0;
+      const double spent_ms = mean_ms * frames;
+      g_string_append_printf(extra, "  gate=%u/%zu (%.0f%%)  saved=%.1fms (%.0f%%)",
+          self->gate_hits, frames, frames ? 100.0 * self->gate_hits / frames : 0.0, saved_ms,
+          saved_ms > 0.0 ? 100.0 * saved_ms / (saved_ms + spent_ms) : 0.0);
+    }
+    if (self->dup) g_string_append_printf(extra, "  dup=%u", self->dup_hits);
+    GST_INFO_OBJECT(self,
+        "TIMING detect frame=%llu (window avg)  detect=%.2fms  (%.0f fps)  p99=%.2fms max=%.2fms%s",
+        (unsigned long long)self->frame_count, mean_ms,
+        mean_ms > 0.0 ? 1000.0 / mean_ms : 0.0, p99_ms, max_ms, extra->str);
+    reset_window_stats(self);
+  }
+  g_string_free(extra, TRUE);
+
+  MpRuntimeStats st{};
+  if (MpApiHas(5) && MpApi().face_get_stats &&
+      MpApi().face_get_stats(self->mp_ctx, &st) == 0) {
+    const MpRuntimeStats& p = self->rt_stats_prev;
+    const double f = std::max<double>(1.0, (double)(st.frames - p.frames));
+    GST_INFO_OBJECT(self,
+        "TIMING runtime (window avg)  ingest=%.2fms  graph=%.2fms  marshal=%.2fms  "
+        "detector=%lld tracker=%lld  allocs/frame=%.1f (%.0f KiB/frame)  face=%llu/%llu",
+        (st.ingest_us_total  - p.ingest_us_total)  / f / 1000.0,
+        (st.graph_us_total   - p.graph_us_total)   / f / 1000.0,
+        (st.marshal_us_total - p.marshal_us_total) / f / 1000.0,
+        (long long)(st.detector_runs - p.detector_runs),
+        (long long)(st.tracker_runs  - p.tracker_runs),
+        (double)(st.allocations - p.allocations) / f,
+        (double)(st.allocated_bytes - p.allocated_bytes) / f / 1024.0,
+        (unsigned long long)(st.frames_with_face - p.frames_with_face),
+        (unsigned long long)(st.frames - p.frames));
+    self->rt_stats_prev = st;
+  }
+  if (self->batcher)
+    GST_INFO_OBJECT(self, "TIMING batch (window avg)  frames/batch=%.2f",
+                    self->batcher->take_mean_batch());
+}
+
+static void replace_landmarks_meta(GstBuffer* buffer) {
+  // One landmark set per buffer: a later detector replaces an earlier one.
+  if (GstMozzaLandmarksMeta* old = gst_buffer_get_mozza_landmarks_meta(buffer))
+    gst_buffer_remove_meta(buffer, &old->meta);
+}
+
+// Downscaled luma of the frame. YUV input has it as plane 0.
+static void to_small_gray(const GstVideoFrame* f, LumaFrame* lf) {
+  const int W = GST_VIDEO_FRAME_WIDTH(f);
+  const int H = GST_VIDEO_FRAME_HEIGHT(f);
+  const double s = std::min(1.0, (double)kLumaMaxSide / std::max(W, H));
+  const cv::Size size(std::max(1, (int)std::lround(W * s)), std::max(1, (int)std::lround(H * s)));
+  void* p0 = GST_VIDEO_FRAME_PLANE_DATA(f, 0);
+  const size_t stride = GST_VIDEO_FRAME_PLANE_STRIDE(f, 0);
+  const GstVideoFormat fmt = GST_VIDEO_FRAME_FORMAT(f);
+  if (fmt == GST_VIDEO_FORMAT_NV12 || fmt == GST_VIDEO_FORMAT_I420) {
+    cv::resize(cv::Mat(H, W, CV_8UC1, p0, stride), lf->gray, size, 0, 0, cv::INTER_AREA);
+  } else {
+    cv::resize(cv::Mat(H, W, CV_8UC4, p0, stride), lf->small, size, 0, 0, cv::INTER_AREA);
+    cv::cvtColor(lf->small, lf->gray, cv::COLOR_RGBA2GRAY);
+  }
+}
+
+// Attaches the tracked landmarks (z is kept from the last detection).
+static GstMozzaLandmarksMeta* attach_tracked(GstVideoFrame* f, TrackState* tr,
+                                             const cv::Mat& gray, int64_t ts_us) {
+  const auto& pts = tr->tracker.points();
+  const float sx = 1.f / gray.cols, sy = 1.f / gray.rows;
+  for (size_t i = 0; i < pts.size(); ++i) {
+    tr->lm[i].x = pts[i].x * sx;
+    tr->lm[i].y = pts[i].y * sy;
+  }
+  tr->faces.assign(tr->n_faces, MpFace{});
+  for (guint i = 0; i < tr->n_faces; ++i) {
+    tr->faces[i].landmarks = tr->lm.data() + (size_t)i * tr->per_face;
+    tr->faces[i].landmarks_count = (int32_t)tr->per_face;
+  }
+  MpFaceResult res{};
+  res.faces = tr->faces.data();
+  res.faces_count = (int32_t)tr->n_faces;
+  res.timestamp_us = ts_us;
+  return gst_buffer_add_mozza_landmarks_meta(f->buffer, &res, GST_VIDEO_FRAME_WIDTH(f),
+                                             GST_VIDEO_FRAME_HEIGHT(f));
+}
+
+// Restarts tracking from a full detection. When the tracker also predicted
+// this frame, the gap between prediction and detection is the tracking error
+// reported in the TIMING line, as a fraction of the face's bounding box
+// diagonal.
+static void restart_tracking(GstMozzaDetect* self, const GstMozzaLandmarksMeta* meta,
+                             bool predicted) {
+  TrackState* tr = self->track.get();
+  const cv::Mat& gray = self->luma->gray;
+  tr->since_detect = 0;
+  if (!meta || meta->n_faces == 0) {
+    tr->tracker.clear();  // nothing to follow: detect on the next frame
+    return;
+  }
+  const size_t n = (size_t)meta->n_faces * meta->n_landmarks;
+  const float sw = (float)gray.cols, sh = (float)gray.rows;
+  tr->pts.resize(n);
+  for (size_t i = 0; i < n; ++i)
+    tr->pts[i] = cv::Point2f(meta->landmarks[i].x * sw, meta->landmarks[i].y * sh);
+
+  const auto& pred = tr->tracker.points();
+  if (predicted && pred.size() == n && meta->n_landmarks == tr->per_face) {
+    for (size_t start = 0; start < n; start += meta->n_landmarks) {
+      const cv::Rect2f box = cv::boundingRect2f(std::vector<cv::Point2f>(
+          tr->pts.begin() + start, tr->pts.begin() + start + meta->n_landmarks));
+      const double diag = std::hypot(box.width, box.height);
+      if (diag <= 0.0) continue;
+      double sum = 0.0;
+      for (size_t i = start; i < start + meta->n_landmarks; ++i) sum += cv::norm(pred[i] - tr->pts[i]);
+      self->track_err_sum += sum / meta->n_landmarks / diag;
+      self->track_err_count += 1;
+    }
+  }
+
+  tr->lm.assign(meta->landmarks, meta->landmarks + n);
+  tr->n_faces = meta->n_faces;
+  tr->per_face = meta->n_landmarks;
+  tr->tracker.reset(gray, tr->pts, (int)tr->per_face);
+}
+
+// motion-gate: true when the face region barely changed since the last
+// detection. cv::norm(NORM_L1) of the two regions is OpenCV's vectorized
+// sum of absolute differences.
+static bool gate_hit(GstMozzaDetect* self) {
+  GateState* g = self->gate.get();
+  const cv::Mat& gray = self->luma->gray;
+  if (!g->landmarks || g->size != gray.size() || g->reused >= kGateMaxReuse) return false;
+  const double sad = cv::norm(gray(g->roi), g->ref, cv::NORM_L1);
+  return sad / g->roi.area() < self->motion_gate;
+}
+
+// Keeps the landmarks of this detection and the face region they were
+// found in (all faces, padded by a quarter of their size; the whole frame
+// when there is no face). A failed detection (meta == nullptr) disarms the
+// gate until the next one succeeds.
+static void gate_update(GstMozzaDetect* self, const GstMozzaLandmarksMeta* meta) {
+  GateState* g = self->gate.get();
+  const cv::Mat& gray = self->luma->gray;
+  g->reused = 0;
+  if (g->landmarks) gst_buffer_unref(g->landmarks);
+  g->landmarks = nullptr;
+  if (!meta) return;
+
+  const cv::Rect full(0, 0, gray.cols, gray.rows);
+  g->roi = full;
+  const size_t n = (size_t)meta->n_faces * meta->n_landmarks;
+  if (n > 0) {
+    float x0 = 1.f, y0 = 1.f, x1 = 0.f, y1 = 0.f;
+    for (size_t i = 0; i < n; ++i) {
+      x0 = std::min(x0, meta->landmarks[i].x); x1 = std::max(x1, meta->landmarks[i].x);
+      y0 = std::min(y0, meta->landmarks[i].y); y1 = std::max(y1, meta->landmarks[i].y);
+    }
+    const float px = 0.25f * (x1 - x0), py = 0.25f * (y1 - y0);
+    const cv::Rect face(cv::Point((int)std::floor((x0 - px) * gray.cols),
+                                  (int)std::floor((y0 - py) * gray.rows)),
+                        cv::Point((int)std::ceil((x1 + px) * gray.cols),
+                                  (int)std::ceil((y1 + py) * gray.rows)));
+    if ((face & full).area() > 0) g->roi = face & full;
+  }
+  gray(g->roi).copyTo(g->ref);
+  g->size = gray.size();
+  MpFaceResult res{};
+  gst_mozza_landmarks_meta_as_result(meta, &res, &g->faces);
+  g->landmarks = gst_buffer_new();
+  gst_buffer_add_mozza_landmarks_meta(g->landmarks, &res, meta->width, meta->height);
+}
+
+// smooth: runs every landmark coordinate of meta through the One-Euro bank,
+// in place. No face, a seek back or a new face count starts the filters over.
+static void smooth_landmarks(GstMozzaDetect* self, GstMozzaLandmarksMeta* meta, int64_t ts_us) {
+  if (self->smooth <= 0.f || !meta) return;
+  OneEuroBank* bank = self->smoother.get();
+  if (meta->n_faces == 0 || ts_us < self->smooth_ts_us) bank->reset();
+  const float dt = (float)(ts_us - self->smooth_ts_us) / 1e6f;
+  self->smooth_ts_us = ts_us;
+  if (meta->n_faces == 0) return;
+  bank->configure(self->smooth, self->min_cutoff, self->beta);
+  bank->filter(reinterpret_cast<float*>(meta->landmarks),
+               (size_t)meta->n_faces * meta->n_landmarks * 3, dt);
+}
+
+// async-detect: hands the frame to the worker if it is idle, then attaches
+// the latest finished landmarks, unless they are older than max-stale-ms.
+// Returns true when it attached them.
+static bool attach_latest(GstMozzaDetect* self, GstVideoFrame* f, int64_t ts_us, bool do_timing) {
+  self->async->offer(f, ts_us, self->frame_count);
+
+  AsyncDetector::Latest lt;
+  if (!self->async->latest(&lt)) return false;  // nothing finished yet
+  const guint64 age_frames = self->frame_count - lt.frame;
+  const double age_ms = (ts_us - lt.ts_us) / 1000.0;
+  // A negative age means the stream jumped back (seek): those landmarks
+  // belong to another part of the stream.
+  const bool too_old = age_ms < 0.0 || (self->max_stale_ms > 0 && age_ms > self->max_stale_ms);
+
+  if (do_timing) {
+    self->stale_count += 1;
+    self->stale_frames_sum += age_frames;
+    self->stale_frames_max = std::max(self->stale_frames_max, age_frames);
+    self->stale_ms_sum += std::max(0.0, age_ms);
+    self->stale_ms_max = std::max(self->stale_ms_max, age_ms);
+    if (too_old) self->stale_dropped += 1;
+  }
+
+  const bool attach = lt.landmarks && !too_old;
+  if (attach) {
+    replace_landmarks_meta(f->buffer);
+    gst_buffer_copy_into(f->buffer, lt.landmarks, GST_BUFFER_COPY_META, 0, -1);
+  }
+  if (lt.landmarks) gst_buffer_unref(lt.landmarks);
+  return attach;
+}
+
+// detect-interval can change while playing (mozza_mp adaptive-quality), so
+// the tracker and the luma it works on are made or dropped to match.
+static void sync_tracking(GstMozzaDetect* self) {
+  const bool want = self->detect_interval > 1;
+  if (want && !self->track) self->track = std::make_unique<TrackState>();
+  if (!want && self->track) self->track.reset();
+  if ((self->track || self->gate) && !self->luma) self->luma = std::make_unique<LumaFrame>();
+  if (!self->track && !self->gate) self->luma.reset();
+}
+
+// Attaches this frame's landmarks: from the async worker, the motion gate,
+// the tracker or a detection.
+static void attach_landmarks(GstMozzaDetect* self, GstVideoFrame* f, int64_t ts_us,
+                             bool do_timing) {
+  if (self->async) {
+    if (attach_latest(self, f, ts_us, do_timing))
+      smooth_landmarks(self, gst_buffer_get_mozza_landmarks_meta(f->buffer), ts_us);
+    if (do_timing && self->frame_count % self->log_every == 0) log_timing(self);
+    return;
+  }
+
+  std::chrono::steady_clock::time_point t0;
+  if (do_timing) t0 = std::chrono::steady_clock::now();
+  enum { FRAME_DETECTED, FRAME_TRACKED, FRAME_GATED };
+  auto note_time = [&](int kind) {
+    if (!do_timing) return;
+    const double us = (double)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - t0).count();
+    if (kind == FRAME_DETECTED) { self->detect_runs += 1; self->detect_us_sum += us; }
+    if (kind == FRAME_GATED) self->gate_us_sum += us;
+    self->window.add(us);
+    if (self->window.size() >= self->log_every) log_timing(self);
+  };
+
+  sync_tracking(self);
+  if (self->luma) to_small_gray(f, self->luma.get());
+
+  // motion-gate: a still face keeps the landmarks of the last detection.
+  // The tracker's previous frame moves up to this one too, so flow resumes
+  // from the last frame rather than across the whole gated stretch.
+  if (self->gate && gate_hit(self)) {
+    if (self->track) self->track->tracker.rebase(self->luma->gray);
+    replace_landmarks_meta(f->buffer);
+    gst_buffer_copy_into(f->buffer, self->gate->landmarks, GST_BUFFER_COPY_META, 0, -1);
+    self->gate->reused += 1;
+    self->gate_hits += 1;
+    note_time(FRAME_GATED);
+    return;
+  }
+
+  // detect-interval: between full detections the landmarks follow the flow.
+  // A failed flow check re-detects at once.
+  bool predicted = false;
+  if (TrackState* tr = self->track.get()) {
+    if (tr->tracker.active()) {
+      float trusted = 0.f;
+      predicted = tr->tracker.track(self->luma->gray, &trusted);
+      if (!predicted) {
+        self->track_lost += 1;
+        GST_LOG_OBJECT(self, "flow check failed (%.0f%% of points trusted): re-detecting",
+                       100.f * trusted);
+      } else if (++tr->since_detect < (guint)self->detect_interval) {
+        replace_landmarks_meta(f->buffer);
+        smooth_landmarks(self, attach_tracked(f, tr, self->luma->gray, ts_us), ts_us);
+        self->tracked_frames += 1;
+        note_time(FRAME_TRACKED);
+        return;
+      }
+    }
+  }
+
+  MpFaceResult out{};
+  const int rc = detect_frame(self, f, ts_us, &out);
+  note_time(FRAME_DETECTED);
+
+  // A failed detection leaves the buffer without landmarks; downstream warps
+  // pass it through. Zero faces is a result and is attached as such.
+  if (rc != 0) {
+    if (self->gate) gate_update(self, nullptr);
+    return;
+  }
+
+  replace_landmarks_meta(f->buffer);
+  GstMozzaLandmarksMeta* meta = gst_buffer_add_mozza_landmarks_meta(
+      f->buffer, &out, GST_VIDEO_FRAME_WIDTH(f), GST_VIDEO_FRAME_HEIGHT(f));
+  if (self->track) restart_tracking(self, meta, predicted);  // tracks the raw landmarks
+  smooth_landmarks(self, meta, ts_us);
+  if (self->gate) gate_update(self, meta);  // serves the smoothed ones
+
+  // Export landmarks for comparison/validation
+  if (out.faces_count > 0) {
+    if (const char* lm_out = std::getenv("LANDMARK_OUTPUT_FILE")) {
+      if (FILE* lmf = std::fopen(lm_out, "a")) {
+        GST_LOG_OBJECT(self, "Dumping landmarks to %s", lm_out);
+        const MpFace& f0 = out.faces[0];
+        std::fprintf(lmf, "Frame %llu Face 0:\n", (unsigned long long)self->frame_count);
+        for (int i = 0; i < f0.landmarks_count; ++i)
+          std::fprintf(lmf, "%.6f,%.6f,0.000000\n", f0.landmarks[i].x, f0.landmarks[i].y);
+        std::fclose(lmf);
+      }
+    }
+  }
+
+  MpApi().face_free_result(&out);
+}
+
+// skip-duplicates: keeps the hash of this frame and a copy of the landmarks
+// it left with. A frame left without landmarks is not served again. The hash
+// also goes on the meta, so mozza_warp does not hash the frame again.
+static void dup_remember(GstMozzaDetect* self, uint64_t hash, GstBuffer* buffer) {
+  DupState* d = self->dup.get();
+  d->hash = hash;
+  if (d->landmarks) gst_buffer_unref(d->landmarks);
+  d->landmarks = nullptr;
+  GstMozzaLandmarksMeta* meta = gst_buffer_get_mozza_landmarks_meta(buffer);
+  if (!meta) return;
+  meta->frame_hash = hash;
+  MpFaceResult res{};
+  gst_mozza_landmarks_meta_as_result(meta, &res, &d->faces);
+  d->landmarks = gst_buffer_new();
+  GstMozzaLandmarksMeta* kept =
+      gst_buffer_add_mozza_landmarks_meta(d->landmarks, &res, meta->width, meta->height);
+  if (kept) kept->frame_hash = hash;
+}
+
+static GstFlowReturn gst_mozza_detect_transform_frame_ip(GstVideoFilter* vf,
+                                                         GstVideoFrame* f) {
+  auto* self = GST_MOZZA_DETECT(vf);
+  // Landmarks attached upstream (e.g. by facelandmarks) are kept as they are.
+  if (self->use_meta && gst_buffer_get_mozza_landmarks_meta(f->buffer)) return GST_FLOW_OK;
+  if (!self->mp_ctx) return GST_FLOW_OK;
+  take_queued_quality(self);
+
+  // The streaming thread belongs to GStreamer's pool: cpu-set / rt-priority
+  // hold while this element works on the frame, then the thread gets its
+  // own settings back. With async-detect it only hands frames over.
+  const bool place = !self->async && ((self->cpu_set && *self->cpu_set) || self->rt_priority > 0);
+  mp_thread_policy::Scope placement(place ? self->cpu_set : nullptr, place ? self->rt_priority : 0);
+  if (G_UNLIKELY(!placement.error().empty()))
+    report_thread_policy(self, "streaming thread", placement.error());
+
+  self->frame_count++;
+  if (self->frame_count % 30 == 0) refresh_cpu_allocation(self);  // the split changes as peers come and go
+
+  GstClockTime pts = GST_BUFFER_PTS(f->buffer);
+  int64_t ts_us;
+  if (self->ignore_ts) {
+      ts_us = (int64_t)self->frame_count * 33333LL;
+  } else {
+      ts_us = (int64_t)GST_TIME_AS_USECONDS(pts);
+  }
+
+  if (self->frame_count <= 5) {
+    GST_INFO_OBJECT(self, "FRAME %llu TRACKER DIAGNOSTIC | pts: %" GST_TIME_FORMAT " | synthetic ts_us: %lld | ts_ms sent to MP: %lld",
+                    (unsigned long long)self->frame_count, GST_TIME_ARGS(pts), (long long)ts_us, (long long)(ts_us / 1000));
+  }
+
+  const bool do_timing =
+      self->log_every > 0 &&
+      gst_debug_category_get_threshold(GST_CAT_DEFAULT) >= GST_LEVEL_INFO;
+
+  // skip-duplicates: a repeat of the previous frame gets its landmarks again.
+  uint64_t hash = 0;
+  if (self->dup) {
+    hash = hash_video_frame(f);
+    if (self->dup->landmarks && hash == self->dup->hash) {
+      replace_landmarks_meta(f->buffer);
+      gst_buffer_copy_into(f->buffer, self->dup->landmarks, GST_BUFFER_COPY_META, 0, -1);
+      self->dup_hits += 1;
+      return GST_FLOW_OK;
+    }
+  }
+
+  attach_landmarks(self, f, ts_us, do_timing);
+  if (self->dup) dup_remember(self, hash, f->buffer);
+  return GST_FLOW_OK;
+}
+
+static void gst_mozza_detect_class_init(GstMozzaDetectClass* klass) {
+  auto* gobject_class = G_OBJECT_CLASS(klass);
+  auto* basetr_class  = GST_BASE_TRANSFORM_CLASS(klass);
+  auto* vfilter_class = GST_VIDEO_FILTER_CLASS(klass);
+
+  gobject_class->set_property = gst_mozza_detect_set_property;
+  gobject_class->get_property = gst_mozza_detect_get_property;
+  gobject_class->finalize     = gst_mozza_detect_finalize;
+
+  g_object_class_install_property(gobject_class, PROP_MODEL_PATH, g_param_spec_string("model", "Model path", "Path to face_landmarker.task", nullptr, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_IGNORE_TS, g_param_spec_boolean("ignore-timestamps", "Force ts=0", "When true, pass 0us as timestamp into the detector", FALSE, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_LOG_EVERY, g_param_spec_uint("log-every", "Periodic log interval", "Log every N frames", 0, 1000000, 60, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_NUM_THREADS, g_param_spec_int("threads", "Number of threads", "CPU threads (0=default)", 0, 32, 4, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_MAX_FACES, g_param_spec_int("max-faces", "Max faces", "Maximum number of faces", 1, 16, 1, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_PREWARM, g_param_spec_int("prewarm", "Prewarm frames", "Synthetic inferences run at start() to avoid a first-frame stall (0=off)", 0, 16, 0, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_PREWARM_W, g_param_spec_int("prewarm-width", "Prewarm width", "Width of the synthetic prewarm frame", 16, 7680, 1280, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_PREWARM_H, g_param_spec_int("prewarm-height", "Prewarm height", "Height of the synthetic prewarm frame", 16, 4320, 720, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_DETECT_SCALE, g_param_spec_float("detect-scale", "Detection input scale", "Downscale frames by this factor before detection (landmarks stay full-frame)", 0.05f, 1.f, 1.f, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_DETECT_MAX_SIDE, g_param_spec_int("detect-max-side", "Detection max side", "Cap the longest side fed to detection in pixels (0=off)", 0, 8192, 0, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_BATCH_WINDOW_US, g_param_spec_int("batch-window-us", "Batch window", "Batch detection with other instances of the same model, waiting at most this many us (0=off; only runtimes that batch the networks, such as OpenCV-DNN, use it)", 0, 100000, 0, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_CPU_ALLOCATION, g_param_spec_string("cpu-allocation", "CPU allocation", "This instance's share of the process CPU budget (read-only)", "", G_PARAM_READABLE));
+  g_object_class_install_property(gobject_class, PROP_CPU_SET, g_param_spec_string("cpu-set", "CPU set", "CPU list (e.g. \"2-5,8\") for the streaming thread while it processes a frame, the async-detect worker and the runtime's inference workers (NULL=inherit)", nullptr, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_RT_PRIORITY, g_param_spec_int("rt-priority", "Real-time priority", "SCHED_FIFO priority for the same threads (0=inherit; needs CAP_SYS_NICE)", 0, 99, 0, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_LOCK_MEMORY, g_param_spec_boolean("lock-memory", "Lock memory", "mlockall the process once the runtime context is ready, so weights and buffers are never evicted (needs CAP_IPC_LOCK or RLIMIT_MEMLOCK)", FALSE, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_USE_META, g_param_spec_boolean("use-meta", "Use upstream landmarks", "Skip buffers that already carry landmarks (GstMozzaLandmarksMeta, e.g. from facelandmarks); model may then be omitted", TRUE, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_ASYNC_DETECT, g_param_spec_boolean("async-detect", "Asynchronous detection", "Detect on a worker thread and attach the latest finished landmarks instead of waiting for the current frame's", FALSE, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_DETECT_INTERVAL, g_param_spec_int("detect-interval", "Detection interval", "Run the detector every N frames and track the landmarks with optical flow in between (1=every frame)", 1, 300, 1, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_MOTION_GATE, g_param_spec_float("motion-gate", "Motion gate", "Reuse the last detected landmarks while the face region changes less than this mean luma difference per pixel (0=off)", 0.f, 255.f, 0.f, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_SKIP_DUPLICATES, g_param_spec_boolean("skip-duplicates", "Skip duplicate frames", "Give a frame identical to the previous one its landmarks without detecting", FALSE, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_SMOOTH, g_param_spec_float("smooth", "Smoothing", "One-Euro smoothing of the landmarks (0=off, 0.99=max); scales min-cutoff by 2 * (1 - smooth)", 0.f, 0.99f, 0.f, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_MIN_CUTOFF, g_param_spec_float("min-cutoff", "Min cutoff frequency", "One-Euro cutoff at rest in Hz: lower = less jitter, more lag", 0.001f, 100.f, 2.f, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_BETA, g_param_spec_float("beta", "Beta (cutoff slope)", "One-Euro cutoff slope: higher = less lag at high speeds", 0.f, 1.f, 0.05f, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_MAX_STALE_MS, g_param_spec_int("max-stale-ms", "Max landmark age", "With async-detect, attach no landmarks when the latest are older than this many ms (0=no limit)", 0, 10000, 250, G_PARAM_READWRITE));
+
+  gst_element_class_set_static_metadata(GST_ELEMENT_CLASS(klass), "Mozza detect", "Filter/Analyzer/Video", "Face landmarks attached as GstMozzaLandmarksMeta", "DuckSoup Lab");
+  gst_element_class_add_pad_template(GST_ELEMENT_CLASS(klass), gst_static_pad_template_get(&sink_template));
+  gst_element_class_add_pad_template(GST_ELEMENT_CLASS(klass), gst_static_pad_template_get(&src_template));
+
+  basetr_class->start = gst_mozza_detect_start;
+  basetr_class->stop  = gst_mozza_detect_stop;
+  basetr_class->transform_caps = gst_mozza_detect_transform_caps;
+  vfilter_class->set_info           = gst_mozza_detect_set_info;
+  vfilter_class->transform_frame_ip = gst_mozza_detect_transform_frame_ip;
+}
+
+static void gst_mozza_detect_init(GstMozzaDetect* self) {
+  self->model_path      = nullptr;
+  self->num_threads     = 4;
+  self->max_faces       = 1;
+  self->ignore_ts       = FALSE;
+  self->log_every       = 60;
+  self->prewarm         = 0;
+  self->prewarm_w       = 1280;
+  self->prewarm_h       = 720;
+  self->detect_scale    = 1.0f;
+  self->detect_max_side = 0;
+  self->batch_window_us = 0;
+  self->cpu_alloc       = MpCpuAllocation{};
+  self->cpu_set         = nullptr;
+  self->rt_priority     = 0;
+  self->lock_memory     = FALSE;
+  self->use_meta        = TRUE;
+  self->async_detect    = FALSE;
+  self->max_stale_ms    = 250;
+  self->detect_interval = 1;
+  self->motion_gate     = 0.f;
+  self->skip_duplicates = FALSE;
+  self->smooth          = 0.f;
+  self->min_cutoff      = 2.f;
+  self->beta            = 0.05f;
+  self->quality_queued  = FALSE;
+  self->frame_count     = 0;
+  self->policy_warned   = FALSE;
+  self->mp_ctx          = nullptr;
+}
@@ -0,0 +1,19 @@
+// gstmozzamp/gstmozzadetect.h
+// mozza_detect: face landmark detection only. Attaches a
+// GstMozzaLandmarksMeta to every buffer it detects on; mozza_warp (or any
+// other consumer of the meta) does the rest further downstream.
+#pragma once
+
+#include <gst/video/gstvideofilter.h>
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_MOZZA_DETECT (gst_mozza_detect_get_type())
+G_DECLARE_FINAL_TYPE(GstMozzaDetect, gst_mozza_detect, GST, MOZZA_DETECT, GstVideoFilter)
+
+// Sets detect-max-side and detect-interval from any thread while streaming
+// (mozza_mp adaptive-quality). The streaming thread takes them at the start
+// of its next frame; until then the properties read back the queued values.
+void gst_mozza_detect_queue_quality(GstMozzaDetect* self, gint max_side, gint interval);
+
+G_END_DECLS
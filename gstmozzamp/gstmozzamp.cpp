@@ -2,137 +2,190 @@
 // RGBA in-place.
 //
 // Element: mozza_mp
-// Props:
-//   model              : path to face_landmarker.task (string, required)
-//   deform             : path to deformation .dfm (string, optional)
-//   dfm                : alias of "deform" (string, optional; for legacy pipelines)
-//   alpha              : float, [-10..10], default 1.0
-//   mls-alpha          : float, default 1.4 (MLS rigidity parameter)
-//   mls-grid           : int, default 5 (MLS grid size in pixels; smaller=denser)
-//   warp-mode          : string, default "global" ("global" or "per-group-roi")
-//   roi-pad            : int, default 24 (padding around per-group ROI in pixels)
-//   overlay            : bool, default false (draw src/dst control points + vectors)
-//   drop               : bool, default false (drop frame when no face)
-//   show-landmarks     : bool, default false (draw all landmarks even without DFM)
-//   strict-dfm         : bool, default false (fail start if deform given but load fails)
+// A bin of mozza_detect ! mozza_warp, for pipelines written before the two
+// were split. Its properties are forwarded to the child that owns them
+// (see gstmozzadetect.cpp / gstmozzawarp.cpp for their documentation):
+//   mozza_detect       : model, threads, max-faces, ignore-timestamps, prewarm,
+//                        prewarm-width, prewarm-height, detect-scale, detect-max-side,
+//                        batch-window-us, cpu-allocation (read-only), lock-memory,
+//                        use-meta, async-detect, max-stale-ms,
+//                        detect-interval, motion-gate, smooth, min-cutoff, beta
+//   mozza_warp         : deform, dfm, alpha, mls-alpha, mls-grid, warp-mode, roi-pad,
+//                        overlay, drop, show-landmarks, no-warp, strict-dfm,
+//                        landmark-radius, landmark-color
+//   both               : log-every, cpu-set, rt-priority, skip-duplicates
+//   pipelined          : bool, default false (detect frame N+1 while frame N is warped;
+//                        only settable in the NULL state)
+//   adaptive-quality   : bool, default false (step down to cheaper settings when the
+//                        frames cannot keep up, and back up when they can; see below)
+//   quality-level      : int, read-only (0 = as configured, up to 4)
 //   force-rgb          : bool, default false (no-op; pads require RGBA; kept for parity)
-//   ignore-timestamps  : bool, default false (pass 0us into detector)
-//   log-every          : uint, default 60 (periodic log interval; 0 disables)
 //   user-id            : string, accepted but ignored (for Ducksoup uniform configs)
 //
+// Detection and warp run back to back on the streaming thread. With
+// pipelined=true a one-buffer queue between them gives the warp its own
+// thread: every frame is still warped with its own landmarks, a frame may
+// wait up to one frame interval for the warp thread, and LATENCY answers
+// include that interval. The queue forwards EOS after the frames it holds
+// and drops them on flush.
+//
+// With adaptive-quality=true the bin times each frame in both stages and
+// listens to the QoS events coming back from downstream; the children also
+// drop frames that QoS already reports late, before working on them. The
+// pressure is the larger of the processing time over the frame interval and
+// the last QoS proportion. Above kOverload for kDownFrames frames in a row
+// it takes one step down the ladder:
+//   1  mls-grid doubled
+//   2  warp-mode=per-group-roi
+//   3  detect-max-side capped at kAdaptiveMaxSide
+//   4  detect-interval doubled (at least 2)
+// Below kHeadroom for the up hold it takes one step back up. A level that
+// overloads again soon after it was restored doubles the hold before the
+// next try. Each change posts a "mozza-quality" element message with the
+// new level, the previous one, the reason and the pressure. While the level
+// is above 0 the ladder owns mls-grid, warp-mode, detect-max-side and
+// detect-interval; the configured values come back at level 0 and on stop.
+//
 // Caps: video/x-raw, format=RGBA
 
 #include <gst/gst.h>
 #include <gst/video/video.h>
-#include <gst/video/gstvideofilter.h>
-
-#include <algorithm>
-#include <cerrno>
-#include <chrono>
-#include <cmath>
-#include <cstdint>
-#include <cstring>
-#include <memory>
-#include <optional>
-#include <vector>
-
-#include <opencv2/core.hpp>
-#include <opencv2/imgproc.hpp>
-
-#include "mp_runtime.h"
-#include "mp_runtime_loader.h"
 
-#include "dfm.hpp"
-#include "deform_utils.hpp"
-#include "imgwarp/imgwarp_mls_rigid.h"
-#include <limits>   // for std::numeric_limits
+#include "gstmozzadetect.h"
+#include "gstmozzawarp.h"
 
 #ifndef PACKAGE
 #define PACKAGE "mozza_mp"
 #endif
 
-GST_DEBUG_CATEGORY_STATIC(gst_mozza_mp_debug_category);
+GST_DEBUG_CATEGORY(gst_mozza_mp_debug_category);
 #define GST_CAT_DEFAULT gst_mozza_mp_debug_category
 
 G_BEGIN_DECLS
 
 #define GST_TYPE_MOZZA_MP (gst_mozza_mp_get_type())
-G_DECLARE_FINAL_TYPE(GstMozzaMp, gst_mozza_mp, GST, MOZZA_MP, GstVideoFilter)
+G_DECLARE_FINAL_TYPE(GstMozzaMp, gst_mozza_mp, GST, MOZZA_MP, GstBin)
 
 struct _GstMozzaMp {
-  GstVideoFilter parent;
-
-  // properties
-  gchar* model_path;
-  gchar* deform_path;     // also set by "dfm"
-  gfloat   alpha;
-  gfloat   mls_alpha;
-  gint     mls_grid;
-  gboolean overlay;
-  gboolean drop;
-  gboolean show_landmarks;
-  gboolean no_warp;
-  gboolean strict_dfm;
-  gboolean force_rgb;       // no-op (pads are RGBA)
-  gboolean ignore_ts;
-  guint    log_every;
-  gchar* user_id;         // accepted but not used
-  gint     num_threads;
-  gint     max_faces;
-  gint     lm_radius;
-  guint    lm_color;
-
-  gint     warp_mode;       // WarpMode enum
-  gint     roi_pad;         // padding for per-group ROI warps
-
-  // runtime + helpers
-  MpFaceCtx* mp_ctx;
-  std::optional<Deformations> dfm;
-  std::unique_ptr<mp_imgwarp::ImgWarp_MLS_Rigid> mls;
-
-  // Stats
-  guint64 frame_count;
-
-  // Timing
-  double sum_detect_us;
-  double sum_warp_us;
-  guint64 timing_count;
-  };
+  GstBin parent;
 
+  gboolean force_rgb;       // no-op (pads are RGBA)
+  gchar*   user_id;         // accepted but not used
+  gboolean pipelined;
+
+  GstElement* detect;       // owned by the bin
+  GstElement* warp;
+  GstElement* queue;        // own ref; in the bin only when pipelined
+
+  gboolean adaptive;        // adaptive-quality (atomic)
+  gint     quality_reset;   // set by adaptive-quality=false, taken by the streaming thread (atomic)
+  // quality_lock guards the level, the base_* values and the controller
+  // state below: the warp's streaming thread, state changes and property
+  // sets all reach them.
+  GMutex   quality_lock;
+  gint     quality_level;   // QualityLevel (also read atomically)
+  // adaptive-quality: configured values of what the ladder changes, kept
+  // while the level is above 0
+  gint     base_grid;
+  gchar*   base_warp_mode;
+  gint     base_max_side;
+  gint     base_interval;
+  // adaptive-quality controller, run on the warp's src pad
+  gint64   detect_in_us;    // monotonic time the frame entered each stage
+  gint64   warp_in_us;
+  gint     detect_us;       // last frame's time in mozza_detect (atomic)
+  double   load;            // smoothed processing time / frame interval
+  GstClockTime frame_ns;    // frame interval from the caps, 0 = unknown
+  gdouble  qos_proportion;  // last upstream QoS proportion (object lock)
+  gint64   qos_us;          // when it arrived (object lock)
+  guint    over_frames;     // consecutive frames above kOverload
+  guint    under_frames;    // consecutive frames below kHeadroom
+  guint    up_hold;         // frames below kHeadroom before stepping up
+  guint64  frames;
+  guint64  last_up;         // frame of the last step up / down
+  guint64  last_down;
+};
 
 G_END_DECLS
 
-enum WarpMode {
-  WARP_GLOBAL = 0,
-  WARP_PER_GROUP_ROI = 1,
-};
-
 // ── Properties ────────────────────────────────────────────────────────────────
 enum {
   PROP_0,
-  PROP_MODEL_PATH,
-  PROP_DEFORM_PATH,
-  PROP_ALPHA,
-  PROP_OVERLAY,
-  PROP_DROP,
   PROP_USER_ID,
-  PROP_DFM_ALIAS,        // alias for "deform"
-  PROP_SHOW_LANDMARKS,
-  PROP_NO_WARP,
-  PROP_STRICT_DFM,
-  PROP_FORCE_RGB,        // NEW
-  PROP_IGNORE_TS,        // NEW
-  PROP_LOG_EVERY,        // NEW
-  PROP_NUM_THREADS,
-  PROP_MAX_FACES,
-  PROP_LM_RADIUS,
-  PROP_LM_COLOR,
-  PROP_MLS_ALPHA,
-  PROP_MLS_GRID,
-  PROP_WARP_MODE,
-  PROP_ROI_PAD,
+  PROP_FORCE_RGB,
+  PROP_PIPELINED,
+  PROP_ADAPTIVE,
+  PROP_QUALITY_LEVEL,
+  PROP_FORWARDED,        // first forwarded property; see kForwarded
+};
+
+enum Target { TO_DETECT = 1, TO_WARP = 2, TO_BOTH = TO_DETECT | TO_WARP };
+
+struct ForwardedProp {
+  const char* name;
+  int         target;   // Target; reads come from the first child named
+};
+
+// Installed in this order from PROP_FORWARDED on, with the child's pspec.
+static const ForwardedProp kForwarded[] = {
+  {"model",             TO_DETECT},
+  {"threads",           TO_DETECT},
+  {"max-faces",         TO_DETECT},
+  {"ignore-timestamps", TO_DETECT},
+  {"prewarm",           TO_DETECT},
+  {"prewarm-width",     TO_DETECT},
+  {"prewarm-height",    TO_DETECT},
+  {"detect-scale",      TO_DETECT},
+  {"detect-max-side",   TO_DETECT},
+  {"batch-window-us",   TO_DETECT},
+  {"cpu-allocation",    TO_DETECT},
+  {"lock-memory",       TO_DETECT},
+  {"use-meta",          TO_DETECT},
+  {"async-detect",      TO_DETECT},
+  {"max-stale-ms",      TO_DETECT},
+  {"detect-interval",   TO_DETECT},
+  {"motion-gate",       TO_DETECT},
+  {"smooth",            TO_DETECT},
+  {"min-cutoff",        TO_DETECT},
+  {"beta",              TO_DETECT},
+  {"deform",            TO_WARP},
+  {"dfm",               TO_WARP},
+  {"alpha",             TO_WARP},
+  {"mls-alpha",         TO_WARP},
+  {"mls-grid",          TO_WARP},
+  {"warp-mode",         TO_WARP},
+  {"roi-pad",           TO_WARP},
+  {"overlay",           TO_WARP},
+  {"drop",              TO_WARP},
+  {"show-landmarks",    TO_WARP},
+  {"no-warp",           TO_WARP},
+  {"strict-dfm",        TO_WARP},
+  {"landmark-radius",   TO_WARP},
+  {"landmark-color",    TO_WARP},
+  {"log-every",         TO_BOTH},
+  {"cpu-set",           TO_BOTH},
+  {"rt-priority",       TO_BOTH},
+  {"skip-duplicates",   TO_BOTH},
 };
 
+// adaptive-quality ladder; each level keeps the cheaper settings below it.
+enum QualityLevel {
+  QUALITY_FULL = 0,       // as configured
+  QUALITY_COARSE_GRID,    // mls-grid doubled
+  QUALITY_ROI_WARP,       // warp-mode=per-group-roi
+  QUALITY_SMALL_DETECT,   // detect-max-side capped at kAdaptiveMaxSide
+  QUALITY_SKIP_DETECT,    // detect-interval doubled
+  QUALITY_LOWEST = QUALITY_SKIP_DETECT,
+};
+
+static constexpr gint     kAdaptiveMaxSide = 480;
+static constexpr double   kOverload   = 0.95;  // pressure that steps down
+static constexpr double   kHeadroom   = 0.6;   // pressure that allows a step up
+static constexpr guint    kDownFrames = 10;
+static constexpr guint    kUpFrames   = 90;    // initial up hold
+static constexpr guint    kMaxUpFrames = 16 * kUpFrames;
+static constexpr gint64   kQosMaxAgeUs = 500000;  // older QoS proportions are ignored
+
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE(
   "sink", GST_PAD_SINK, GST_PAD_ALWAYS,
   GST_STATIC_CAPS("video/x-raw(memory:GLMemory), format=RGBA; video/x-raw, format=RGBA"));
@@ -140,569 +193,449 @@ static GstStaticPadTemplate src_template  = GST_STATIC_PAD_TEMPLATE(
   "src",  GST_PAD_SRC,  GST_PAD_ALWAYS,
   GST_STATIC_CAPS("video/x-raw(memory:GLMemory), format=RGBA; video/x-raw, format=RGBA"));
 
-G_DEFINE_TYPE(GstMozzaMp, gst_mozza_mp, GST_TYPE_VIDEO_FILTER)
-
-// ── Utils ────────────────────────────────────────────────────────────────────
-static inline void put_px(uint8_t* p, uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
-  const uint8_t dr = p[0], dg = p[1], db = p[2], da = p[3];
-  const uint16_t ai = a;
-  p[0] = static_cast<uint8_t>((dr * (255 - ai) + r * ai) / 255);
-  p[1] = static_cast<uint8_t>((dg * (255 - ai) + g * ai) / 255);
-  p[2] = static_cast<uint8_t>((db * (255 - ai) + b * ai) / 255);
-  p[3] = std::max<uint8_t>(da, a);
-}
-static inline int clampi(int v, int lo, int hi) { return (v < lo) ? lo : (v > hi ? hi : v); }
-
-static void draw_dot(uint8_t* base, int W, int H, int stride, int cx, int cy,
-                     int radius, uint32_t rgba) {
-  if (radius < 1) radius = 1;
-  const uint8_t R = (rgba >> 24) & 0xFF;
-  const uint8_t G = (rgba >> 16) & 0xFF;
-  const uint8_t B = (rgba >>  8) & 0xFF;
-  const uint8_t A = (rgba >>  0) & 0xFF;
-
-  const int x0 = std::max(0, cx - radius), x1 = std::min(W - 1, cx + radius);
-  const int y0 = std::max(0, cy - radius), y1 = std::min(H - 1, cy + radius);
-  const int r2 = radius * radius;
-
-  for (int y = y0; y <= y1; ++y) {
-    const int dy = y - cy;
-    for (int x = x0; x <= x1; ++x) {
-      const int dx = x - cx;
-      if (dx*dx + dy*dy <= r2) {
-        uint8_t* p = base + y * stride + x * 4;
-        put_px(p, R, G, B, A);
-      }
+G_DEFINE_TYPE(GstMozzaMp, gst_mozza_mp, GST_TYPE_BIN)
+
+// Same name, nick, blurb, range and default as the child's property, so
+// gst-inspect and saved pipelines see what mozza_mp always exposed.
+static GParamSpec* clone_pspec(GParamSpec* p) {
+  const gchar* name  = g_param_spec_get_name(p);
+  const gchar* nick  = g_param_spec_get_nick(p);
+  const gchar* blurb = g_param_spec_get_blurb(p);
+  const GParamFlags flags = static_cast<GParamFlags>(p->flags & G_PARAM_READWRITE);
+  switch (G_PARAM_SPEC_VALUE_TYPE(p)) {
+    case G_TYPE_STRING:
+      return g_param_spec_string(name, nick, blurb, G_PARAM_SPEC_STRING(p)->default_value, flags);
+    case G_TYPE_BOOLEAN:
+      return g_param_spec_boolean(name, nick, blurb, G_PARAM_SPEC_BOOLEAN(p)->default_value, flags);
+    case G_TYPE_INT: {
+      auto* q = G_PARAM_SPEC_INT(p);
+      return g_param_spec_int(name, nick, blurb, q->minimum, q->maximum, q->default_value, flags);
     }
-  }
-}
-
-static void draw_line(uint8_t* base, int W, int H, int stride,
-                      int x0, int y0, int x1, int y1, uint32_t rgba)
-{
-  const uint8_t R = (rgba >> 24) & 0xFF;
-  const uint8_t G = (rgba >> 16) & 0xFF;
-  const uint8_t B = (rgba >>  8) & 0xFF;
-  const uint8_t A = (rgba >>  0) & 0xFF;
-
-  int dx = std::abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
-  int dy = -std::abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
-  int err = dx + dy, e2;
-
-  for (;;) {
-    if ((unsigned)x0 < (unsigned)W && (unsigned)y0 < (unsigned)H) {
-      uint8_t* p = base + y0 * stride + x0 * 4;
-      put_px(p, R, G, B, A);
+    case G_TYPE_UINT: {
+      auto* q = G_PARAM_SPEC_UINT(p);
+      return g_param_spec_uint(name, nick, blurb, q->minimum, q->maximum, q->default_value, flags);
     }
-    if (x0 == x1 && y0 == y1) break;
-    e2 = 2 * err;
-    if (e2 >= dy) { err += dy; x0 += sx; }
-    if (e2 <= dx) { err += dx; y0 += sy; }
+    case G_TYPE_FLOAT: {
+      auto* q = G_PARAM_SPEC_FLOAT(p);
+      return g_param_spec_float(name, nick, blurb, q->minimum, q->maximum, q->default_value, flags);
+    }
+    default:
+      g_assert_not_reached();
+      return nullptr;
   }
 }
 
-static void log_landmark_stats(GstMozzaMp* self, const MpFace& f0, int W, int H) {
-  if (f0.landmarks_count <= 0) return;
-  float minx=1e9f, miny=1e9f, maxx=-1e9f, maxy=-1e9f;
-  for (int i=0;i<f0.landmarks_count;++i) {
-    minx = std::min(minx, f0.landmarks[i].x);
-    miny = std::min(miny, f0.landmarks[i].y);
-    maxx = std::max(maxx, f0.landmarks[i].x);
-    maxy = std::max(maxy, f0.landmarks[i].y);
+// Links detect ! warp, or detect ! queue ! warp when pipelined.
+static void set_pipelined(GstMozzaMp* self, gboolean pipelined) {
+  if (pipelined == self->pipelined) return;
+  if (!self->queue) {
+    GST_WARNING_OBJECT(self, "pipelined ignored: the queue element is not available");
+    return;
+  }
+  if (pipelined) {
+    gst_element_unlink(self->detect, self->warp);
+    gst_bin_add(GST_BIN(self), self->queue);
+    gst_element_link_many(self->detect, self->queue, self->warp, nullptr);
+  } else {
+    gst_element_unlink_many(self->detect, self->queue, self->warp, nullptr);
+    gst_bin_remove(GST_BIN(self), self->queue);
+    gst_element_link(self->detect, self->warp);
   }
-  GST_INFO_OBJECT(self, "landmarks: count=%d norm[min(%.3f,%.3f) max(%.3f,%.3f)] px[min(%d,%d) max(%d,%d)]",
-                  f0.landmarks_count, minx, miny, maxx, maxy,
-                  (int)std::floor(minx*W), (int)std::floor(miny*H),
-                  (int)std::ceil (maxx*W), (int)std::ceil (maxy*H));
+  self->pipelined = pipelined;
 }
 
-// ── GObject props ────────────────────────────────────────────────────────────
-static void gst_mozza_mp_set_property(GObject* obj, guint prop_id,
-                                      const GValue* value, GParamSpec* pspec) {
-  auto* self = GST_MOZZA_MP(obj);
-  switch (prop_id) {
-    case PROP_MODEL_PATH:
-      g_free(self->model_path);
-      self->model_path = g_value_dup_string(value);
-      GST_INFO_OBJECT(self, "prop:model = %s", self->model_path ? self->model_path : "(null)");
-      break;
-    case PROP_DEFORM_PATH:
-    case PROP_DFM_ALIAS:  // alias: "dfm"
-      g_free(self->deform_path);
-      self->deform_path = g_value_dup_string(value);
-      GST_INFO_OBJECT(self, "prop:deform/dfm = %s", self->deform_path ? self->deform_path : "(null)");
-      break;
-    case PROP_ALPHA:
-      self->alpha = g_value_get_float(value);
-      GST_INFO_OBJECT(self, "prop:alpha = %.3f", self->alpha);
-      break;
-    case PROP_MLS_ALPHA:
-      self->mls_alpha = g_value_get_float(value);
-      if (self->mls) self->mls->alpha = self->mls_alpha;
-      GST_INFO_OBJECT(self, "prop:mls-alpha = %.3f", self->mls_alpha);
-      break;
-    case PROP_MLS_GRID:
-      self->mls_grid = g_value_get_int(value);
-      if (self->mls) self->mls->gridSize = self->mls_grid;
-      GST_INFO_OBJECT(self, "prop:mls-grid = %d", self->mls_grid);
-      break;
-    case PROP_WARP_MODE: {
-      const char* s = g_value_get_string(value);
-      if (s && g_ascii_strcasecmp(s, "per-group-roi") == 0)
-        self->warp_mode = WARP_PER_GROUP_ROI;
-      else
-        self->warp_mode = WARP_GLOBAL;
-      GST_INFO_OBJECT(self, "prop:warp-mode = %s",
-                      self->warp_mode == WARP_PER_GROUP_ROI ? "per-group-roi" : "global");
-      break;
-    }
-    case PROP_ROI_PAD:
-      self->roi_pad = g_value_get_int(value);
-      GST_INFO_OBJECT(self, "prop:roi-pad = %d", self->roi_pad);
-      break;
-    case PROP_OVERLAY:
-      self->overlay = g_value_get_boolean(value);
-      GST_INFO_OBJECT(self, "prop:overlay = %s", self->overlay ? "true" : "false");
-      break;
-    case PROP_DROP:
-      self->drop = g_value_get_boolean(value);
-      GST_INFO_OBJECT(self, "prop:drop = %s", self->drop ? "true" : "false");
-      break;
-    case PROP_SHOW_LANDMARKS:
-      self->show_landmarks = g_value_get_boolean(value);
-      GST_INFO_OBJECT(self, "prop:show-landmarks = %s", self->show_landmarks ? "true" : "false");
-      break;
-    case PROP_NO_WARP:
-      self->no_warp = g_value_get_boolean(value);
-      GST_INFO_OBJECT(self, "prop:no-warp = %s", self->no_warp ? "true" : "false");
-      break;
-    case PROP_STRICT_DFM:
-      self->strict_dfm = g_value_get_boolean(value);
-      GST_INFO_OBJECT(self, "prop:strict-dfm = %s", self->strict_dfm ? "true" : "false");
-      break;
-    case PROP_FORCE_RGB:
-      self->force_rgb = g_value_get_boolean(value);
-      GST_WARNING_OBJECT(self, "prop:force-rgb = %s (no-op)", self->force_rgb ? "true" : "false");
-      break;
-    case PROP_IGNORE_TS:
-      self->ignore_ts = g_value_get_boolean(value);
-      GST_INFO_OBJECT(self, "prop:ignore-timestamps = %s", self->ignore_ts ? "true" : "false");
-      break;
-    case PROP_LOG_EVERY:
-      self->log_every = g_value_get_uint(value);
-      GST_INFO_OBJECT(self, "prop:log-every = %u", self->log_every);
-      break;
-    case PROP_NUM_THREADS:
-      self->num_threads = g_value_get_int(value);
-      GST_INFO_OBJECT(self, "prop:threads = %d", self->num_threads);
-      break;
-    case PROP_MAX_FACES:
-      self->max_faces = g_value_get_int(value);
-      GST_INFO_OBJECT(self, "prop:max-faces = %d", self->max_faces);
-      break;
-    case PROP_LM_RADIUS:
-      self->lm_radius = g_value_get_int(value);
-      GST_INFO_OBJECT(self, "prop:landmark-radius = %d", self->lm_radius);
-      break;
-    case PROP_LM_COLOR:
-      self->lm_color = g_value_get_uint(value);
-      GST_INFO_OBJECT(self, "prop:landmark-color = 0x%08X", self->lm_color);
-      break;
-    case PROP_USER_ID:
-      g_free(self->user_id);
-      self->user_id = g_value_dup_string(value);
-      break;
-    default: G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
-  }
+// ── adaptive-quality ─────────────────────────────────────────────────────────
+// Queues the children's settings for a ladder level, from the base values.
+// Each child takes them at the start of its next frame. Called with
+// quality_lock held.
+static void queue_level(GstMozzaMp* self, gint level) {
+  const gint max_side = self->base_max_side > 0 ? MIN(self->base_max_side, kAdaptiveMaxSide)
+                                                : kAdaptiveMaxSide;
+  gst_mozza_warp_queue_quality(GST_MOZZA_WARP(self->warp),
+      level >= QUALITY_COARSE_GRID ? MIN(2 * self->base_grid, 100) : self->base_grid,
+      level >= QUALITY_ROI_WARP ? "per-group-roi" : self->base_warp_mode);
+  gst_mozza_detect_queue_quality(GST_MOZZA_DETECT(self->detect),
+      level >= QUALITY_SMALL_DETECT ? max_side : self->base_max_side,
+      level >= QUALITY_SKIP_DETECT ? CLAMP(2 * self->base_interval, 2, 300) : self->base_interval);
 }
 
-static void gst_mozza_mp_get_property(GObject* obj, guint prop_id,
-                                      GValue* value, GParamSpec* pspec) {
-  auto* self = GST_MOZZA_MP(obj);
-  switch (prop_id) {
-    case PROP_MODEL_PATH:      g_value_set_string (value, self->model_path);  break;
-    case PROP_DEFORM_PATH:     g_value_set_string (value, self->deform_path); break;
-    case PROP_DFM_ALIAS:       g_value_set_string (value, self->deform_path); break; // alias
-    case PROP_ALPHA:           g_value_set_float  (value, self->alpha);       break;
-    case PROP_MLS_ALPHA:       g_value_set_float  (value, self->mls_alpha);   break;
-    case PROP_MLS_GRID:        g_value_set_int    (value, self->mls_grid);    break;
-    case PROP_WARP_MODE:
-      g_value_set_string(value, self->warp_mode == WARP_PER_GROUP_ROI ? "per-group-roi" : "global");
-      break;
-    case PROP_ROI_PAD:         g_value_set_int    (value, self->roi_pad);    break;
-    case PROP_OVERLAY:         g_value_set_boolean(value, self->overlay);     break;
-    case PROP_DROP:            g_value_set_boolean(value, self->drop);        break;
-    case PROP_STRICT_DFM:      g_value_set_boolean(value, self->strict_dfm); break;
-    case PROP_SHOW_LANDMARKS:  g_value_set_boolean(value, self->show_landmarks); break;
-    case PROP_NO_WARP:         g_value_set_boolean(value, self->no_warp);        break;
-    case PROP_FORCE_RGB:       g_value_set_boolean(value, self->force_rgb);      break;
-    case PROP_IGNORE_TS:       g_value_set_boolean(value, self->ignore_ts);      break;
-    case PROP_LOG_EVERY:       g_value_set_uint   (value, self->log_every);      break;
-    case PROP_NUM_THREADS:     g_value_set_int    (value, self->num_threads);     break;
-    case PROP_MAX_FACES:       g_value_set_int    (value, self->max_faces);       break;
-    case PROP_LM_RADIUS:       g_value_set_int    (value, self->lm_radius);       break;
-    case PROP_LM_COLOR:        g_value_set_uint   (value, self->lm_color);        break;
-    case PROP_USER_ID:         g_value_set_string (value, self->user_id);     break;
-    default: G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+// Moves to a ladder level. The configured values are read when leaving
+// level 0 and written back on returning to it. Called with quality_lock
+// held; returns the "mozza-quality" message for the caller to post once it
+// has released the lock, or nullptr when the level did not change.
+static GstMessage* set_quality_level(GstMozzaMp* self, gint level, const gchar* reason,
+                                     double pressure) {
+  const gint prev = self->quality_level;
+  if (level == prev) return nullptr;
+  if (prev == QUALITY_FULL) {
+    g_clear_pointer(&self->base_warp_mode, g_free);
+    g_object_get(self->warp, "mls-grid", &self->base_grid, "warp-mode", &self->base_warp_mode, nullptr);
+    g_object_get(self->detect, "detect-max-side", &self->base_max_side,
+                 "detect-interval", &self->base_interval, nullptr);
   }
+  queue_level(self, level);
+  if (level == QUALITY_FULL) g_clear_pointer(&self->base_warp_mode, g_free);
+
+  g_atomic_int_set(&self->quality_level, level);
+  self->over_frames = self->under_frames = 0;
+  GST_INFO_OBJECT(self, "quality level %d -> %d (%s, pressure %.2f)", prev, level, reason, pressure);
+  return gst_message_new_element(GST_OBJECT(self),
+      gst_structure_new("mozza-quality",
+                        "level",    G_TYPE_INT,    level,
+                        "previous", G_TYPE_INT,    prev,
+                        "reason",   G_TYPE_STRING, reason,
+                        "pressure", G_TYPE_DOUBLE, pressure, nullptr));
 }
 
-// ── Lifecycle ────────────────────────────────────────────────────────────────
-static gboolean gst_mozza_mp_start(GstBaseTransform* base) {
-  auto* self = GST_MOZZA_MP(base);
-
-  GST_INFO_OBJECT(self, "start()");
-
-  // --- DIAGNOSTICS: Check environment variables for Threading ---
-  const char* omp = std::getenv("OMP_NUM_THREADS");
-  const char* xnn = std::getenv("XNNPACK_NUM_THREADS");
-  const char* tflite = std::getenv("TFLITE_NUM_THREADS");
-  GST_INFO_OBJECT(self, "--- THREADING DIAGNOSTICS ---");
-  GST_INFO_OBJECT(self, "Requested via Gst property: threads=%d", self->num_threads);
-  GST_INFO_OBJECT(self, "Env OMP_NUM_THREADS:     %s", omp ? omp : "UNSET (Defaults to 1)");
-  GST_INFO_OBJECT(self, "Env XNNPACK_NUM_THREADS: %s", xnn ? xnn : "UNSET (Defaults to 1)");
-  GST_INFO_OBJECT(self, "Env TFLITE_NUM_THREADS:  %s", tflite ? tflite : "UNSET (Defaults to 1)");
-  GST_INFO_OBJECT(self, "-----------------------------");
-
-  if (!self->model_path || !g_file_test(self->model_path, G_FILE_TEST_EXISTS)) {
-    GST_ERROR_OBJECT(self, "missing/invalid model: set model=/path/to/face_landmarker.task");
-    return FALSE;
-  }
-  if (!MpApiOK()) {
-    GST_ERROR_OBJECT(self, "mp_runtime loader not initialized");
-    return FALSE;
-  }
+// Back to level 0 under the lock, then reports it.
+static void restore_quality(GstMozzaMp* self, const gchar* reason) {
+  g_mutex_lock(&self->quality_lock);
+  GstMessage* msg = set_quality_level(self, QUALITY_FULL, reason, 0.0);
+  g_mutex_unlock(&self->quality_lock);
+  if (msg) gst_element_post_message(GST_ELEMENT(self), msg);
+}
 
-  MpFaceLandmarkerOptions opts{};
-  opts.model_path       = self->model_path;
-  opts.max_faces        = self->max_faces;
-  opts.with_blendshapes = 0;
-  opts.with_geometry    = 0;
-  opts.num_threads      = self->num_threads;
-  opts.delegate         = "cpu";
-
-  self->mp_ctx = nullptr;
-  auto t0 = std::chrono::steady_clock::now();
-  int rc = MpApi().face_create(&opts, &self->mp_ctx);
-  auto t1 = std::chrono::steady_clock::now();
-  auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
-
-  if (rc != 0 || !self->mp_ctx) {
-    const char* loader_err = mp_runtime_loader::last_error();
-    GST_FIXME_OBJECT(self, "mp_face_landmarker_create failed (rc=%d) in %lld ms. Error: %s", rc, (long long)ms, loader_err ? loader_err : "(none)");
-    return FALSE;
-  }
-  
-  self->mls = std::make_unique<mp_imgwarp::ImgWarp_MLS_Rigid>();
-  self->mls->gridSize = self->mls_grid;
-  self->mls->preScale = true;
-  self->mls->alpha    = self->mls_alpha;
-
-  if (self->deform_path) {
-    errno = 0;
-    self->dfm = load_dfm(self->deform_path);
-    if (!self->dfm) {
-      if (self->strict_dfm) return FALSE;
+// A forwarded property the ladder also changes was set while the level is
+// above 0: it becomes the configured value (restored at level 0) and the
+// current level is applied on top of it again.
+static void refresh_base(GstMozzaMp* self, const gchar* name, const GValue* value) {
+  g_mutex_lock(&self->quality_lock);
+  if (self->quality_level != QUALITY_FULL) {
+    bool known = true;
+    if (g_str_equal(name, "mls-grid")) {
+      self->base_grid = g_value_get_int(value);
+    } else if (g_str_equal(name, "warp-mode")) {
+      g_free(self->base_warp_mode);
+      self->base_warp_mode = g_value_dup_string(value);
+    } else if (g_str_equal(name, "detect-max-side")) {
+      self->base_max_side = g_value_get_int(value);
+    } else if (g_str_equal(name, "detect-interval")) {
+      self->base_interval = g_value_get_int(value);
+    } else {
+      known = false;
     }
+    if (known) queue_level(self, self->quality_level);
   }
-
-  self->frame_count = 0;
-  self->sum_detect_us = 0;
-  self->sum_warp_us = 0;
-  self->timing_count = 0;
-  return TRUE;
+  g_mutex_unlock(&self->quality_lock);
 }
 
-static gboolean gst_mozza_mp_stop(GstBaseTransform* base) {
-  auto* self = GST_MOZZA_MP(base);
-  if (self->mp_ctx) { MpApi().face_close(&self->mp_ctx); self->mp_ctx = nullptr; }
-  self->mls.reset();
-  self->dfm.reset();
-  return TRUE;
+static void reset_adaptive(GstMozzaMp* self) {
+  self->detect_in_us = self->warp_in_us = 0;
+  g_atomic_int_set(&self->detect_us, 0);
+  self->load = 0.0;
+  self->frame_ns = 0;
+  GST_OBJECT_LOCK(self);
+  self->qos_proportion = 0.0;
+  self->qos_us = 0;
+  GST_OBJECT_UNLOCK(self);
+  g_mutex_lock(&self->quality_lock);
+  self->over_frames = self->under_frames = 0;
+  self->up_hold = kUpFrames;
+  self->frames = self->last_up = self->last_down = 0;
+  g_mutex_unlock(&self->quality_lock);
 }
 
-static void gst_mozza_mp_finalize(GObject* object) {
-  auto* self = GST_MOZZA_MP(object);
-  if (self->mp_ctx) { MpApi().face_close(&self->mp_ctx); self->mp_ctx = nullptr; }
-  g_clear_pointer(&self->model_path,  g_free);
-  g_clear_pointer(&self->deform_path, g_free);
-  g_clear_pointer(&self->user_id,     g_free);
-  G_OBJECT_CLASS(gst_mozza_mp_parent_class)->finalize(object);
+// One step per call at most, after each frame leaves mozza_warp. Called
+// with quality_lock held; returns what set_quality_level returned.
+static GstMessage* adapt_quality(GstMozzaMp* self, gint64 now_us) {
+  const gint64 warp_us = self->warp_in_us ? now_us - self->warp_in_us : 0;
+  const gint64 detect_us = g_atomic_int_get(&self->detect_us);
+  self->frames += 1;
+
+  double pressure = 0.0;
+  if (self->frame_ns > 0) {
+    // Pipelined, the stages overlap and the slower one sets the pace.
+    const gint64 busy_us = self->pipelined ? MAX(detect_us, warp_us) : detect_us + warp_us;
+    const double load = busy_us * 1000.0 / self->frame_ns;
+    self->load = self->frames > 1 ? 0.8 * self->load + 0.2 * load : load;
+    pressure = self->load;
+  }
+  GST_OBJECT_LOCK(self);
+  if (now_us - self->qos_us < kQosMaxAgeUs) pressure = MAX(pressure, self->qos_proportion);
+  GST_OBJECT_UNLOCK(self);
+
+  self->over_frames  = pressure > kOverload ? self->over_frames + 1 : 0;
+  self->under_frames = pressure < kHeadroom ? self->under_frames + 1 : 0;
+  const gint level = self->quality_level;
+  if (self->over_frames >= kDownFrames && level < QUALITY_LOWEST) {
+    // Overloaded again soon after a step up: that level does not fit yet.
+    if (self->last_up && self->frames - self->last_up < 2 * self->up_hold)
+      self->up_hold = MIN(2 * self->up_hold, kMaxUpFrames);
+    self->last_down = self->frames;
+    return set_quality_level(self, level + 1, "overload", pressure);
+  } else if (self->under_frames >= self->up_hold && level > QUALITY_FULL) {
+    if (self->frames - self->last_down > 2 * self->up_hold)
+      self->up_hold = MAX(self->up_hold / 2, kUpFrames);
+    self->last_up = self->frames;
+    return set_quality_level(self, level - 1, "headroom", pressure);
+  }
+  return nullptr;
 }
 
-static gboolean gst_mozza_mp_set_info(GstVideoFilter*, GstCaps*, GstVideoInfo*, GstCaps*, GstVideoInfo*) { return TRUE; }
-
-static inline void add_identity_anchors(const cv::Rect& roi, std::vector<cv::Point2f>& src, std::vector<cv::Point2f>& dst, int inset = 2) {
-  if (roi.width <= 0 || roi.height <= 0) return;
-  const float x0 = (float)(roi.x + inset);
-  const float y0 = (float)(roi.y + inset);
-  const float x1 = (float)(roi.x + roi.width  - 1 - inset);
-  const float y1 = (float)(roi.y + roi.height - 1 - inset);
-  const cv::Point2f corners[4] = { {x0, y0}, {x1, y0}, {x1, y1}, {x0, y1} };
-  for (int i = 0; i < 4; ++i) { src.push_back(corners[i]); dst.push_back(corners[i]); }
+static GstPadProbeReturn detect_sink_probe(GstPad*, GstPadProbeInfo*, gpointer user) {
+  auto* self = GST_MOZZA_MP(user);
+  if (g_atomic_int_get(&self->adaptive)) self->detect_in_us = g_get_monotonic_time();
+  return GST_PAD_PROBE_OK;
 }
 
-static inline uint64_t fnv1a64(const uint8_t* p, size_t n, uint64_t seed = 14695981039346656037ULL) {
-  uint64_t h = seed; const uint64_t prime = 1099511628211ULL;
-  for (size_t i = 0; i < n; ++i) { h ^= static_cast<uint64_t>(p[i]); h *= prime; }
-  return h;
+static GstPadProbeReturn detect_src_probe(GstPad*, GstPadProbeInfo*, gpointer user) {
+  auto* self = GST_MOZZA_MP(user);
+  if (g_atomic_int_get(&self->adaptive) && self->detect_in_us)
+    g_atomic_int_set(&self->detect_us, (gint)(g_get_monotonic_time() - self->detect_in_us));
+  return GST_PAD_PROBE_OK;
 }
 
-static inline uint64_t hash_frame_rgba(const uint8_t* base, int W, int H, int stride) {
-  uint64_t h = 0ULL;
-  for (int y = 0; y < H; ++y) h = fnv1a64(base + static_cast<size_t>(y) * static_cast<size_t>(stride), static_cast<size_t>(W) * 4u, h);
-  return h;
+static GstPadProbeReturn warp_sink_probe(GstPad*, GstPadProbeInfo*, gpointer user) {
+  auto* self = GST_MOZZA_MP(user);
+  if (g_atomic_int_get(&self->adaptive)) self->warp_in_us = g_get_monotonic_time();
+  return GST_PAD_PROBE_OK;
 }
 
-static double mean_abs_rgb_diff(const cv::Mat& a, const cv::Mat& b) {
-  cv::Mat diff; cv::absdiff(a, b, diff); cv::Scalar m = cv::mean(diff);
-  double acc = 0.0; for (int c = 0; c < diff.channels(); ++c) acc += m[c];
-  return acc / std::max(1, diff.channels());
+static GstPadProbeReturn warp_src_probe(GstPad*, GstPadProbeInfo*, gpointer user) {
+  auto* self = GST_MOZZA_MP(user);
+  if (g_atomic_int_compare_and_exchange(&self->quality_reset, TRUE, FALSE))
+    restore_quality(self, "disabled");
+  if (!g_atomic_int_get(&self->adaptive)) return GST_PAD_PROBE_OK;
+  g_mutex_lock(&self->quality_lock);
+  GstMessage* msg = adapt_quality(self, g_get_monotonic_time());
+  g_mutex_unlock(&self->quality_lock);
+  if (msg) gst_element_post_message(GST_ELEMENT(self), msg);
+  return GST_PAD_PROBE_OK;
 }
 
-static bool env_flag(const char* name) { const char* s = std::getenv(name); return s && *s && s[0] != '0'; }
-
-static void overlay_landmarks(uint8_t* data, int W, int H, int stride,
-                              const std::vector<cv::Point2f>& L,
-                              int radius, uint32_t rgba) {
-  const uint8_t R = (rgba >> 24) & 0xFF;
-  const uint8_t G = (rgba >> 16) & 0xFF;
-  const uint8_t B = (rgba >>  8) & 0xFF;
-  const uint8_t A = (rgba >>  0) & 0xFF;
-
-  for (const auto& p : L) {
-    int cx = (int)p.x;
-    int cy = (int)p.y;
-    const int x0 = std::max(0, cx - radius), x1 = std::min(W - 1, cx + radius);
-    const int y0 = std::max(0, cy - radius), y1 = std::min(H - 1, cy + radius);
-    const int r2 = radius * radius;
-
-    for (int y = y0; y <= y1; ++y) {
-      uint8_t* row = data + y * stride;
-      for (int x = x0; x <= x1; ++x) {
-        if ((x - cx) * (x - cx) + (y - cy) * (y - cy) <= r2) {
-          uint8_t* pix = row + x * 4;
-          const uint16_t ai = A;
-          pix[0] = static_cast<uint8_t>((pix[0] * (255 - ai) + R * ai) / 255);
-          pix[1] = static_cast<uint8_t>((pix[1] * (255 - ai) + G * ai) / 255);
-          pix[2] = static_cast<uint8_t>((pix[2] * (255 - ai) + B * ai) / 255);
-          pix[3] = std::max<uint8_t>(pix[3], A);
-        }
-      }
+// Caps going downstream give the frame interval; QoS events coming back
+// from the sink give its proportion (above 1 = frames arrive too slowly).
+static GstPadProbeReturn warp_src_event_probe(GstPad*, GstPadProbeInfo* info, gpointer user) {
+  auto* self = GST_MOZZA_MP(user);
+  GstEvent* event = GST_PAD_PROBE_INFO_EVENT(info);
+  if (GST_EVENT_TYPE(event) == GST_EVENT_CAPS) {
+    GstCaps* caps;
+    GstVideoInfo vinfo;
+    gst_event_parse_caps(event, &caps);
+    self->frame_ns = 0;
+    if (gst_video_info_from_caps(&vinfo, caps) && GST_VIDEO_INFO_FPS_N(&vinfo) > 0)
+      self->frame_ns = gst_util_uint64_scale_int(GST_SECOND, GST_VIDEO_INFO_FPS_D(&vinfo),
+                                                 GST_VIDEO_INFO_FPS_N(&vinfo));
+  } else if (GST_EVENT_TYPE(event) == GST_EVENT_QOS) {
+    GstQOSType type;
+    gdouble proportion;
+    GstClockTimeDiff diff;
+    GstClockTime ts;
+    gst_event_parse_qos(event, &type, &proportion, &diff, &ts);
+    if (type != GST_QOS_TYPE_THROTTLE) {
+      GST_OBJECT_LOCK(self);
+      self->qos_proportion = proportion;
+      self->qos_us = g_get_monotonic_time();
+      GST_OBJECT_UNLOCK(self);
     }
   }
+  return GST_PAD_PROBE_OK;
 }
 
-static GstFlowReturn gst_mozza_mp_transform_frame_ip(GstVideoFilter* vf,
-                                                    GstVideoFrame* f) {
-
-  auto* self = GST_MOZZA_MP(vf);
-  if (!self->mp_ctx) return GST_FLOW_OK;
-
-  self->frame_count++;
-
-  const int W      = GST_VIDEO_FRAME_WIDTH(f);
-  const int H      = GST_VIDEO_FRAME_HEIGHT(f);
-  const int stride = GST_VIDEO_FRAME_PLANE_STRIDE(f, 0);
-  auto* data       = static_cast<uint8_t*>(GST_VIDEO_FRAME_PLANE_DATA(f, 0));
-
-  cv::Mat img_rgba(H, W, CV_8UC4, data, static_cast<size_t>(stride));
-  if (img_rgba.empty()) return GST_FLOW_OK;
-
-  MpImage img{};
-  img.data   = static_cast<const uint8_t*>(data);
-  img.width  = W;
-  img.height = H;
-  img.stride = stride;
-  img.format = MP_IMAGE_RGBA8888;
-
-  GstClockTime pts = GST_BUFFER_PTS(f->buffer);
-  int64_t ts_us;
-  if (self->ignore_ts) {
-      ts_us = (int64_t)self->frame_count * 33333LL;
-  } else {
-      ts_us = (int64_t)GST_TIME_AS_USECONDS(pts);
-  }
-
-  if (self->frame_count <= 5) {
-    GST_INFO_OBJECT(self, "FRAME %llu TRACKER DIAGNOSTIC | pts: %" GST_TIME_FORMAT " | synthetic ts_us: %lld | ts_ms sent to MP: %lld",
-                    (unsigned long long)self->frame_count, GST_TIME_ARGS(pts), (long long)ts_us, (long long)(ts_us / 1000));
-  }
-
-  const bool do_timing =
-      self->log_every > 0 &&
-      gst_debug_category_get_threshold(GST_CAT_DEFAULT) >= GST_LEVEL_INFO;
-
-  std::chrono::steady_clock::time_point t_detect_start, t_detect_end, t_warp_end;
-
-  if (do_timing) t_detect_start = std::chrono::steady_clock::now();
-
-  MpFaceResult out;
-  int rc = MpApi().face_detect(self->mp_ctx, &img, ts_us, &out);
-
-  if (do_timing) t_detect_end = std::chrono::steady_clock::now();
-
-  if (rc != 0) { MpApi().face_free_result(&out); return GST_FLOW_OK; }
-
-  if (out.faces_count == 0) {
-    MpApi().face_free_result(&out);
-    if (self->drop) return GST_BASE_TRANSFORM_FLOW_DROPPED;
-    return GST_FLOW_OK;
-  }
+// Turning it off only raises quality_reset: the streaming thread puts the
+// configured values back before its next frame (or the next stop does).
+static void set_adaptive(GstMozzaMp* self, gboolean adaptive) {
+  g_atomic_int_set(&self->adaptive, adaptive);
+  // Late frames are dropped before detection or warp instead of at the sink.
+  gst_base_transform_set_qos_enabled(GST_BASE_TRANSFORM(self->detect), adaptive);
+  gst_base_transform_set_qos_enabled(GST_BASE_TRANSFORM(self->warp), adaptive);
+  if (!adaptive) g_atomic_int_set(&self->quality_reset, TRUE);
+}
 
-  const MpFace& f0 = out.faces[0];
-  std::vector<cv::Point2f> L; L.reserve(f0.landmarks_count);
-  for (int i = 0; i < f0.landmarks_count; ++i) L.emplace_back(f0.landmarks[i].x * W, f0.landmarks[i].y * H);
-
-  // Export landmarks for comparison/validation
-  if (const char* lm_out = std::getenv("LANDMARK_OUTPUT_FILE")) {
-    if (FILE* lmf = std::fopen(lm_out, "a")) {
-      GST_LOG_OBJECT(self, "Dumping landmarks to %s", lm_out);
-      std::fprintf(lmf, "Frame %llu Face 0:\n", (unsigned long long)self->frame_count);
-      for (const auto& p : L)
-        std::fprintf(lmf, "%.6f,%.6f,0.000000\n", p.x / (float)W, p.y / (float)H);
-      std::fclose(lmf);
+// ── GObject props ────────────────────────────────────────────────────────────
+static void gst_mozza_mp_set_property(GObject* obj, guint prop_id,
+                                      const GValue* value, GParamSpec* pspec) {
+  auto* self = GST_MOZZA_MP(obj);
+  switch (prop_id) {
+    case PROP_FORCE_RGB:
+      self->force_rgb = g_value_get_boolean(value);
+      GST_WARNING_OBJECT(self, "prop:force-rgb = %s (no-op)", self->force_rgb ? "true" : "false");
+      break;
+    case PROP_USER_ID:
+      g_free(self->user_id);
+      self->user_id = g_value_dup_string(value);
+      break;
+    case PROP_PIPELINED:
+      if (GST_STATE(self) != GST_STATE_NULL) {
+        GST_WARNING_OBJECT(self, "prop:pipelined can only be changed in the NULL state");
+        break;
+      }
+      set_pipelined(self, g_value_get_boolean(value));
+      GST_INFO_OBJECT(self, "prop:pipelined = %d", self->pipelined);
+      break;
+    case PROP_ADAPTIVE:
+      set_adaptive(self, g_value_get_boolean(value));
+      GST_INFO_OBJECT(self, "prop:adaptive-quality = %d", self->adaptive);
+      break;
+    default: {
+      const guint i = prop_id - PROP_FORWARDED;
+      if (prop_id < PROP_FORWARDED || i >= G_N_ELEMENTS(kForwarded)) {
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+        break;
+      }
+      if (kForwarded[i].target & TO_DETECT) g_object_set_property(G_OBJECT(self->detect), kForwarded[i].name, value);
+      if (kForwarded[i].target & TO_WARP)   g_object_set_property(G_OBJECT(self->warp),   kForwarded[i].name, value);
+      refresh_base(self, kForwarded[i].name, value);
     }
   }
+}
 
-  // 4) Warp
-  if (self->dfm && !self->no_warp) {
-    if (self->mls) {
-      std::vector<std::vector<cv::Point2f>> srcGroups, dstGroups;
-      build_groups_from_dfm(*self->dfm, L, self->alpha, srcGroups, dstGroups);
-      if (!srcGroups.empty()) {
-        if (self->warp_mode == WARP_PER_GROUP_ROI) {
-          for (size_t g = 0; g < srcGroups.size(); ++g) compute_MLS_on_ROI(img_rgba, *self->mls, srcGroups[g], dstGroups[g], self->roi_pad);
-        } else {
-          std::vector<cv::Point2f> src, dst;
-          for (size_t g = 0; g < srcGroups.size(); ++g) { src.insert(src.end(), srcGroups[g].begin(), srcGroups[g].end()); dst.insert(dst.end(), dstGroups[g].begin(), dstGroups[g].end()); }
-          add_identity_anchors(cv::Rect(0, 0, W, H), src, dst, 2);
-          cv::Mat warped = self->mls->setAllAndGenerate(img_rgba, src, dst, img_rgba.cols, img_rgba.rows);
-          if (!warped.empty()) warped.copyTo(img_rgba);
-        }
+static void gst_mozza_mp_get_property(GObject* obj, guint prop_id,
+                                      GValue* value, GParamSpec* pspec) {
+  auto* self = GST_MOZZA_MP(obj);
+  switch (prop_id) {
+    case PROP_FORCE_RGB:       g_value_set_boolean(value, self->force_rgb); break;
+    case PROP_USER_ID:         g_value_set_string (value, self->user_id);   break;
+    case PROP_PIPELINED:       g_value_set_boolean(value, self->pipelined); break;
+    case PROP_ADAPTIVE:        g_value_set_boolean(value, self->adaptive);  break;
+    case PROP_QUALITY_LEVEL:   g_value_set_int    (value, g_atomic_int_get(&self->quality_level)); break;
+    default: {
+      const guint i = prop_id - PROP_FORWARDED;
+      if (prop_id < PROP_FORWARDED || i >= G_N_ELEMENTS(kForwarded)) {
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+        break;
       }
+      GstElement* child = (kForwarded[i].target & TO_DETECT) ? self->detect : self->warp;
+      g_object_get_property(G_OBJECT(child), kForwarded[i].name, value);
     }
   }
+}
 
-  if (do_timing) {
-    t_warp_end = std::chrono::steady_clock::now();
-    
-    auto us_diff = [](std::chrono::steady_clock::time_point a,
-                      std::chrono::steady_clock::time_point b) -> double {
-      return (double)std::chrono::duration_cast<std::chrono::microseconds>(b - a).count();
-    };
-    self->sum_detect_us += us_diff(t_detect_start, t_detect_end);
-    self->sum_warp_us   += us_diff(t_detect_end,   t_warp_end);
-    self->timing_count++;
-
-    if (self->timing_count % self->log_every == 0) {
-      double n = (double)self->log_every;
-      double detect_ms = self->sum_detect_us / n / 1000.0;
-      double warp_ms   = self->sum_warp_us   / n / 1000.0;
-      double total_ms  = detect_ms + warp_ms;
-      GST_INFO_OBJECT(self,
-          "TIMING frame=%llu (window avg)  MP-detect=%.2fms  warp=%.2fms  total=%.2fms  (%.0f fps)",
-          (unsigned long long)self->timing_count,
-          detect_ms, warp_ms, total_ms,
-          total_ms > 0.0 ? 1000.0 / total_ms : 0.0);
-      self->sum_detect_us = 0; self->sum_warp_us = 0;
-    }
-  }
+static void gst_mozza_mp_finalize(GObject* object) {
+  auto* self = GST_MOZZA_MP(object);
+  g_clear_pointer(&self->user_id, g_free);
+  g_clear_pointer(&self->base_warp_mode, g_free);
+  g_mutex_clear(&self->quality_lock);
+  gst_clear_object(&self->queue);
+  G_OBJECT_CLASS(gst_mozza_mp_parent_class)->finalize(object);
+}
 
-  // Final draw pass: force bright green on raw buffer
-  if (self->show_landmarks) {
-    // DEBUG: Red square top-left
-    for (int y=0; y<50; y++) {
-      for (int x=0; x<50; x++) {
-        uint8_t* p = data + y*stride + x*4;
-        p[0]=255; p[1]=0; p[2]=0; p[3]=255;
-      }
-    }
-    for (const auto& p : L) {
-      int cx = (int)p.x, cy = (int)p.y;
-      int R = 5;
-      for (int dy = -R; dy <= R; dy++) {
-        for (int dx = -R; dx <= R; dx++) {
-          int x = cx + dx, y = cy + dy;
-          if (x >= 0 && x < W && y >= 0 && y < H) {
-            uint8_t* pix = data + y * stride + x * 4;
-            pix[0] = 0; pix[1] = 255; pix[2] = 0; pix[3] = 255; // PURE GREEN
-          }
-        }
-      }
-    }
+static GstStateChangeReturn gst_mozza_mp_change_state(GstElement* element,
+                                                      GstStateChange transition) {
+  auto* self = GST_MOZZA_MP(element);
+  if (transition == GST_STATE_CHANGE_READY_TO_PAUSED) reset_adaptive(self);
+  const GstStateChangeReturn ret =
+      GST_ELEMENT_CLASS(gst_mozza_mp_parent_class)->change_state(element, transition);
+  // Streaming has stopped: the next start begins at the configured quality.
+  if (transition == GST_STATE_CHANGE_PAUSED_TO_READY) {
+    g_atomic_int_set(&self->quality_reset, FALSE);
+    restore_quality(self, "stopped");
   }
-
-  MpApi().face_free_result(&out);
-  return GST_FLOW_OK;
+  return ret;
 }
 
 static void gst_mozza_mp_class_init(GstMozzaMpClass* klass) {
-  GST_DEBUG_CATEGORY_INIT(gst_mozza_mp_debug_category, "mozza_mp", 0, "Mozza MP (runtime loader)");
   auto* gobject_class = G_OBJECT_CLASS(klass);
-  auto* basetr_class  = GST_BASE_TRANSFORM_CLASS(klass);
-  auto* vfilter_class = GST_VIDEO_FILTER_CLASS(klass);
 
   gobject_class->set_property = gst_mozza_mp_set_property;
   gobject_class->get_property = gst_mozza_mp_get_property;
   gobject_class->finalize     = gst_mozza_mp_finalize;
+  GST_ELEMENT_CLASS(klass)->change_state = gst_mozza_mp_change_state;
 
-  g_object_class_install_property(gobject_class, PROP_MODEL_PATH, g_param_spec_string("model", "Model path", "Path to face_landmarker.task", nullptr, G_PARAM_READWRITE));
-  g_object_class_install_property(gobject_class, PROP_DEFORM_PATH, g_param_spec_string("deform", "Deformation file (.dfm)", "Path to deformation file with barycentric rules", nullptr, G_PARAM_READWRITE));
-  g_object_class_install_property(gobject_class, PROP_DFM_ALIAS, g_param_spec_string("dfm", "Deformation file (.dfm) [alias]", "Alias for 'deform'", nullptr, G_PARAM_READWRITE));
-  g_object_class_install_property(gobject_class, PROP_ALPHA, g_param_spec_float("alpha", "Smile intensity multiplicator", "Scales the intensity of the deformation", -10.f, 10.f, 1.f, G_PARAM_READWRITE));
-  g_object_class_install_property(gobject_class, PROP_OVERLAY, g_param_spec_boolean("overlay", "Debug overlay", "Draw src/dst control points and vectors", FALSE, G_PARAM_READWRITE));
-  g_object_class_install_property(gobject_class, PROP_DROP, g_param_spec_boolean("drop", "Drop on no face", "Drop frames when no face is detected", FALSE, G_PARAM_READWRITE));
-  g_object_class_install_property(gobject_class, PROP_SHOW_LANDMARKS, g_param_spec_boolean("show-landmarks", "Draw landmarks", "Draw all detected landmarks", FALSE, G_PARAM_READWRITE));
-  g_object_class_install_property(gobject_class, PROP_NO_WARP, g_param_spec_boolean("no-warp", "No warp", "Disable warping", FALSE, G_PARAM_READWRITE));
-  g_object_class_install_property(gobject_class, PROP_STRICT_DFM, g_param_spec_boolean("strict-dfm", "Fail when DFM fails to load", "If true and deform path fails, start() fails", FALSE, G_PARAM_READWRITE));
   g_object_class_install_property(gobject_class, PROP_FORCE_RGB, g_param_spec_boolean("force-rgb", "Accept property for parity", "No-op", FALSE, G_PARAM_READWRITE));
-  g_object_class_install_property(gobject_class, PROP_IGNORE_TS, g_param_spec_boolean("ignore-timestamps", "Force ts=0", "When true, pass 0us as timestamp into the detector", FALSE, G_PARAM_READWRITE));
-  g_object_class_install_property(gobject_class, PROP_LOG_EVERY, g_param_spec_uint("log-every", "Periodic log interval", "Log every N frames", 0, 1000000, 60, G_PARAM_READWRITE));
-  g_object_class_install_property(gobject_class, PROP_NUM_THREADS, g_param_spec_int("threads", "Number of threads", "CPU threads (0=default)", 0, 32, 4, G_PARAM_READWRITE));
-  g_object_class_install_property(gobject_class, PROP_MAX_FACES, g_param_spec_int("max-faces", "Max faces", "Maximum number of faces", 1, 16, 1, G_PARAM_READWRITE));
-  g_object_class_install_property(gobject_class, PROP_LM_RADIUS, g_param_spec_int("landmark-radius", "Landmark dot radius", "Radius", 1, 10, 2, G_PARAM_READWRITE));
-  g_object_class_install_property(gobject_class, PROP_LM_COLOR, g_param_spec_uint("landmark-color", "Landmark dot color", "Packed RGBA color", 0, G_MAXUINT, 0x0066CCFFu, G_PARAM_READWRITE));
-  g_object_class_install_property(gobject_class, PROP_MLS_ALPHA, g_param_spec_float("mls-alpha", "MLS alpha", "Rigidity parameter", 0.f, 10.f, 1.4f, G_PARAM_READWRITE));
-  g_object_class_install_property(gobject_class, PROP_MLS_GRID, g_param_spec_int("mls-grid", "MLS grid size", "Grid size in pixels", 1, 100, 5, G_PARAM_READWRITE));
-  g_object_class_install_property(gobject_class, PROP_WARP_MODE, g_param_spec_string("warp-mode", "Warp mode", "global or per-group-roi", "global", G_PARAM_READWRITE));
-  g_object_class_install_property(gobject_class, PROP_ROI_PAD, g_param_spec_int("roi-pad", "ROI padding", "Padding around ROI", 0, 200, 24, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_PIPELINED, g_param_spec_boolean("pipelined", "Pipelined detect/warp", "Detect frame N+1 while frame N is warped, at up to one frame of added latency (NULL state only)", FALSE, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_ADAPTIVE, g_param_spec_boolean("adaptive-quality", "Adaptive quality", "Step down to cheaper warp and detection settings while frames cannot keep up, and back up when they can", FALSE, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_QUALITY_LEVEL, g_param_spec_int("quality-level", "Quality level", "Current adaptive-quality step (0 = as configured)", QUALITY_FULL, QUALITY_LOWEST, QUALITY_FULL, G_PARAM_READABLE));
   g_object_class_install_property(gobject_class, PROP_USER_ID, g_param_spec_string("user-id", "User ID", "Opaque user identifier", nullptr, G_PARAM_READWRITE));
 
+  auto* detect_class = static_cast<GObjectClass*>(g_type_class_ref(GST_TYPE_MOZZA_DETECT));
+  auto* warp_class   = static_cast<GObjectClass*>(g_type_class_ref(GST_TYPE_MOZZA_WARP));
+  for (guint i = 0; i < G_N_ELEMENTS(kForwarded); ++i) {
+    GObjectClass* owner = (kForwarded[i].target & TO_DETECT) ? detect_class : warp_class;
+    GParamSpec* p = g_object_class_find_property(owner, kForwarded[i].name);
+    g_assert(p);
+    g_object_class_install_property(gobject_class, PROP_FORWARDED + i, clone_pspec(p));
+  }
+  g_type_class_unref(warp_class);
+  g_type_class_unref(detect_class);
+
   gst_element_class_set_static_metadata(GST_ELEMENT_CLASS(klass), "Mozza MP", "Filter/Effect/Video", "DFM-driven MLS", "DuckSoup Lab");
   gst_element_class_add_pad_template(GST_ELEMENT_CLASS(klass), gst_static_pad_template_get(&sink_template));
   gst_element_class_add_pad_template(GST_ELEMENT_CLASS(klass), gst_static_pad_template_get(&src_template));
+}
 
-  basetr_class->start = gst_mozza_mp_start;
-  basetr_class->stop  = gst_mozza_mp_stop;
-  vfilter_class->set_info           = gst_mozza_mp_set_info;
-  vfilter_class->transform_frame_ip = gst_mozza_mp_transform_frame_ip;
+// Pipelined, a frame can wait up to one frame interval for the warp thread;
+// that interval is added to the latency reported upstream of the bin.
+static gboolean gst_mozza_mp_src_query(GstPad* pad, GstObject* parent, GstQuery* query) {
+  if (!gst_proxy_pad_query_default(pad, parent, query)) return FALSE;
+  auto* self = GST_MOZZA_MP(parent);
+  if (GST_QUERY_TYPE(query) != GST_QUERY_LATENCY || !self->pipelined) return TRUE;
+
+  GstClockTime frame = GST_CLOCK_TIME_NONE;
+  if (GstCaps* caps = gst_pad_get_current_caps(pad)) {
+    GstVideoInfo info;
+    if (gst_video_info_from_caps(&info, caps) && GST_VIDEO_INFO_FPS_N(&info) > 0)
+      frame = gst_util_uint64_scale_int(GST_SECOND, GST_VIDEO_INFO_FPS_D(&info),
+                                        GST_VIDEO_INFO_FPS_N(&info));
+    gst_caps_unref(caps);
+  }
+  if (!GST_CLOCK_TIME_IS_VALID(frame)) {
+    GST_DEBUG_OBJECT(self, "pipelined: no framerate yet, latency left unchanged");
+    return TRUE;
+  }
+
+  gboolean live;
+  GstClockTime min, max;
+  gst_query_parse_latency(query, &live, &min, &max);
+  min += frame;
+  if (GST_CLOCK_TIME_IS_VALID(max)) max += frame;
+  gst_query_set_latency(query, live, min, max);
+  GST_DEBUG_OBJECT(self, "pipelined: latency +%" GST_TIME_FORMAT, GST_TIME_ARGS(frame));
+  return TRUE;
 }
 
 static void gst_mozza_mp_init(GstMozzaMp* self) {
-  self->model_path     = nullptr;
-  self->deform_path    = nullptr;
-  self->alpha          = 1.0f;
-  self->mls_alpha      = 1.4f;
-  self->mls_grid       = 5;
-  self->overlay        = FALSE;
-  self->drop           = FALSE;
-  self->show_landmarks = FALSE;
-  self->no_warp        = FALSE;
-  self->strict_dfm     = FALSE;
-  self->force_rgb      = FALSE;
-  self->ignore_ts      = FALSE;
-  self->log_every      = 60;
-  self->user_id        = nullptr;
-  self->num_threads     = 4;
-  self->max_faces      = 1;
-  self->lm_radius      = 3;
-  self->lm_color       = 0x00FF00FFu; // green
-  self->warp_mode      = WARP_GLOBAL;
-  self->roi_pad        = 24;
-  self->frame_count    = 0;
-  self->mp_ctx         = nullptr;
+  self->force_rgb = FALSE;
+  self->user_id   = nullptr;
+  self->pipelined = FALSE;
+  self->adaptive  = FALSE;
+  self->quality_reset = FALSE;
+  g_mutex_init(&self->quality_lock);
+  self->quality_level = QUALITY_FULL;
+  self->base_warp_mode = nullptr;
+  reset_adaptive(self);
+
+  // One buffer: detection runs at most one frame ahead of the warp.
+  self->queue = gst_element_factory_make("queue", "pipeline");
+  if (self->queue) {
+    gst_object_ref_sink(self->queue);
+    g_object_set(self->queue, "max-size-buffers", 1u, "max-size-bytes", 0u,
+                 "max-size-time", (guint64)0, nullptr);
+  }
+
+  self->detect = GST_ELEMENT(g_object_new(GST_TYPE_MOZZA_DETECT, "name", "detect", nullptr));
+  self->warp   = GST_ELEMENT(g_object_new(GST_TYPE_MOZZA_WARP,   "name", "warp",   nullptr));
+  gst_bin_add_many(GST_BIN(self), self->detect, self->warp, nullptr);
+  gst_element_link(self->detect, self->warp);
+
+  GstElementClass* klass = GST_ELEMENT_GET_CLASS(self);
+  GstPad* sink = gst_element_get_static_pad(self->detect, "sink");
+  GstPad* src  = gst_element_get_static_pad(self->warp,   "src");
+  gst_element_add_pad(GST_ELEMENT(self), gst_ghost_pad_new_from_template(
+      "sink", sink, gst_element_class_get_pad_template(klass, "sink")));
+  GstPad* ghost_src = gst_ghost_pad_new_from_template(
+      "src", src, gst_element_class_get_pad_template(klass, "src"));
+  gst_pad_set_query_function(ghost_src, gst_mozza_mp_src_query);
+  gst_element_add_pad(GST_ELEMENT(self), ghost_src);
+
+  // adaptive-quality timing; the probes return at once while it is off.
+  GstPad* detect_src = gst_element_get_static_pad(self->detect, "src");
+  GstPad* warp_sink  = gst_element_get_static_pad(self->warp,   "sink");
+  gst_pad_add_probe(sink,       GST_PAD_PROBE_TYPE_BUFFER, detect_sink_probe, self, nullptr);
+  gst_pad_add_probe(detect_src, GST_PAD_PROBE_TYPE_BUFFER, detect_src_probe,  self, nullptr);
+  gst_pad_add_probe(warp_sink,  GST_PAD_PROBE_TYPE_BUFFER, warp_sink_probe,   self, nullptr);
+  gst_pad_add_probe(src,        GST_PAD_PROBE_TYPE_BUFFER, warp_src_probe,    self, nullptr);
+  gst_pad_add_probe(src,        GST_PAD_PROBE_TYPE_EVENT_BOTH, warp_src_event_probe, self, nullptr);
+  gst_object_unref(detect_src);
+  gst_object_unref(warp_sink);
+  gst_object_unref(sink);
+  gst_object_unref(src);
 }
 
-static gboolean plugin_init(GstPlugin* plugin) { return gst_element_register(plugin, "mozza_mp", GST_RANK_NONE, GST_TYPE_MOZZA_MP); }
-GST_PLUGIN_DEFINE(GST_VERSION_MAJOR, GST_VERSION_MINOR, mozzamp, "Facial deformation via mp_runtime", plugin_init, "1.02", "LGPL", "mozza_mp", "https://ducksouplab.com")
\ No newline at end of file
+static gboolean plugin_init(GstPlugin* plugin) {
+  GST_DEBUG_CATEGORY_INIT(gst_mozza_mp_debug_category, "mozza_mp", 0, "Mozza MP (runtime loader)");
+  return gst_element_register(plugin, "mozza_mp",     GST_RANK_NONE, GST_TYPE_MOZZA_MP) &&
+         gst_element_register(plugin, "mozza_detect", GST_RANK_NONE, GST_TYPE_MOZZA_DETECT) &&
+         gst_element_register(plugin, "mozza_warp",   GST_RANK_NONE, GST_TYPE_MOZZA_WARP);
+}
+GST_PLUGIN_DEFINE(GST_VERSION_MAJOR, GST_VERSION_MINOR, mozzamp, "Facial deformation via mp_runtime", plugin_init, "1.02", "LGPL", "mozza_mp", "https://ducksouplab.com")
@@ -0,0 +1,662 @@
+// DFM-driven MLS warp from landmarks carried on the buffer
+// (GstMozzaLandmarksMeta, attached by mozza_detect or facelandmarks).
+// RGBA in-place. Runs no detection of its own.
+//
+// Element: mozza_warp
+// Props:
+//   deform             : path to deformation .dfm (string, optional), or a comma-separated
+//                        list of them, each with an optional @weight ("a.dfm@0.5,b.dfm");
+//                        the list is merged and warped in one pass
+//   dfm                : alias of "deform" (string, optional; for legacy pipelines)
+//   alpha              : float, [-10..10], default 1.0
+//   mls-alpha          : float, default 1.4 (MLS rigidity parameter)
+//   mls-grid           : int, default 5 (MLS grid size in pixels; smaller=denser)
+//   warp-mode          : string, default "global" ("global" or "per-group-roi")
+//   roi-pad            : int, default 24 (padding around per-group ROI in pixels)
+//   overlay            : bool, default false (draw src/dst control points + vectors)
+//   drop               : bool, default false (drop frames whose landmarks have no face)
+//   show-landmarks     : bool, default false (draw all landmarks even without DFM)
+//   no-warp            : bool, default false (disable warping)
+//   strict-dfm         : bool, default false (fail start if deform given but load fails)
+//   landmark-radius    : int, default 3
+//   landmark-color     : uint, default 0x00FF00FF (packed RGBA)
+//   log-every          : uint, default 60 (periodic TIMING log interval; 0 disables)
+//   cpu-set            : string, default NULL (CPU list for the streaming thread while
+//                        it warps a frame)
+//   rt-priority        : int, [0..99], default 0 (SCHED_FIFO priority for the same
+//                        time; 0 = leave the policy alone)
+//   skip-duplicates    : bool, default false (re-emit the previous output for a frame
+//                        identical to the previous input, with the same landmarks)
+//
+// Caps: video/x-raw, format=RGBA
+
+#include "gstmozzawarp.h"
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "mp_thread_policy.h"
+#include "mozza_landmarks_meta.h"
+
+#include "dfm.hpp"
+#include "deform_utils.hpp"
+#include "imgwarp/imgwarp_mls_rigid.h"
+#include "timing_window.hpp"
+#include "frame_hash.hpp"
+
+GST_DEBUG_CATEGORY_EXTERN(gst_mozza_mp_debug_category);
+#define GST_CAT_DEFAULT gst_mozza_mp_debug_category
+
+// skip-duplicates: the previous input and, once it has repeated, a copy of
+// what it left as, in a buffer of the element's own. A repeat goes out as a
+// new buffer sharing that copy's memory.
+struct WarpDupCache {
+  uint64_t hash = 0;           // previous input, 0 = none
+  std::vector<MpLandmark> lm;  // landmarks it was warped with
+  gint serial = 0;             // prop_serial it was warped with
+  GstBuffer* out = nullptr;    // its output, nullptr until it repeats
+  uint64_t in_hash = 0;        // hash of the input being processed, 0 = none
+  GstBuffer* served = nullptr; // repeat made by prepare_output_buffer, not mapped
+  void clear() {
+    hash = 0;
+    if (out) gst_buffer_unref(out);
+    out = nullptr;
+  }
+  ~WarpDupCache() { clear(); }
+};
+
+struct _GstMozzaWarp {
+  GstVideoFilter parent;
+
+  // properties
+  gchar*   deform_path;     // also set by "dfm"
+  gfloat   alpha;
+  gfloat   mls_alpha;
+  gint     mls_grid;
+  gint     warp_mode;       // WarpMode enum
+  gint     roi_pad;         // padding for per-group ROI warps
+  gboolean overlay;
+  gboolean drop;
+  gboolean show_landmarks;
+  gboolean no_warp;
+  gboolean strict_dfm;
+  gint     lm_radius;
+  guint    lm_color;
+  guint    log_every;
+  gchar*   cpu_set;         // CPU list for the streaming thread, NULL = inherit
+  gint     rt_priority;     // SCHED_FIFO priority, 0 = inherit
+  gboolean skip_duplicates;
+  gint     prop_serial;     // bumped by every property change (atomic)
+  // mozza_mp adaptive-quality: mls-grid / warp-mode queued from another
+  // thread (object lock), taken before the next frame.
+  gint     quality_queued;  // atomic
+  gint     queued_grid;
+  gint     queued_mode;
+
+  // helpers
+  std::optional<Deformations> dfm;
+  std::unique_ptr<mp_imgwarp::ImgWarp_MLS_Rigid> mls;
+  std::unique_ptr<WarpDupCache> dup;
+  std::vector<cv::Point2f> lm_px;   // face 0 in pixels, reused between frames
+  DfmPoints dfm_pts;                // control points, reused between frames
+
+  // Stats
+  guint64 frame_count;
+  gboolean policy_warned;   // a thread policy failure was posted since start
+
+  // Field reuse: the whole-frame MLS field held by mls is valid for these
+  // landmarks and settings (frames from mozza_detect motion-gate)
+  std::vector<MpLandmark> field_lm;
+  gboolean field_valid;
+  gint     field_w, field_h;
+  gfloat   field_alpha, field_mls_alpha;
+  gint     field_grid;
+
+  // Timing
+  TimingWindow window;
+  guint    field_reused;    // over the window
+  guint    dup_hits;        // over the window
+};
+
+enum WarpMode {
+  WARP_GLOBAL = 0,
+  WARP_PER_GROUP_ROI = 1,
+};
+
+// ── Properties ────────────────────────────────────────────────────────────────
+enum {
+  PROP_0,
+  PROP_DEFORM_PATH,
+  PROP_DFM_ALIAS,        // alias for "deform"
+  PROP_ALPHA,
+  PROP_MLS_ALPHA,
+  PROP_MLS_GRID,
+  PROP_WARP_MODE,
+  PROP_ROI_PAD,
+  PROP_OVERLAY,
+  PROP_DROP,
+  PROP_SHOW_LANDMARKS,
+  PROP_NO_WARP,
+  PROP_STRICT_DFM,
+  PROP_LM_RADIUS,
+  PROP_LM_COLOR,
+  PROP_LOG_EVERY,
+  PROP_CPU_SET,
+  PROP_RT_PRIORITY,
+  PROP_SKIP_DUPLICATES,
+};
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE(
+  "sink", GST_PAD_SINK, GST_PAD_ALWAYS,
+  GST_STATIC_CAPS("video/x-raw(memory:GLMemory), format=RGBA; video/x-raw, format=RGBA"));
+static GstStaticPadTemplate src_template  = GST_STATIC_PAD_TEMPLATE(
+  "src",  GST_PAD_SRC,  GST_PAD_ALWAYS,
+  GST_STATIC_CAPS("video/x-raw(memory:GLMemory), format=RGBA; video/x-raw, format=RGBA"));
+
+G_DEFINE_TYPE(GstMozzaWarp, gst_mozza_warp, GST_TYPE_VIDEO_FILTER)
+
+// ── GObject props ────────────────────────────────────────────────────────────
+static void gst_mozza_warp_set_property(GObject* obj, guint prop_id,
+                                        const GValue* value, GParamSpec* pspec) {
+  auto* self = GST_MOZZA_WARP(obj);
+  g_atomic_int_inc(&self->prop_serial);  // outputs cached by skip-duplicates are stale
+  switch (prop_id) {
+    case PROP_DEFORM_PATH:
+    case PROP_DFM_ALIAS:  // alias: "dfm"
+      g_free(self->deform_path);
+      self->deform_path = g_value_dup_string(value);
+      GST_INFO_OBJECT(self, "prop:deform/dfm = %s", self->deform_path ? self->deform_path : "(null)");
+      break;
+    case PROP_ALPHA:
+      self->alpha = g_value_get_float(value);
+      GST_INFO_OBJECT(self, "prop:alpha = %.3f", self->alpha);
+      break;
+    case PROP_MLS_ALPHA:
+      self->mls_alpha = g_value_get_float(value);
+      if (self->mls) self->mls->alpha = self->mls_alpha;
+      GST_INFO_OBJECT(self, "prop:mls-alpha = %.3f", self->mls_alpha);
+      break;
+    case PROP_MLS_GRID:
+      self->mls_grid = g_value_get_int(value);
+      if (self->mls) self->mls->gridSize = self->mls_grid;
+      GST_INFO_OBJECT(self, "prop:mls-grid = %d", self->mls_grid);
+      break;
+    case PROP_WARP_MODE: {
+      const char* s = g_value_get_string(value);
+      if (s && g_ascii_strcasecmp(s, "per-group-roi") == 0)
+        self->warp_mode = WARP_PER_GROUP_ROI;
+      else
+        self->warp_mode = WARP_GLOBAL;
+      GST_INFO_OBJECT(self, "prop:warp-mode = %s",
+                      self->warp_mode == WARP_PER_GROUP_ROI ? "per-group-roi" : "global");
+      break;
+    }
+    case PROP_ROI_PAD:
+      self->roi_pad = g_value_get_int(value);
+      GST_INFO_OBJECT(self, "prop:roi-pad = %d", self->roi_pad);
+      break;
+    case PROP_OVERLAY:
+      self->overlay = g_value_get_boolean(value);
+      GST_INFO_OBJECT(self, "prop:overlay = %s", self->overlay ? "true" : "false");
+      break;
+    case PROP_DROP:
+      self->drop = g_value_get_boolean(value);
+      GST_INFO_OBJECT(self, "prop:drop = %s", self->drop ? "true" : "false");
+      break;
+    case PROP_SHOW_LANDMARKS:
+      self->show_landmarks = g_value_get_boolean(value);
+      GST_INFO_OBJECT(self, "prop:show-landmarks = %s", self->show_landmarks ? "true" : "false");
+      break;
+    case PROP_NO_WARP:
+      self->no_warp = g_value_get_boolean(value);
+      GST_INFO_OBJECT(self, "prop:no-warp = %s", self->no_warp ? "true" : "false");
+      break;
+    case PROP_STRICT_DFM:
+      self->strict_dfm = g_value_get_boolean(value);
+      GST_INFO_OBJECT(self, "prop:strict-dfm = %s", self->strict_dfm ? "true" : "false");
+      break;
+    case PROP_LM_RADIUS:
+      self->lm_radius = g_value_get_int(value);
+      GST_INFO_OBJECT(self, "prop:landmark-radius = %d", self->lm_radius);
+      break;
+    case PROP_LM_COLOR:
+      self->lm_color = g_value_get_uint(value);
+      GST_INFO_OBJECT(self, "prop:landmark-color = 0x%08X", self->lm_color);
+      break;
+    case PROP_LOG_EVERY:
+      self->log_every = g_value_get_uint(value);
+      GST_INFO_OBJECT(self, "prop:log-every = %u", self->log_every);
+      break;
+    case PROP_CPU_SET:
+      g_free(self->cpu_set);
+      self->cpu_set = g_value_dup_string(value);
+      GST_INFO_OBJECT(self, "prop:cpu-set = %s", self->cpu_set ? self->cpu_set : "(inherit)");
+      break;
+    case PROP_RT_PRIORITY:
+      self->rt_priority = g_value_get_int(value);
+      GST_INFO_OBJECT(self, "prop:rt-priority = %d", self->rt_priority);
+      break;
+    case PROP_SKIP_DUPLICATES:
+      self->skip_duplicates = g_value_get_boolean(value);
+      GST_INFO_OBJECT(self, "prop:skip-duplicates = %s", self->skip_duplicates ? "true" : "false");
+      break;
+    default: G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+  }
+}
+
+static void gst_mozza_warp_get_property(GObject* obj, guint prop_id,
+                                        GValue* value, GParamSpec* pspec) {
+  auto* self = GST_MOZZA_WARP(obj);
+  switch (prop_id) {
+    case PROP_DEFORM_PATH:     g_value_set_string (value, self->deform_path); break;
+    case PROP_DFM_ALIAS:       g_value_set_string (value, self->deform_path); break; // alias
+    case PROP_ALPHA:           g_value_set_float  (value, self->alpha);       break;
+    case PROP_MLS_ALPHA:       g_value_set_float  (value, self->mls_alpha);   break;
+    case PROP_MLS_GRID:
+      GST_OBJECT_LOCK(self);
+      g_value_set_int(value, self->quality_queued ? self->queued_grid : self->mls_grid);
+      GST_OBJECT_UNLOCK(self);
+      break;
+    case PROP_WARP_MODE: {
+      GST_OBJECT_LOCK(self);
+      const gint mode = self->quality_queued ? self->queued_mode : self->warp_mode;
+      GST_OBJECT_UNLOCK(self);
+      g_value_set_string(value, mode == WARP_PER_GROUP_ROI ? "per-group-roi" : "global");
+      break;
+    }
+    case PROP_ROI_PAD:         g_value_set_int    (value, self->roi_pad);        break;
+    case PROP_OVERLAY:         g_value_set_boolean(value, self->overlay);        break;
+    case PROP_DROP:            g_value_set_boolean(value, self->drop);           break;
+    case PROP_SHOW_LANDMARKS:  g_value_set_boolean(value, self->show_landmarks); break;
+    case PROP_NO_WARP:         g_value_set_boolean(value, self->no_warp);        break;
+    case PROP_STRICT_DFM:      g_value_set_boolean(value, self->strict_dfm);     break;
+    case PROP_LM_RADIUS:       g_value_set_int    (value, self->lm_radius);      break;
+    case PROP_LM_COLOR:        g_value_set_uint   (value, self->lm_color);       break;
+    case PROP_LOG_EVERY:       g_value_set_uint   (value, self->log_every);      break;
+    case PROP_CPU_SET:         g_value_set_string (value, self->cpu_set);        break;
+    case PROP_RT_PRIORITY:     g_value_set_int    (value, self->rt_priority);    break;
+    case PROP_SKIP_DUPLICATES: g_value_set_boolean(value, self->skip_duplicates); break;
+    default: G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, pspec);
+  }
+}
+
+// Posts a thread policy failure once per start; the parts that could be
+// applied still are.
+static void report_thread_policy(GstMozzaWarp* self, const std::string& err) {
+  if (self->policy_warned) return;
+  self->policy_warned = TRUE;
+  GST_ELEMENT_WARNING(self, RESOURCE, SETTINGS, ("Could not apply the thread policy"),
+                      ("%s; continuing without it", err.c_str()));
+}
+
+// ── Lifecycle ────────────────────────────────────────────────────────────────
+static gboolean gst_mozza_warp_start(GstBaseTransform* base) {
+  auto* self = GST_MOZZA_WARP(base);
+
+  GST_INFO_OBJECT(self, "start()");
+
+  self->mls = std::make_unique<mp_imgwarp::ImgWarp_MLS_Rigid>();
+  self->mls->gridSize = self->mls_grid;
+  self->mls->preScale = true;
+  self->mls->alpha    = self->mls_alpha;
+
+  if (self->deform_path) {
+    errno = 0;
+    self->dfm = load_dfm(self->deform_path);
+    if (!self->dfm) {
+      if (self->strict_dfm) return FALSE;
+    } else {
+      GST_INFO_OBJECT(self, "dfm: %zu entries compiled to %zu rows in %zu groups",
+                      self->dfm->entries.size(), self->dfm->plan.size(),
+                      self->dfm->plan.groups());
+    }
+  }
+
+  self->frame_count = 0;
+  self->window.us.clear();
+  self->policy_warned = FALSE;
+  self->field_valid = FALSE;
+  self->field_reused = 0;
+  self->dup_hits = 0;
+  if (self->skip_duplicates) self->dup = std::make_unique<WarpDupCache>();
+  return TRUE;
+}
+
+static gboolean gst_mozza_warp_stop(GstBaseTransform* base) {
+  auto* self = GST_MOZZA_WARP(base);
+  self->mls.reset();
+  self->dfm.reset();
+  self->dup.reset();
+  self->field_valid = FALSE;
+  return TRUE;
+}
+
+static void gst_mozza_warp_finalize(GObject* object) {
+  auto* self = GST_MOZZA_WARP(object);
+  self->mls.reset();
+  self->dfm.reset();
+  self->dup.reset();
+  g_clear_pointer(&self->deform_path, g_free);
+  g_clear_pointer(&self->cpu_set,     g_free);
+  self->window.us.clear();
+  self->window.us.shrink_to_fit();
+  self->field_lm.clear();
+  self->field_lm.shrink_to_fit();
+  self->lm_px = std::vector<cv::Point2f>();
+  self->dfm_pts = DfmPoints();
+  G_OBJECT_CLASS(gst_mozza_warp_parent_class)->finalize(object);
+}
+
+// True when the field held by mls was computed from exactly these landmarks
+// (face 0) with the current settings, so the frame only needs resampling.
+static bool field_matches(GstMozzaWarp* self, const GstMozzaLandmarksMeta* meta, int W, int H) {
+  return self->field_valid && self->warp_mode == WARP_GLOBAL &&
+         self->field_w == W && self->field_h == H &&
+         self->field_alpha == self->alpha && self->field_mls_alpha == self->mls_alpha &&
+         self->field_grid == self->mls_grid &&
+         self->field_lm.size() == meta->n_landmarks &&
+         std::memcmp(self->field_lm.data(), meta->landmarks,
+                     meta->n_landmarks * sizeof(MpLandmark)) == 0;
+}
+
+static void remember_field(GstMozzaWarp* self, const GstMozzaLandmarksMeta* meta, int W, int H) {
+  self->field_lm.assign(meta->landmarks, meta->landmarks + meta->n_landmarks);
+  self->field_w = W;
+  self->field_h = H;
+  self->field_alpha = self->alpha;
+  self->field_mls_alpha = self->mls_alpha;
+  self->field_grid = self->mls_grid;
+  self->field_valid = TRUE;
+}
+
+void gst_mozza_warp_queue_quality(GstMozzaWarp* self, gint grid, const gchar* warp_mode) {
+  g_return_if_fail(GST_IS_MOZZA_WARP(self));
+  GST_OBJECT_LOCK(self);
+  self->queued_grid = CLAMP(grid, 1, 100);
+  self->queued_mode = (warp_mode && g_ascii_strcasecmp(warp_mode, "per-group-roi") == 0)
+                          ? WARP_PER_GROUP_ROI : WARP_GLOBAL;
+  g_atomic_int_set(&self->quality_queued, TRUE);
+  GST_OBJECT_UNLOCK(self);
+}
+
+// Takes what gst_mozza_warp_queue_quality left, on the streaming thread.
+static void take_queued_quality(GstMozzaWarp* self) {
+  if (!g_atomic_int_get(&self->quality_queued)) return;
+  GST_OBJECT_LOCK(self);
+  self->mls_grid = self->queued_grid;
+  self->warp_mode = self->queued_mode;
+  g_atomic_int_set(&self->quality_queued, FALSE);
+  GST_OBJECT_UNLOCK(self);
+  if (self->mls) self->mls->gridSize = self->mls_grid;
+  g_atomic_int_inc(&self->prop_serial);  // outputs cached by skip-duplicates are stale
+  GST_DEBUG_OBJECT(self, "quality: mls-grid=%d warp-mode=%s", self->mls_grid,
+                   self->warp_mode == WARP_PER_GROUP_ROI ? "per-group-roi" : "global");
+}
+
+// skip-duplicates: true when this input and its landmarks are the previous
+// input's, with the same properties.
+static bool dup_matches(GstMozzaWarp* self, uint64_t hash, const GstMozzaLandmarksMeta* meta) {
+  const WarpDupCache* d = self->dup.get();
+  return hash && d->hash == hash &&
+         d->serial == g_atomic_int_get(&self->prop_serial) &&
+         d->lm.size() == meta->n_landmarks &&
+         std::memcmp(d->lm.data(), meta->landmarks, meta->n_landmarks * sizeof(MpLandmark)) == 0;
+}
+
+// Called with each output that was warped. The first repeat of an input is
+// warped as usual and then copied into a buffer of the element's own, which
+// the following repeats share. A frame that is not a repeat only leaves its
+// hash and landmarks behind, so no buffer of the upstream pool is held.
+static void dup_remember(GstMozzaWarp* self, GstBuffer* out) {
+  WarpDupCache* d = self->dup.get();
+  const uint64_t hash = d->in_hash;
+  const GstMozzaLandmarksMeta* meta = gst_buffer_get_mozza_landmarks_meta(out);
+  if (meta && dup_matches(self, hash, meta)) {
+    if (!d->out) {
+      d->out = gst_buffer_new();
+      if (!gst_buffer_copy_into(d->out, out, (GstBufferCopyFlags)(GST_BUFFER_COPY_MEMORY |
+                                GST_BUFFER_COPY_DEEP), 0, -1)) {
+        gst_buffer_unref(d->out);
+        d->out = nullptr;
+      }
+    }
+    return;
+  }
+  d->clear();
+  if (!hash || !meta) return;
+  d->hash = hash;
+  d->serial = g_atomic_int_get(&self->prop_serial);
+  d->lm.assign(meta->landmarks, meta->landmarks + meta->n_landmarks);
+}
+
+// Input hash when mozza_detect did not leave one on the meta.
+static uint64_t hash_input(GstMozzaWarp* self, GstBuffer* in) {
+  GstVideoFrame f;
+  if (!gst_video_frame_map(&f, &GST_VIDEO_FILTER(self)->in_info, in, GST_MAP_READ)) return 0;
+  const uint64_t h = hash_video_frame(&f);
+  gst_video_frame_unmap(&f);
+  return h;
+}
+
+// skip-duplicates is decided here, before the frame is mapped for writing. A
+// repeat leaves as a new buffer with the input's timestamps and metas and
+// the cached output's memory, so no pixel is copied; any other frame is
+// transformed in place as usual.
+static GstFlowReturn gst_mozza_warp_prepare_output_buffer(GstBaseTransform* base,
+                                                          GstBuffer* in, GstBuffer** out) {
+  auto* self = GST_MOZZA_WARP(base);
+  auto* parent = GST_BASE_TRANSFORM_CLASS(gst_mozza_warp_parent_class);
+  take_queued_quality(self);  // every buffer comes through here first
+  WarpDupCache* d = self->dup.get();
+  if (!d) return parent->prepare_output_buffer(base, in, out);
+  d->in_hash = 0;
+  const GstMozzaLandmarksMeta* meta = gst_buffer_get_mozza_landmarks_meta(in);
+  if (!meta || meta->n_faces == 0) return parent->prepare_output_buffer(base, in, out);
+
+  d->in_hash = meta->frame_hash ? meta->frame_hash : hash_input(self, in);
+  if (!d->out || gst_buffer_get_size(d->out) != gst_buffer_get_size(in) ||
+      !dup_matches(self, d->in_hash, meta))
+    return parent->prepare_output_buffer(base, in, out);
+
+  GstBuffer* repeat = gst_buffer_new();
+  if (!gst_buffer_copy_into(repeat, d->out, GST_BUFFER_COPY_MEMORY, 0, -1) ||
+      !gst_buffer_copy_into(repeat, in, (GstBufferCopyFlags)(GST_BUFFER_COPY_FLAGS |
+                            GST_BUFFER_COPY_TIMESTAMPS | GST_BUFFER_COPY_META), 0, -1)) {
+    gst_buffer_unref(repeat);
+    return parent->prepare_output_buffer(base, in, out);
+  }
+  if (GstMozzaLandmarksMeta* m = gst_buffer_get_mozza_landmarks_meta(repeat)) m->frame_hash = 0;
+  d->served = repeat;
+  *out = repeat;
+  return GST_FLOW_OK;
+}
+
+static GstFlowReturn gst_mozza_warp_transform_ip(GstBaseTransform* base, GstBuffer* buf) {
+  auto* self = GST_MOZZA_WARP(base);
+  if (self->dup && self->dup->served == buf) {  // a repeat: already the output
+    self->dup->served = nullptr;
+    self->frame_count++;
+    self->dup_hits++;
+    return GST_FLOW_OK;
+  }
+  const GstFlowReturn ret = GST_BASE_TRANSFORM_CLASS(gst_mozza_warp_parent_class)->transform_ip(base, buf);
+  if (self->dup && ret == GST_FLOW_OK) dup_remember(self, buf);  // the frame is unmapped again
+  return ret;
+}
+
+static gboolean gst_mozza_warp_set_info(GstVideoFilter* vf, GstCaps*, GstVideoInfo*, GstCaps*, GstVideoInfo*) {
+  auto* self = GST_MOZZA_WARP(vf);
+  if (self->dup) self->dup->clear();  // outputs of the old caps
+  return TRUE;
+}
+
+static GstFlowReturn gst_mozza_warp_transform_frame_ip(GstVideoFilter* vf,
+                                                       GstVideoFrame* f) {
+  auto* self = GST_MOZZA_WARP(vf);
+  GstMozzaLandmarksMeta* lm_meta = gst_buffer_get_mozza_landmarks_meta(f->buffer);
+  if (!lm_meta) return GST_FLOW_OK;  // nothing detected upstream: pass through
+  if (lm_meta->n_faces == 0) return self->drop ? GST_BASE_TRANSFORM_FLOW_DROPPED : GST_FLOW_OK;
+
+  // The streaming thread belongs to GStreamer's pool: cpu-set / rt-priority
+  // hold while the frame is warped, then the thread gets its own settings
+  // back. OpenCV's warp pool is started from the first thread that warps and
+  // keeps that placement (it is shared by the whole process).
+  mp_thread_policy::Scope placement(self->cpu_set, self->rt_priority);
+  if (G_UNLIKELY(!placement.error().empty())) report_thread_policy(self, placement.error());
+  self->frame_count++;
+
+  const int W      = GST_VIDEO_FRAME_WIDTH(f);
+  const int H      = GST_VIDEO_FRAME_HEIGHT(f);
+  const int stride = GST_VIDEO_FRAME_PLANE_STRIDE(f, 0);
+  auto* data       = static_cast<uint8_t*>(GST_VIDEO_FRAME_PLANE_DATA(f, 0));
+
+  cv::Mat img_rgba(H, W, CV_8UC4, data, static_cast<size_t>(stride));
+  if (img_rgba.empty()) return GST_FLOW_OK;
+
+  // Face 0, in pixels of this frame (the meta is normalized).
+  const MpLandmark* lm = lm_meta->landmarks;
+  std::vector<cv::Point2f>& L = self->lm_px;
+  L.resize(lm_meta->n_landmarks);
+  for (guint i = 0; i < lm_meta->n_landmarks; ++i) L[i] = cv::Point2f(lm[i].x * W, lm[i].y * H);
+
+  const bool do_timing =
+      self->log_every > 0 &&
+      gst_debug_category_get_threshold(GST_CAT_DEFAULT) >= GST_LEVEL_INFO;
+  std::chrono::steady_clock::time_point t0;
+  if (do_timing) t0 = std::chrono::steady_clock::now();
+
+  if (self->dfm && !self->no_warp && self->mls) {
+    if (field_matches(self, lm_meta, W, H)) {
+      // Same landmarks as the last frame: skip the field, only resample.
+      cv::Mat warped = self->mls->genNewImg(img_rgba, 1);
+      if (!warped.empty()) warped.copyTo(img_rgba);
+      self->field_reused++;
+    } else if (warp_face_mls(img_rgba, *self->mls, self->dfm->plan, L, self->alpha,
+                             self->warp_mode == WARP_PER_GROUP_ROI, self->roi_pad,
+                             self->dfm_pts)) {
+      remember_field(self, lm_meta, W, H);
+    } else {
+      self->field_valid = FALSE;
+    }
+  }
+
+  if (do_timing) {
+    self->window.add((double)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - t0).count());
+    if (self->window.size() >= self->log_every) {
+      double mean_ms, p99_ms, max_ms;
+      self->window.take(&mean_ms, &p99_ms, &max_ms);
+      GST_INFO_OBJECT(self,
+          "TIMING warp frame=%llu (window avg)  warp=%.2fms  (%.0f fps)  p99=%.2fms max=%.2fms"
+          "  field-reused=%u  dup=%u",
+          (unsigned long long)self->frame_count, mean_ms,
+          mean_ms > 0.0 ? 1000.0 / mean_ms : 0.0, p99_ms, max_ms, self->field_reused,
+          self->dup_hits);
+      self->field_reused = 0;
+      self->dup_hits = 0;
+    }
+  }
+
+  // Final draw pass: force bright green on raw buffer
+  if (self->show_landmarks) {
+    // DEBUG: Red square top-left
+    for (int y=0; y<50; y++) {
+      for (int x=0; x<50; x++) {
+        uint8_t* p = data + y*stride + x*4;
+        p[0]=255; p[1]=0; p[2]=0; p[3]=255;
+      }
+    }
+    for (const auto& p : L) {
+      int cx = (int)p.x, cy = (int)p.y;
+      int R = 5;
+      for (int dy = -R; dy <= R; dy++) {
+        for (int dx = -R; dx <= R; dx++) {
+          int x = cx + dx, y = cy + dy;
+          if (x >= 0 && x < W && y >= 0 && y < H) {
+            uint8_t* pix = data + y * stride + x * 4;
+            pix[0] = 0; pix[1] = 255; pix[2] = 0; pix[3] = 255; // PURE GREEN
+          }
+        }
+      }
+    }
+  }
+
+  // The pixels are no longer the ones that were hashed.
+  lm_meta->frame_hash = 0;
+  return GST_FLOW_OK;
+}
+
+static void gst_mozza_warp_class_init(GstMozzaWarpClass* klass) {
+  auto* gobject_class = G_OBJECT_CLASS(klass);
+  auto* basetr_class  = GST_BASE_TRANSFORM_CLASS(klass);
+  auto* vfilter_class = GST_VIDEO_FILTER_CLASS(klass);
+
+  gobject_class->set_property = gst_mozza_warp_set_property;
+  gobject_class->get_property = gst_mozza_warp_get_property;
+  gobject_class->finalize     = gst_mozza_warp_finalize;
+
+  g_object_class_install_property(gobject_class, PROP_DEFORM_PATH, g_param_spec_string("deform", "Deformation file (.dfm)", "Path to deformation file with barycentric rules, or a comma-separated list of them with optional @weight each", nullptr, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_DFM_ALIAS, g_param_spec_string("dfm", "Deformation file (.dfm) [alias]", "Alias for 'deform'", nullptr, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_ALPHA, g_param_spec_float("alpha", "Smile intensity multiplicator", "Scales the intensity of the deformation", -10.f, 10.f, 1.f, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_OVERLAY, g_param_spec_boolean("overlay", "Debug overlay", "Draw src/dst control points and vectors", FALSE, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_DROP, g_param_spec_boolean("drop", "Drop on no face", "Drop frames when no face is detected", FALSE, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_SHOW_LANDMARKS, g_param_spec_boolean("show-landmarks", "Draw landmarks", "Draw all detected landmarks", FALSE, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_NO_WARP, g_param_spec_boolean("no-warp", "No warp", "Disable warping", FALSE, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_STRICT_DFM, g_param_spec_boolean("strict-dfm", "Fail when DFM fails to load", "If true and deform path fails, start() fails", FALSE, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_LOG_EVERY, g_param_spec_uint("log-every", "Periodic log interval", "Log every N frames", 0, 1000000, 60, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_LM_RADIUS, g_param_spec_int("landmark-radius", "Landmark dot radius", "Radius", 1, 10, 2, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_LM_COLOR, g_param_spec_uint("landmark-color", "Landmark dot color", "Packed RGBA color", 0, G_MAXUINT, 0x0066CCFFu, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_MLS_ALPHA, g_param_spec_float("mls-alpha", "MLS alpha", "Rigidity parameter", 0.f, 10.f, 1.4f, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_MLS_GRID, g_param_spec_int("mls-grid", "MLS grid size", "Grid size in pixels", 1, 100, 5, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_WARP_MODE, g_param_spec_string("warp-mode", "Warp mode", "global or per-group-roi", "global", G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_ROI_PAD, g_param_spec_int("roi-pad", "ROI padding", "Padding around ROI", 0, 200, 24, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_CPU_SET, g_param_spec_string("cpu-set", "CPU set", "CPU list (e.g. \"2-5,8\") for the streaming thread while it warps a frame (NULL=inherit)", nullptr, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_SKIP_DUPLICATES, g_param_spec_boolean("skip-duplicates", "Skip duplicate frames", "Re-emit the previous output for a frame identical to the previous input", FALSE, G_PARAM_READWRITE));
+  g_object_class_install_property(gobject_class, PROP_RT_PRIORITY, g_param_spec_int("rt-priority", "Real-time priority", "SCHED_FIFO priority for the streaming thread while it warps a frame (0=inherit; needs CAP_SYS_NICE)", 0, 99, 0, G_PARAM_READWRITE));
+
+  gst_element_class_set_static_metadata(GST_ELEMENT_CLASS(klass), "Mozza warp", "Filter/Effect/Video", "DFM-driven MLS on upstream landmarks", "DuckSoup Lab");
+  gst_element_class_add_pad_template(GST_ELEMENT_CLASS(klass), gst_static_pad_template_get(&sink_template));
+  gst_element_class_add_pad_template(GST_ELEMENT_CLASS(klass), gst_static_pad_template_get(&src_template));
+
+  basetr_class->start = gst_mozza_warp_start;
+  basetr_class->prepare_output_buffer = gst_mozza_warp_prepare_output_buffer;
+  basetr_class->transform_ip = gst_mozza_warp_transform_ip;
+  basetr_class->stop  = gst_mozza_warp_stop;
+  vfilter_class->set_info           = gst_mozza_warp_set_info;
+  vfilter_class->transform_frame_ip = gst_mozza_warp_transform_frame_ip;
+}
+
+static void gst_mozza_warp_init(GstMozzaWarp* self) {
+  self->deform_path    = nullptr;
+  self->alpha          = 1.0f;
+  self->mls_alpha      = 1.4f;
+  self->mls_grid       = 5;
+  self->warp_mode      = WARP_GLOBAL;
+  self->roi_pad        = 24;
+  self->overlay        = FALSE;
+  self->drop           = FALSE;
+  self->show_landmarks = FALSE;
+  self->no_warp        = FALSE;
+  self->strict_dfm     = FALSE;
+  self->lm_radius      = 3;
+  self->lm_color       = 0x00FF00FFu; // green
+  self->log_every      = 60;
+  self->cpu_set        = nullptr;
+  self->rt_priority    = 0;
+  self->skip_duplicates = FALSE;
+  self->prop_serial    = 0;
+  self->quality_queued = FALSE;
+  self->frame_count    = 0;
+  self->policy_warned  = FALSE;
+}
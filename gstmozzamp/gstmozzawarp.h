@@ -0,0 +1,20 @@
+// gstmozzamp/gstmozzawarp.h
+// mozza_warp: DFM + MLS warp only, driven by the GstMozzaLandmarksMeta
+// attached upstream (mozza_detect, facelandmarks). Buffers without the meta
+// pass through untouched.
+#pragma once
+
+#include <gst/video/gstvideofilter.h>
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_MOZZA_WARP (gst_mozza_warp_get_type())
+G_DECLARE_FINAL_TYPE(GstMozzaWarp, gst_mozza_warp, GST, MOZZA_WARP, GstVideoFilter)
+
+// Sets mls-grid and warp-mode ("global" / "per-group-roi") from any thread
+// while streaming (mozza_mp adaptive-quality). The streaming thread takes
+// them before its next frame; until then the properties read back the
+// queued values.
+void gst_mozza_warp_queue_quality(GstMozzaWarp* self, gint grid, const gchar* warp_mode);
+
+G_END_DECLS
@@ -0,0 +1,59 @@
+// gstmozzamp/landmark_tracker.cpp
+#include "landmark_tracker.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <opencv2/video/tracking.hpp>
+
+static float median_of(std::vector<float>& v) {
+  auto mid = v.begin() + v.size() / 2;
+  std::nth_element(v.begin(), mid, v.end());
+  return *mid;
+}
+
+void LandmarkTracker::reset(const cv::Mat& gray, const std::vector<cv::Point2f>& points,
+                            int per_face) {
+  gray.copyTo(prev_);
+  points_ = points;
+  per_face_ = per_face > 0 ? per_face : (int)points.size();
+}
+
+bool LandmarkTracker::track(const cv::Mat& gray, float* trusted) {
+  *trusted = 0.f;
+  if (points_.empty() || prev_.empty() || prev_.size() != gray.size()) return false;
+
+  const cv::Size win(params_.win, params_.win);
+  const cv::TermCriteria term(cv::TermCriteria::COUNT | cv::TermCriteria::EPS, 20, 0.03);
+  cv::calcOpticalFlowPyrLK(prev_, gray, points_, fwd_, st_fwd_, err_, win, params_.levels, term);
+  cv::calcOpticalFlowPyrLK(gray, prev_, fwd_, back_, st_back_, err_, win, params_.levels, term);
+
+  const float max_err2 = params_.max_fb_err * params_.max_fb_err;
+  const size_t n = points_.size();
+  float worst = 1.f;
+  for (size_t start = 0; start < n; start += per_face_) {
+    const size_t end = std::min(n, start + (size_t)per_face_);
+    dx_.clear();
+    dy_.clear();
+    for (size_t i = start; i < end; ++i) {
+      const cv::Point2f d = back_[i] - points_[i];
+      if (st_fwd_[i] && st_back_[i] && d.dot(d) <= max_err2) {
+        dx_.push_back(fwd_[i].x - points_[i].x);
+        dy_.push_back(fwd_[i].y - points_[i].y);
+      } else {
+        st_fwd_[i] = 0;  // untrusted
+      }
+    }
+    worst = std::min(worst, (float)dx_.size() / (float)(end - start));
+    if (dx_.empty()) continue;
+    const cv::Point2f shift(median_of(dx_), median_of(dy_));
+    for (size_t i = start; i < end; ++i)
+      if (!st_fwd_[i]) fwd_[i] = points_[i] + shift;
+  }
+  *trusted = worst;
+  if (worst < params_.min_trusted) return false;
+
+  points_.swap(fwd_);
+  gray.copyTo(prev_);
+  return true;
+}
@@ -0,0 +1,51 @@
+// gstmozzamp/landmark_tracker.hpp
+// Carries landmarks from one frame to the next with pyramidal Lucas-Kanade
+// flow, so mozza_detect can run the full detector every N frames only.
+//
+// Works on a small grayscale copy of the frame (the caller downscales).
+// Every point is tracked forward and back; a point whose round trip misses
+// its start by more than max_fb_err pixels is not trusted and moves with the
+// median motion of the trusted points of its face instead. When too few
+// points of a face are trusted, track() fails and the caller re-detects.
+#pragma once
+
+#include <opencv2/core.hpp>
+
+#include <vector>
+
+class LandmarkTracker {
+ public:
+  struct Params {
+    int   win = 15;              // LK window, in small-frame pixels
+    int   levels = 3;            // pyramid levels above the base
+    float max_fb_err = 1.0f;     // forward-backward error limit, small-frame pixels
+    float min_trusted = 0.8f;    // per face, fraction of trusted points to keep tracking
+  };
+
+  explicit LandmarkTracker(const Params& p = Params{}) : params_(p) {}
+
+  // Starts from a detection: points in gray's pixels, per_face points per face.
+  void reset(const cv::Mat& gray, const std::vector<cv::Point2f>& points, int per_face);
+  void clear() { points_.clear(); prev_.release(); }
+  // Takes gray as the frame the points are on, without moving them: for a
+  // frame where the face is known not to have moved (motion-gate).
+  void rebase(const cv::Mat& gray) { if (active()) gray.copyTo(prev_); }
+  bool active() const { return !points_.empty(); }
+
+  // Moves the points onto gray. Returns false (points unchanged) when a face
+  // lost too many points; *trusted gets the lowest per-face trusted fraction.
+  bool track(const cv::Mat& gray, float* trusted);
+
+  const std::vector<cv::Point2f>& points() const { return points_; }
+
+ private:
+  Params params_;
+  cv::Mat prev_;
+  std::vector<cv::Point2f> points_;
+  int per_face_ = 0;
+
+  // Scratch reused between frames.
+  std::vector<cv::Point2f> fwd_, back_;
+  std::vector<unsigned char> st_fwd_, st_back_;
+  std::vector<float> err_, dx_, dy_;
+};
@@ -0,0 +1,43 @@
+// gstmozzamp/one_euro.cpp
+#include "one_euro.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Smoothing factor of a first-order low-pass at cutoff Hz, sampled every dt.
+static inline float lowpass_alpha(float cutoff, float dt) {
+  const float r = 2.0f * static_cast<float>(M_PI) * cutoff * dt;
+  return r / (r + 1.0f);
+}
+
+void OneEuroBank::filter(float* x, size_t n, float dt) {
+  if (!primed_ || x_prev_.size() != n) {
+    x_prev_.assign(x, x + n);
+    dx_prev_.assign(n, 0.0f);
+    primed_ = true;
+    return;
+  }
+  if (dt <= 0.0f) {  // same instant again: repeat the last output
+    std::copy(x_prev_.begin(), x_prev_.end(), x);
+    return;
+  }
+
+  const float inv_dt = 1.0f / dt;
+  const float ad = lowpass_alpha(d_cutoff, dt);
+  const float k = 2.0f * static_cast<float>(M_PI) * dt;  // lowpass_alpha, per channel
+  const float mc = min_cutoff, b = beta;
+  float* __restrict xp = x_prev_.data();
+  float* __restrict dxp = dx_prev_.data();
+  float* __restrict xs = x;
+#pragma omp simd
+  for (size_t i = 0; i < n; ++i) {
+    const float dx = (xs[i] - xp[i]) * inv_dt;
+    const float edx = ad * dx + (1.0f - ad) * dxp[i];
+    const float r = k * (mc + b * std::fabs(edx));
+    const float a = r / (r + 1.0f);
+    const float xf = xp[i] + a * (xs[i] - xp[i]);
+    xp[i] = xf;
+    dxp[i] = edx;
+    xs[i] = xf;
+  }
+}
@@ -0,0 +1,42 @@
+// gstmozzamp/one_euro.hpp
+// One-Euro filters (Casiez et al.) for a whole landmark set, as used by
+// mozza_detect and mozza_mp_gpu to take the detector's jitter out of the
+// landmarks without lagging behind real motion.
+//
+// The state is kept as structure-of-arrays and every channel shares the
+// same parameters, so filter() is one branch-free loop over contiguous
+// floats that the compiler vectorizes (see the omp simd pragma and
+// -fopenmp-simd in BUILD). Pass the landmarks as a flat array, e.g. an
+// MpLandmark[n] seen as float[3 * n].
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+class OneEuroBank {
+ public:
+  float min_cutoff = 2.0f;  // Hz: lower = steadier at rest, more lag
+  float beta = 0.05f;       // cutoff slope: higher = less lag when moving fast
+  float d_cutoff = 1.0f;    // Hz, low-pass on the speed estimate
+
+  // The elements' `smooth` / `min-cutoff` / `beta` properties, one mapping
+  // for all of them: smooth in [0, 1) scales the rest cutoff by
+  // 2 * (1 - smooth), so 0.5 (mozza_mp_gpu's default) uses min-cutoff as
+  // given; beta is used as given.
+  void configure(float smooth, float rest_cutoff, float slope) {
+    min_cutoff = rest_cutoff * 2.f * (1.f - smooth);
+    beta = slope;
+  }
+
+  // The next filter() call starts over from its input.
+  void reset() { primed_ = false; }
+
+  // Filters x[0..n) in place; dt is the time since the previous call in
+  // seconds. The first call after reset(), or with a different n, passes x
+  // through and primes the state.
+  void filter(float* x, size_t n, float dt);
+
+ private:
+  bool primed_ = false;
+  std::vector<float> x_prev_, dx_prev_;
+};
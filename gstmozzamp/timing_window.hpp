@@ -0,0 +1,28 @@
+// gstmozzamp/timing_window.hpp
+// Per-frame durations over one log-every window: mean, p99 and max for the
+// TIMING lines of mozza_detect / mozza_warp.
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+struct TimingWindow {
+  std::vector<float> us;
+
+  void add(double v) { us.push_back(static_cast<float>(v)); }
+  size_t size() const { return us.size(); }
+
+  // Summarizes in milliseconds and starts a new window.
+  void take(double* mean_ms, double* p99_ms, double* max_ms) {
+    *mean_ms = *p99_ms = *max_ms = 0.0;
+    if (us.empty()) return;
+    double sum = 0.0;
+    for (float v : us) sum += v;
+    auto p99 = us.begin() + std::min(us.size() - 1, us.size() * 99 / 100);
+    std::nth_element(us.begin(), p99, us.end());
+    *mean_ms = sum / us.size() / 1000.0;
+    *p99_ms = *p99 / 1000.0;
+    *max_ms = *std::max_element(p99, us.end()) / 1000.0;
+    us.clear();
+  }
+};
@@ -30,6 +30,7 @@
 // Reuse DFM parsing and group building from mozza_mp
 #include "dfm.hpp"
 #include "deform_utils.hpp"
+#include "one_euro.hpp"
 
 // GPU components
 #include "trt_face_landmarker.h"
@@ -53,34 +54,6 @@ enum WarpMode {
   WARP_PER_GROUP_ROI = 1,
 };
 
-// ── One-Euro Filter for Landmark Smoothing (Matching MediaPipe) ──
-struct OneEuroFilter {
-  float min_cutoff, beta, d_cutoff;
-  bool first_time = true;
-  float x_prev, dx_prev;
-  // Aggressive snappy responsiveness (2.0Hz cutoff, 0.05 beta)
-  OneEuroFilter() : min_cutoff(2.0f), beta(0.05f), d_cutoff(1.0f) {}
-  float alpha(float cutoff, float dt) {
-    float r = 2.0f * M_PI * cutoff * dt;
-    return r / (r + 1.0f);
-  }
-  float filter(float x, float dt) {
-    if (first_time) {
-      first_time = false;
-      x_prev = x; dx_prev = 0.0f;
-      return x;
-    }
-    if (dt <= 0) return x_prev;
-    float dx = (x - x_prev) / dt;
-    float edx = alpha(d_cutoff, dt) * dx + (1.0f - alpha(d_cutoff, dt)) * dx_prev;
-    float cutoff = min_cutoff + beta * std::abs(edx);
-    float a = alpha(cutoff, dt);
-    float x_filtered = a * x + (1.0f - a) * x_prev;
-    x_prev = x_filtered; dx_prev = edx;
-    return x_filtered;
-  }
-};
-
 struct _GstMozzaMpGpu {
   GstVideoFilter parent;
 
@@ -106,16 +79,17 @@ struct _GstMozzaMpGpu {
   gint warp_mode;
   gint roi_pad;
 
-  // ── Smoothing state ──
+  // ── Smoothing state (One-Euro bank over the 478x2 x/y coordinates) ──
   bool has_filters;
-  std::vector<OneEuroFilter> filters_x;
-  std::vector<OneEuroFilter> filters_y;
+  OneEuroBank filters;
+  std::vector<float> lm_xy;
   GstClockTime prev_pts;
 
   // ── GPU runtime ──
   std::unique_ptr<TrtFaceLandmarker> trt_lm;
   std::unique_ptr<CudaMlsWarp> cuda_warp;
   std::optional<Deformations> dfm;
+  DfmPoints dfm_pts;        // control points, reused between frames
 
   // CUDA resources
   cudaStream_t cuda_stream;
@@ -247,31 +221,12 @@ static void gst_mozza_mp_gpu_set_property(GObject* obj, guint prop_id,
       break;
     case PROP_SMOOTH:
       self->smooth = g_value_get_float(value);
-      if (self->has_filters) {
-        float b = 0.001f + (1.0f - self->smooth) * 0.012f;
-        for (int i = 0; i < 478; ++i) {
-          self->filters_x[i].beta = b;
-          self->filters_y[i].beta = b;
-        }
-      }
       break;
     case PROP_MIN_CUTOFF:
       self->min_cutoff = g_value_get_float(value);
-      if (self->has_filters) {
-        for (int i = 0; i < 478; ++i) {
-          self->filters_x[i].min_cutoff = self->min_cutoff;
-          self->filters_y[i].min_cutoff = self->min_cutoff;
-        }
-      }
       break;
     case PROP_BETA:
       self->beta = g_value_get_float(value);
-      if (self->has_filters) {
-        for (int i = 0; i < 478; ++i) {
-          self->filters_x[i].beta = self->beta;
-          self->filters_y[i].beta = self->beta;
-        }
-      }
       break;
     case PROP_SMOOTH_LANDMARKS:
       self->smooth_landmarks = g_value_get_boolean(value);
@@ -461,8 +416,8 @@ static gboolean gst_mozza_mp_gpu_start(GstBaseTransform* base) {
       GST_WARNING_OBJECT(self, "Failed to load DFM: %s", self->deform_path);
       if (self->strict_dfm) return FALSE;
     } else {
-      GST_INFO_OBJECT(self, "Loaded DFM: %s (%zu entries)", self->deform_path,
-                      self->dfm->entries.size());
+      GST_INFO_OBJECT(self, "Loaded DFM: %s (%zu entries, %zu groups)", self->deform_path,
+                      self->dfm->entries.size(), self->dfm->plan.groups());
     }
   }
 
@@ -509,6 +464,9 @@ static void gst_mozza_mp_gpu_finalize(GObject* object) {
   g_clear_pointer(&self->model_path, g_free);
   g_clear_pointer(&self->deform_path, g_free);
   g_clear_pointer(&self->user_id, g_free);
+  self->filters = OneEuroBank();
+  self->lm_xy = std::vector<float>();
+  self->dfm_pts = DfmPoints();
   G_OBJECT_CLASS(gst_mozza_mp_gpu_parent_class)->finalize(object);
 }
 
@@ -637,32 +595,27 @@ static GstFlowReturn gst_mozza_mp_gpu_transform_frame_ip(
   self->prev_pts = pts;
 
   if (!self->has_filters) {
-    self->filters_x.assign(478, OneEuroFilter());
-    self->filters_y.assign(478, OneEuroFilter());
-    for(int i=0; i<478; ++i) { 
-      self->filters_x[i].min_cutoff = self->min_cutoff; 
-      self->filters_y[i].min_cutoff = self->min_cutoff;
-      self->filters_x[i].beta = self->beta; 
-      self->filters_y[i].beta = self->beta; 
-    }
+    self->filters.reset();
     self->has_filters = true;
   }
 
+  // Filter x/y in normalized space, all of them in one call; same
+  // smooth / min-cutoff / beta mapping as mozza_detect.
+  std::vector<float>& xy = self->lm_xy;
+  xy.resize(478 * 2);
   for (int i = 0; i < 478; ++i) {
-    // 1. Get mathematically perfect normalized coords
-    float nx = face.landmarks[i * 3 + 0];
-    float ny = face.landmarks[i * 3 + 1];
-
-    // 2. Filter smoothly in normalized space
-    if (self->smooth_landmarks) {
-      nx = self->filters_x[i].filter(nx, dt);
-      ny = self->filters_y[i].filter(ny, dt);
-    }
-
-    // 3. Map directly to screen pixels
-    L.emplace_back(nx * (float)W, ny * (float)H);
+    xy[i * 2 + 0] = face.landmarks[i * 3 + 0];
+    xy[i * 2 + 1] = face.landmarks[i * 3 + 1];
+  }
+  if (self->smooth_landmarks) {
+    self->filters.configure(self->smooth, self->min_cutoff, self->beta);
+    self->filters.filter(xy.data(), xy.size(), dt);
   }
 
+  // Map directly to screen pixels
+  for (int i = 0; i < 478; ++i)
+    L.emplace_back(xy[i * 2 + 0] * (float)W, xy[i * 2 + 1] * (float)H);
+
   // Export landmarks for comparison/validation
   if (const char* lm_out = std::getenv("LANDMARK_OUTPUT_FILE")) {
     if (FILE* lmf = std::fopen(lm_out, "a")) {
@@ -678,23 +631,24 @@ static GstFlowReturn gst_mozza_mp_gpu_transform_frame_ip(
 
   // ── Apply Deformation (MLS Warp) ──
   if (self->dfm && self->cuda_warp && !self->no_warp) {
-    std::vector<std::vector<cv::Point2f>> srcGroups, dstGroups;
-    build_groups_from_dfm(*self->dfm, L, self->alpha, srcGroups, dstGroups);
+    DfmPoints& pts = self->dfm_pts;
+    eval_dfm_plan(self->dfm->plan, L, self->alpha, pts);
 
-    if (!srcGroups.empty()) {
+    if (pts.groups() > 0) {
       if (self->warp_mode == WARP_PER_GROUP_ROI) {
         cudaMemcpy2DAsync(self->d_frame_out, self->alloc_pitch, self->d_frame_in,
                           self->alloc_pitch, W * 4, H, cudaMemcpyDeviceToDevice,
                           self->cuda_stream);
 
-        for (size_t g = 0; g < srcGroups.size(); ++g) {
-          auto& sg = srcGroups[g];
-          auto& dg = dstGroups[g];
-          
+        for (size_t g = 0; g < pts.groups(); ++g) {
+          const cv::Point2f* sg = &pts.src[pts.group_begin[g]];
+          const cv::Point2f* dg = &pts.dst[pts.group_begin[g]];
+          const size_t n = pts.group_begin[g + 1] - pts.group_begin[g];
+
           // ROI = union of before/after + pad (match CPU tight_bounds_union)
           float minx = 1e9f, miny = 1e9f, maxx = -1e9f, maxy = -1e9f;
-          for (auto& p : sg) { minx = std::min(minx, p.x); maxx = std::max(maxx, p.x); miny = std::min(miny, p.y); maxy = std::max(maxy, p.y); }
-          for (auto& p : dg) { minx = std::min(minx, p.x); maxx = std::max(maxx, p.x); miny = std::min(miny, p.y); maxy = std::max(maxy, p.y); }
+          for (size_t i = 0; i < n; ++i) { minx = std::min(minx, sg[i].x); maxx = std::max(maxx, sg[i].x); miny = std::min(miny, sg[i].y); maxy = std::max(maxy, sg[i].y); }
+          for (size_t i = 0; i < n; ++i) { minx = std::min(minx, dg[i].x); maxx = std::max(maxx, dg[i].x); miny = std::min(miny, dg[i].y); maxy = std::max(maxy, dg[i].y); }
 
           int rx = std::max(0, (int)std::floor(minx) - self->roi_pad);
           int ry = std::max(0, (int)std::floor(miny) - self->roi_pad);
@@ -722,10 +676,10 @@ static GstFlowReturn gst_mozza_mp_gpu_transform_frame_ip(
 
           // Localize control points (match CPU)
           std::vector<float> h_src_xy, h_dst_xy;
-          h_src_xy.reserve((sg.size() + 64) * 2);
-          h_dst_xy.reserve((dg.size() + 64) * 2);
+          h_src_xy.reserve((n + 64) * 2);
+          h_dst_xy.reserve((n + 64) * 2);
           
-          for (size_t i = 0; i < sg.size(); ++i) {
+          for (size_t i = 0; i < n; ++i) {
             h_src_xy.push_back(sg[i].x - rx); h_src_xy.push_back(sg[i].y - ry);
             h_dst_xy.push_back(dg[i].x - rx); h_dst_xy.push_back(dg[i].y - ry);
           }
@@ -749,23 +703,18 @@ static GstFlowReturn gst_mozza_mp_gpu_transform_frame_ip(
           self->cuda_warp->warp(self->d_frame_in, self->d_frame_out, W, H, self->alloc_pitch, self->alloc_pitch, h_src_xy.data(), h_dst_xy.data(), nPts, rx, ry, rw, rh, self->cuda_stream);
         }
       } else {
-        std::vector<cv::Point2f> src, dst;
-        for (size_t g = 0; g < srcGroups.size(); ++g) {
-          src.insert(src.end(), srcGroups[g].begin(), srcGroups[g].end());
-          dst.insert(dst.end(), dstGroups[g].begin(), dstGroups[g].end());
-        }
+        std::vector<cv::Point2f> src(pts.src.begin(), pts.src.begin() + pts.size());
+        std::vector<cv::Point2f> dst(pts.dst.begin(), pts.dst.begin() + pts.size());
         add_identity_anchors(W, H, src, dst);
 
         // Anchor all other landmarks to prevent global bleeding
         for (const auto& p : L) {
           bool moving = false;
-          for (size_t g = 0; g < srcGroups.size(); ++g) {
-            for (const auto& sp : srcGroups[g]) {
-              if (std::abs(p.x - sp.x) < 0.1f && std::abs(p.y - sp.y) < 0.1f) {
-                moving = true; break;
-              }
+          for (size_t i = 0; i < pts.size(); ++i) {
+            const cv::Point2f& sp = pts.src[i];
+            if (std::abs(p.x - sp.x) < 0.1f && std::abs(p.y - sp.y) < 0.1f) {
+              moving = true; break;
             }
-            if (moving) break;
           }
           if (!moving) {
             src.push_back(p); dst.push_back(p);
@@ -865,7 +814,8 @@ static void gst_mozza_mp_gpu_class_init(GstMozzaMpGpuClass* klass) {
   g_object_class_install_property(
       gobject_class, PROP_DEFORM_PATH,
       g_param_spec_string("deform", "Deformation file (.dfm)",
-                          "Path to deformation file", nullptr,
+                          "Path to deformation file, or a comma-separated list "
+                          "of them with optional @weight each", nullptr,
                           G_PARAM_READWRITE));
   g_object_class_install_property(
       gobject_class, PROP_DFM_ALIAS,
@@ -925,7 +875,7 @@ static void gst_mozza_mp_gpu_class_init(GstMozzaMpGpuClass* klass) {
   g_object_class_install_property(
       gobject_class, PROP_SMOOTH,
       g_param_spec_float("smooth", "Smoothing",
-                         "Temporal smoothing factor (0=off, 0.9=max). Tunes beta of the OneEuroFilter.", 0.0f,
+                         "One-Euro smoothing of the landmarks (0..0.99, higher = steadier); scales min-cutoff by 2 * (1 - smooth), as in mozza_detect", 0.0f,
                          0.99f, 0.5f, G_PARAM_READWRITE));
   g_object_class_install_property(
       gobject_class, PROP_MIN_CUTOFF,
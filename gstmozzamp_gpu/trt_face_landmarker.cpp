@@ -9,6 +9,7 @@
 
 #include "trt_face_landmarker.h"
 #include "cuda_preprocess.h"
+#include "face_pipeline.h"
 #include "task_model_extractor.h"
 
 #include <NvInfer.h>
@@ -26,10 +27,6 @@
 
 #include <cstdarg>
 
-#ifndef M_PI
-#define M_PI 3.14159265358979323846f
-#endif
-
 namespace {
 // Helper to format logs into a string
 std::string fmt_str(const char* format, ...) {
@@ -155,34 +152,9 @@ struct TrtFaceLandmarker::Impl {
   std::vector<float> prev_landmarks; // 478 * 3, normalized [0, 1]
 
   // ROI One-Euro smoothing state
-  struct RoiOneEuroFilter {
-    // Aggressive responsiveness: 2.0Hz base cutoff, 0.05 beta for instant motion follow.
-    float min_cutoff = 2.0f, beta = 0.05f, d_cutoff = 1.0f;
-    bool first_time = true;
-    float x_prev = 0.0f, dx_prev = 0.0f;
-    float alpha(float cutoff, float dt) {
-      float r = 2.0f * M_PI * cutoff * dt;
-      return r / (r + 1.0f);
-    }
-    float filter(float x, float dt) {
-      if (first_time) {
-        first_time = false;
-        x_prev = x; dx_prev = 0.0f;
-        return x;
-      }
-      if (dt <= 0) return x_prev;
-      float dx = (x - x_prev) / dt;
-      float edx = alpha(d_cutoff, dt) * dx + (1.0f - alpha(d_cutoff, dt)) * dx_prev;
-      float cutoff = min_cutoff + beta * std::abs(edx);
-      float a = alpha(cutoff, dt);
-      float x_filtered = a * x + (1.0f - a) * x_prev;
-      x_prev = x_filtered; dx_prev = edx;
-      return x_filtered;
-    }
-  };
   bool has_prev_roi = false;
   float prev_cx = 0.5f, prev_cy = 0.5f, prev_size = 0.5f;
-  RoiOneEuroFilter filter_cx, filter_cy, filter_size;
+  face_pipeline::RoiSmoother roi_filter;
 
 
   Impl() {
@@ -419,97 +391,7 @@ std::unique_ptr<TrtFaceLandmarker> TrtFaceLandmarker::Create(
   return self;
 }
 
-// BlazeFace SSD anchor generation for 128x128
-static std::vector<std::array<float, 2>> generate_anchors_128() {
-  // BlazeFace uses a specific anchor scheme:
-  // Feature maps at strides 8 and 16, 2 anchors per cell
-  std::vector<std::array<float, 2>> anchors;
-  const int strides[] = {8, 16};
-  const int anchor_counts[] = {2, 6};
-
-  for (int s = 0; s < 2; ++s) {
-    int stride = strides[s];
-    int grid = 128 / stride;
-    for (int y = 0; y < grid; ++y) {
-      for (int x = 0; x < grid; ++x) {
-        float cx = (x + 0.5f) / (float)grid;
-        float cy = (y + 0.5f) / (float)grid;
-        for (int a = 0; a < anchor_counts[s]; ++a) {
-          anchors.push_back({cx, cy});
-        }
-      }
-    }
-  }
-  return anchors;
-}
-
-// Decode BlazeFace detector output
-struct DetectedFace {
-  float cx, cy, w, h;  // normalized center + size
-  float score;
-  // 6 keypoints (eye, ear, nose, mouth) - used for face crop alignment
-  float kp[6][2];
-};
-
-static std::vector<DetectedFace> decode_detections(
-    const float* raw_boxes, const float* raw_scores,
-    const std::vector<std::array<float, 2>>& anchors, float threshold,
-    int width, int height) {
-  std::vector<DetectedFace> faces;
-  int n = (int)anchors.size();
-
-  float scale = std::min(128.0f / width, 128.0f / height);
-  float crop_w = width * scale;
-  float crop_h = height * scale;
-  float pad_x = (128.0f - crop_w) * 0.5f;
-  float pad_y = (128.0f - crop_h) * 0.5f;
-
-  for (int i = 0; i < n; ++i) {
-    // Score decoding: always apply sigmoid (raw scores are logits)
-    float s = raw_scores[i];
-    float score = 1.0f / (1.0f + std::exp(-s));
-    if (score < threshold) continue;
-
-    DetectedFace f;
-    f.score = score;
-
-    // Decode box: center offset + size, relative to anchor
-    float ax = anchors[i][0] * 128.0f;
-    float ay = anchors[i][1] * 128.0f;
-
-    float dx = raw_boxes[i * 16 + 0];
-    float dy = raw_boxes[i * 16 + 1];
-    float dw = raw_boxes[i * 16 + 2];
-    float dh = raw_boxes[i * 16 + 3];
-
-    float px_cx = dx + ax;
-    float px_cy = dy + ay;
-
-    // Unpad and unscale to original image coordinates
-    f.cx = (px_cx - pad_x) / crop_w;
-    f.cy = (px_cy - pad_y) / crop_h;
-    f.w = dw / crop_w;
-    f.h = dh / crop_h;
-
-    // 6 keypoints
-    for (int k = 0; k < 6; ++k) {
-      float kpx = raw_boxes[i * 16 + 4 + k * 2 + 0] + ax;
-      float kpy = raw_boxes[i * 16 + 4 + k * 2 + 1] + ay;
-      f.kp[k][0] = (kpx - pad_x) / crop_w;
-      f.kp[k][1] = (kpy - pad_y) / crop_h;
-    }
-
-    faces.push_back(f);
-  }
-
-  // Simple NMS by score
-  std::sort(faces.begin(), faces.end(),
-            [](const DetectedFace& a, const DetectedFace& b) {
-              return a.score > b.score;
-            });
-
-  return faces;
-}
+using face_pipeline::DetectedFace;
 
 GpuLandmarkResult TrtFaceLandmarker::detect(const uint8_t* d_rgba, int width,
                                              int height, int pitch,
@@ -553,16 +435,14 @@ GpuLandmarkResult TrtFaceLandmarker::detect(const uint8_t* d_rgba, int width,
                     896 * sizeof(float), cudaMemcpyDeviceToHost, stream);
     cudaStreamSynchronize(stream);
 
-    static auto anchors = generate_anchors_128();
-    faces = decode_detections(I.h_det_boxes.data(), I.h_det_scores.data(), anchors,
-                              I.cfg.det_threshold, width, height);
+    faces = face_pipeline::decode_detections(I.h_det_boxes.data(), I.h_det_scores.data(),
+                                             face_pipeline::anchors_128(),
+                                             I.cfg.det_threshold, width, height);
 
     if (faces.empty()) {
       I.has_prev_landmarks = false;
       I.has_prev_roi = false;
-      I.filter_cx.first_time = true;
-      I.filter_cy.first_time = true;
-      I.filter_size.first_time = true;
+      I.roi_filter.reset();
       result.face_count = 0;
       return result;
     }
@@ -572,32 +452,12 @@ GpuLandmarkResult TrtFaceLandmarker::detect(const uint8_t* d_rgba, int width,
   result.faces.resize(n_faces);
 
   for (int fi = 0; fi < n_faces; ++fi) {
+    face_pipeline::FaceRoi roi{cx, cy, side, angle};
     if (!use_tracking) {
-      auto& det = faces[fi];
-      cx = det.cx * (float)width;
-      cy = det.cy * (float)height;
-
-      float eye_x = (det.kp[1][0] - det.kp[0][0]) * (float)width;
-      float eye_y = (det.kp[1][1] - det.kp[0][1]) * (float)height;
-      angle = std::atan2(eye_y, eye_x);
-      // Scale from bbox size (face bbox max dim * 1.5)
-      side = std::max(det.w * (float)width, det.h * (float)height) * 1.5f;
-
-      // Clamp crop size so it never exceeds the frame, then clamp center.
-      side = std::min(side, (float)std::min(width, height));
-      {
-        float half = side * 0.5f;
-        cx = std::max(half, std::min((float)width  - half, cx));
-        cy = std::max(half, std::min((float)height - half, cy));
-      }
-    }
-
-    if (!use_tracking) {
-      float dt = 1.0f / 30.0f;
-      cx = I.filter_cx.filter(cx, dt);
-      cy = I.filter_cy.filter(cy, dt);
-      side = I.filter_size.filter(side, dt);
+      roi = face_pipeline::roi_from_detection(faces[fi], width, height);
+      I.roi_filter.smooth(&roi, 1.0f / 30.0f);
       I.has_prev_roi = true;
+      cx = roi.cx; cy = roi.cy; side = roi.side; angle = roi.angle;
     }
 
     if (g_trt_logger.log_cb) {
@@ -606,16 +466,8 @@ GpuLandmarkResult TrtFaceLandmarker::detect(const uint8_t* d_rgba, int width,
     }
 
     // Build Affine Matrix (Forward: Dest -> Src)
-    float cos_a = std::cos(angle);
-    float sin_a = std::sin(angle);
-
-    // Scale maps each crop pixel to image pixels.
-    float scale = side / (float)I.LM_W; // side / 256.0f
-    float map_center = I.LM_W * 0.5f - 0.5f; // 127.5f
-    
     float m[6];
-    m[0] =  cos_a * scale; m[1] = -sin_a * scale; m[2] = cx - (cos_a * map_center * scale - sin_a * map_center * scale);
-    m[3] =  sin_a * scale; m[4] =  cos_a * scale; m[5] = cy - (sin_a * map_center * scale + cos_a * map_center * scale);
+    face_pipeline::crop_affine(roi, m);
 
     // Preprocess: warped crop + resize to 256x256 RGB float
     cuda_warp_affine_rgba_to_rgb_normalize(
@@ -655,57 +507,23 @@ GpuLandmarkResult TrtFaceLandmarker::detect(const uint8_t* d_rgba, int width,
     }
 
     // Transform landmarks from crop-local back to full-image [0,1]
-    for (int li = 0; li < 478; ++li) {
-      float lx = I.h_lm_landmarks[li * 3 + 0];
-      float ly = I.h_lm_landmarks[li * 3 + 1];
-      float lz = I.h_lm_landmarks[li * 3 + 2];
-
-      // Landmark coordinates are in [0, 256] pixel space (model output scale).
-      // The affine matrix uses scale=side/256, so center coord 128 → cx.
-      // No additional scaling needed.
-
-      // 1. Transform to Global Image Pixels using affine matrix m
-      float img_x_p = m[0] * lx + m[1] * ly + m[2];
-      float img_y_p = m[3] * lx + m[4] * ly + m[5];
-
-      // 2. Final Normalized Image Space [0, 1]
-      face_out.landmarks[li * 3 + 0] = img_x_p / (float)width;
-      face_out.landmarks[li * 3 + 1] = img_y_p / (float)height;
-      face_out.landmarks[li * 3 + 2] = lz / (float)I.LM_W; 
-    }
-
-    // Sanity check: verify that back-projected landmarks span a reasonable
-    // area of the image. The face-presence score (Identity_1) is unreliable
-    // in FP16 for our eye-center crop format (~0.0002 even for good detections).
-    // Instead, check that the landmark bounding box covers at least 5% of the
-    // image in both dimensions — a genuine face bbox should be ~10-40%.
-    // If the check fails, discard this result and force a full re-detection
-    // on the next frame.
-    {
-      float lm_xmin = face_out.landmarks[0], lm_xmax = face_out.landmarks[0];
-      float lm_ymin = face_out.landmarks[1], lm_ymax = face_out.landmarks[1];
-      for (int li = 1; li < 478; ++li) {
-        float lx = face_out.landmarks[li * 3 + 0];
-        float ly = face_out.landmarks[li * 3 + 1];
-        if (lx < lm_xmin) lm_xmin = lx;
-        if (lx > lm_xmax) lm_xmax = lx;
-        if (ly < lm_ymin) lm_ymin = ly;
-        if (ly > lm_ymax) lm_ymax = ly;
-      }
-      float lm_w = lm_xmax - lm_xmin;
-      float lm_h = lm_ymax - lm_ymin;
-      if (lm_w < 0.05f || lm_h < 0.05f) {
-        if (g_trt_logger.log_cb) {
-          g_trt_logger.log_cb(TrtLogLevel::WARNING, fmt_str("[TRT] Landmark sanity check failed (bbox %.3fx%.3f vs min 0.05) — resetting tracking", lm_w, lm_h));
-        }
-        I.has_prev_landmarks = false;
-        I.has_prev_roi = false;
-        I.filter_cx.first_time = true;
-        I.filter_cy.first_time = true;
-        I.filter_size.first_time = true;
-        result.face_count = 0;
-        return result;
+    face_pipeline::backproject_landmarks(I.h_lm_landmarks.data(), m, width, height,
+                                         face_out.landmarks.data());
+
+    // Sanity check: the face-presence score (Identity_1) is unreliable in
+    // FP16 for our eye-center crop format (~0.0002 even for good
+    // detections), so check the landmark extent instead. If the check
+    // fails, discard this result and force a full re-detection on the next
+    // frame.
+    if (!face_pipeline::landmarks_plausible(face_out.landmarks.data())) {
+      if (g_trt_logger.log_cb) {
+        g_trt_logger.log_cb(TrtLogLevel::WARNING, "[TRT] Landmark sanity check failed (bbox < 0.05 of frame) — resetting tracking");
       }
+      I.has_prev_landmarks = false;
+      I.has_prev_roi = false;
+      I.roi_filter.reset();
+      result.face_count = 0;
+      return result;
     }
 
     I.has_prev_landmarks = true;
@@ -0,0 +1,221 @@
+// gstshared/face_pipeline.cc
+#include "face_pipeline.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846f
+#endif
+
+namespace face_pipeline {
+
+namespace {
+
+float one_euro_alpha(float cutoff, float dt) {
+  float r = 2.0f * M_PI * cutoff * dt;
+  return r / (r + 1.0f);
+}
+
+}  // namespace
+
+float RoiOneEuroFilter::filter(float x, float dt) {
+  if (first_time) {
+    first_time = false;
+    x_prev = x; dx_prev = 0.0f;
+    return x;
+  }
+  if (dt <= 0) return x_prev;
+  float dx = (x - x_prev) / dt;
+  float edx = one_euro_alpha(d_cutoff, dt) * dx + (1.0f - one_euro_alpha(d_cutoff, dt)) * dx_prev;
+  float cutoff = min_cutoff + beta * std::abs(edx);
+  float a = one_euro_alpha(cutoff, dt);
+  float x_filtered = a * x + (1.0f - a) * x_prev;
+  x_prev = x_filtered; dx_prev = edx;
+  return x_filtered;
+}
+
+void RoiSmoother::smooth(FaceRoi* roi, float dt) {
+  roi->cx = cx.filter(roi->cx, dt);
+  roi->cy = cy.filter(roi->cy, dt);
+  roi->side = side.filter(roi->side, dt);
+}
+
+const std::vector<std::array<float, 2>>& anchors_128() {
+  // BlazeFace uses a specific anchor scheme:
+  // Feature maps at strides 8 and 16, 2 and 6 anchors per cell
+  static const std::vector<std::array<float, 2>> anchors = [] {
+    std::vector<std::array<float, 2>> a;
+    const int strides[] = {8, 16};
+    const int anchor_counts[] = {2, 6};
+    for (int s = 0; s < 2; ++s) {
+      int grid = kDetSize / strides[s];
+      for (int y = 0; y < grid; ++y) {
+        for (int x = 0; x < grid; ++x) {
+          float cx = (x + 0.5f) / (float)grid;
+          float cy = (y + 0.5f) / (float)grid;
+          for (int k = 0; k < anchor_counts[s]; ++k) a.push_back({cx, cy});
+        }
+      }
+    }
+    return a;
+  }();
+  return anchors;
+}
+
+std::vector<DetectedFace> decode_detections(
+    const float* raw_boxes, const float* raw_scores,
+    const std::vector<std::array<float, 2>>& anchors, float threshold,
+    int width, int height) {
+  std::vector<DetectedFace> faces;
+  int n = (int)anchors.size();
+
+  const float det = (float)kDetSize;
+  float scale = std::min(det / width, det / height);
+  float crop_w = width * scale;
+  float crop_h = height * scale;
+  float pad_x = (det - crop_w) * 0.5f;
+  float pad_y = (det - crop_h) * 0.5f;
+
+  for (int i = 0; i < n; ++i) {
+    // Score decoding: always apply sigmoid (raw scores are logits)
+    float score = 1.0f / (1.0f + std::exp(-raw_scores[i]));
+    if (score < threshold) continue;
+
+    DetectedFace f;
+    f.score = score;
+
+    // Decode box: center offset + size, relative to anchor
+    const float* b = raw_boxes + i * kBoxValues;
+    float ax = anchors[i][0] * det;
+    float ay = anchors[i][1] * det;
+
+    // Unpad and unscale to original image coordinates
+    f.cx = (b[0] + ax - pad_x) / crop_w;
+    f.cy = (b[1] + ay - pad_y) / crop_h;
+    f.w = b[2] / crop_w;
+    f.h = b[3] / crop_h;
+
+    for (int k = 0; k < 6; ++k) {
+      f.kp[k][0] = (b[4 + k * 2 + 0] + ax - pad_x) / crop_w;
+      f.kp[k][1] = (b[4 + k * 2 + 1] + ay - pad_y) / crop_h;
+    }
+    faces.push_back(f);
+  }
+
+  std::sort(faces.begin(), faces.end(),
+            [](const DetectedFace& a, const DetectedFace& b) {
+              return a.score > b.score;
+            });
+  return weighted_nms(faces, kNmsIou);
+}
+
+namespace {
+
+float iou(const DetectedFace& a, const DetectedFace& b) {
+  const float ix = std::min(a.cx + a.w * 0.5f, b.cx + b.w * 0.5f) -
+                   std::max(a.cx - a.w * 0.5f, b.cx - b.w * 0.5f);
+  const float iy = std::min(a.cy + a.h * 0.5f, b.cy + b.h * 0.5f) -
+                   std::max(a.cy - a.h * 0.5f, b.cy - b.h * 0.5f);
+  if (ix <= 0.f || iy <= 0.f) return 0.f;
+  const float inter = ix * iy;
+  const float uni = a.w * a.h + b.w * b.h - inter;
+  return uni > 0.f ? inter / uni : 0.f;
+}
+
+}  // namespace
+
+std::vector<DetectedFace> weighted_nms(const std::vector<DetectedFace>& sorted, float iou_thr) {
+  // MediaPipe's WEIGHTED NonMaxSuppression: the best remaining detection
+  // absorbs every detection overlapping it by more than iou_thr, and its
+  // box and keypoints become their score-weighted mean. Its score stays.
+  std::vector<DetectedFace> out;
+  std::vector<char> used(sorted.size(), 0);
+  for (size_t i = 0; i < sorted.size(); ++i) {
+    if (used[i]) continue;
+    const DetectedFace& best = sorted[i];
+    DetectedFace m = best;
+    float wsum = 0.f, cx = 0.f, cy = 0.f, w = 0.f, h = 0.f, kp[6][2] = {};
+    for (size_t j = i; j < sorted.size(); ++j) {
+      if (used[j] || (j != i && iou(best, sorted[j]) <= iou_thr)) continue;
+      used[j] = 1;
+      const DetectedFace& d = sorted[j];
+      wsum += d.score;
+      cx += d.score * d.cx; cy += d.score * d.cy;
+      w += d.score * d.w;   h += d.score * d.h;
+      for (int k = 0; k < 6; ++k) {
+        kp[k][0] += d.score * d.kp[k][0];
+        kp[k][1] += d.score * d.kp[k][1];
+      }
+    }
+    if (wsum > 0.f) {
+      const float inv = 1.f / wsum;
+      m.cx = cx * inv; m.cy = cy * inv; m.w = w * inv; m.h = h * inv;
+      for (int k = 0; k < 6; ++k) {
+        m.kp[k][0] = kp[k][0] * inv;
+        m.kp[k][1] = kp[k][1] * inv;
+      }
+    }
+    out.push_back(m);
+  }
+  return out;
+}
+
+FaceRoi roi_from_detection(const DetectedFace& det, int width, int height) {
+  FaceRoi r;
+  r.cx = det.cx * (float)width;
+  r.cy = det.cy * (float)height;
+
+  float eye_x = (det.kp[1][0] - det.kp[0][0]) * (float)width;
+  float eye_y = (det.kp[1][1] - det.kp[0][1]) * (float)height;
+  r.angle = std::atan2(eye_y, eye_x);
+  // Scale from bbox size (face bbox max dim * 1.5)
+  r.side = std::max(det.w * (float)width, det.h * (float)height) * 1.5f;
+
+  // Clamp crop size so it never exceeds the frame, then clamp center.
+  r.side = std::min(r.side, (float)std::min(width, height));
+  float half = r.side * 0.5f;
+  r.cx = std::max(half, std::min((float)width - half, r.cx));
+  r.cy = std::max(half, std::min((float)height - half, r.cy));
+  return r;
+}
+
+void crop_affine(const FaceRoi& roi, float m[6]) {
+  float cos_a = std::cos(roi.angle);
+  float sin_a = std::sin(roi.angle);
+
+  // Scale maps each crop pixel to image pixels.
+  float scale = roi.side / (float)kLmSize;
+  float map_center = kLmSize * 0.5f - 0.5f;
+
+  m[0] =  cos_a * scale; m[1] = -sin_a * scale; m[2] = roi.cx - (cos_a * map_center * scale - sin_a * map_center * scale);
+  m[3] =  sin_a * scale; m[4] =  cos_a * scale; m[5] = roi.cy - (sin_a * map_center * scale + cos_a * map_center * scale);
+}
+
+void backproject_landmarks(const float* raw, const float m[6], int width,
+                           int height, float* out_xyz) {
+  // Landmark coordinates are in [0, kLmSize] pixel space (model output
+  // scale); the affine matrix already includes side / kLmSize.
+  for (int li = 0; li < kNumLandmarks; ++li) {
+    float lx = raw[li * 3 + 0];
+    float ly = raw[li * 3 + 1];
+    float lz = raw[li * 3 + 2];
+    out_xyz[li * 3 + 0] = (m[0] * lx + m[1] * ly + m[2]) / (float)width;
+    out_xyz[li * 3 + 1] = (m[3] * lx + m[4] * ly + m[5]) / (float)height;
+    out_xyz[li * 3 + 2] = lz / (float)kLmSize;
+  }
+}
+
+bool landmarks_plausible(const float* xyz, float min_extent) {
+  float xmin = xyz[0], xmax = xyz[0];
+  float ymin = xyz[1], ymax = xyz[1];
+  for (int li = 1; li < kNumLandmarks; ++li) {
+    xmin = std::min(xmin, xyz[li * 3 + 0]);
+    xmax = std::max(xmax, xyz[li * 3 + 0]);
+    ymin = std::min(ymin, xyz[li * 3 + 1]);
+    ymax = std::max(ymax, xyz[li * 3 + 1]);
+  }
+  return (xmax - xmin) >= min_extent && (ymax - ymin) >= min_extent;
+}
+
+}  // namespace face_pipeline
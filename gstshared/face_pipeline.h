@@ -0,0 +1,90 @@
+// gstshared/face_pipeline.h
+// Backend-agnostic pieces of the two-stage face landmark pipeline
+// (BlazeFace short-range detector -> 478-point landmark regressor), shared
+// by the TensorRT plugin and the OpenCV-DNN runtime:
+//   - SSD anchor generation and detector output decoding
+//   - ROI selection, smoothing and the crop affine transform
+//   - landmark back-projection and plausibility check
+// Pure C++; no CUDA, OpenCV or MediaPipe dependency.
+#pragma once
+
+#include <array>
+#include <vector>
+
+namespace face_pipeline {
+
+constexpr int kDetSize = 128;        // detector input is kDetSize x kDetSize RGB
+constexpr int kLmSize = 256;         // landmark input is kLmSize x kLmSize RGB
+constexpr int kNumAnchors = 896;
+constexpr int kBoxValues = 16;       // per anchor: cx, cy, w, h + 6 keypoints
+constexpr int kNumLandmarks = 478;
+
+struct DetectedFace {
+  float cx, cy, w, h;  // normalized center + size
+  float score;
+  // 6 keypoints (eye, ear, nose, mouth) - used for face crop alignment
+  float kp[6][2];
+};
+
+// One-Euro filter used to smooth the crop ROI between frames.
+struct RoiOneEuroFilter {
+  // Aggressive responsiveness: 2.0Hz base cutoff, 0.05 beta for instant motion follow.
+  float min_cutoff = 2.0f, beta = 0.05f, d_cutoff = 1.0f;
+  bool first_time = true;
+  float x_prev = 0.0f, dx_prev = 0.0f;
+
+  float filter(float x, float dt);
+  void reset() { first_time = true; }
+};
+
+// Crop ROI in image pixels; angle in radians (eye line).
+struct FaceRoi {
+  float cx = 0, cy = 0, side = 0, angle = 0;
+};
+
+struct RoiSmoother {
+  RoiOneEuroFilter cx, cy, side;
+  void smooth(FaceRoi* roi, float dt);
+  void reset() { cx.reset(); cy.reset(); side.reset(); }
+};
+
+// BlazeFace SSD anchors for the 128x128 short-range model (896 entries).
+const std::vector<std::array<float, 2>>& anchors_128();
+
+// IoU above which the detector's overlapping boxes are merged into one face
+// (BlazeFace's min_suppression_threshold).
+constexpr float kNmsIou = 0.3f;
+
+// Decodes raw detector outputs (kNumAnchors x kBoxValues boxes, kNumAnchors
+// logits) into faces above threshold, best first, in normalized coordinates
+// of a width x height frame that was letterboxed into the detector input.
+// Overlapping boxes are merged by weighted_nms, so each face appears once.
+std::vector<DetectedFace> decode_detections(
+    const float* raw_boxes, const float* raw_scores,
+    const std::vector<std::array<float, 2>>& anchors, float threshold,
+    int width, int height);
+
+// Weighted non-maximum suppression over detections sorted best first:
+// each kept face is the score-weighted mean of the detections overlapping
+// it by more than iou_thr.
+std::vector<DetectedFace> weighted_nms(const std::vector<DetectedFace>& sorted, float iou_thr);
+
+// Square, eye-aligned crop around a detection (1.5x the box), clamped so it
+// stays inside the frame.
+FaceRoi roi_from_detection(const DetectedFace& det, int width, int height);
+
+// Affine matrix mapping crop pixels (kLmSize x kLmSize) to image pixels:
+//   x_img = m[0]*x + m[1]*y + m[2],  y_img = m[3]*x + m[4]*y + m[5]
+void crop_affine(const FaceRoi& roi, float m[6]);
+
+// Maps raw landmark output (kNumLandmarks x 3, crop pixel space) back to
+// normalized [0,1] image coordinates; z is scaled by the crop size.
+void backproject_landmarks(const float* raw, const float m[6], int width,
+                           int height, float* out_xyz);
+
+// The landmark model's presence score is unreliable after conversion, so a
+// result is accepted when its landmarks span at least min_extent of the frame
+// in both dimensions.
+bool landmarks_plausible(const float* xyz, float min_extent = 0.05f);
+
+}  // namespace face_pipeline
@@ -0,0 +1,128 @@
+// gstshared/mozza_landmarks_meta.cc
+#include "mozza_landmarks_meta.h"
+
+#include <gst/video/video.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+gboolean meta_init(GstMeta* meta, gpointer, GstBuffer*) {
+  auto* m = reinterpret_cast<GstMozzaLandmarksMeta*>(meta);
+  m->width = m->height = 0;
+  m->timestamp_us = 0;
+  m->n_faces = m->n_landmarks = 0;
+  m->landmarks = nullptr;
+  m->frame_hash = 0;
+  return TRUE;
+}
+
+void meta_free(GstMeta* meta, GstBuffer*) {
+  auto* m = reinterpret_cast<GstMozzaLandmarksMeta*>(meta);
+  g_clear_pointer(&m->landmarks, g_free);
+}
+
+GstMozzaLandmarksMeta* add_copy(GstBuffer* buffer, const GstMozzaLandmarksMeta* src,
+                                gint width, gint height, guint64 frame_hash) {
+  auto* m = reinterpret_cast<GstMozzaLandmarksMeta*>(
+      gst_buffer_add_meta(buffer, GST_MOZZA_LANDMARKS_META_INFO, nullptr));
+  if (!m) return nullptr;
+  m->width = width;
+  m->height = height;
+  m->timestamp_us = src->timestamp_us;
+  m->frame_hash = frame_hash;
+  m->n_faces = src->n_faces;
+  m->n_landmarks = src->n_landmarks;
+  if (src->landmarks)
+    m->landmarks = static_cast<MpLandmark*>(
+        g_memdup2(src->landmarks, sizeof(MpLandmark) * src->n_faces * src->n_landmarks));
+  return m;
+}
+
+// Normalized landmarks survive copies and scaling unchanged; other
+// transforms (crops, flips...) would invalidate them, so the meta is dropped.
+// The frame hash only survives copies: scaled pixels are other pixels.
+gboolean meta_transform(GstBuffer* dest, GstMeta* meta, GstBuffer*, GQuark type, gpointer data) {
+  const auto* src = reinterpret_cast<const GstMozzaLandmarksMeta*>(meta);
+  if (GST_META_TRANSFORM_IS_COPY(type))
+    return add_copy(dest, src, src->width, src->height, src->frame_hash) != nullptr;
+  if (GST_VIDEO_META_TRANSFORM_IS_SCALE(type)) {
+    const auto* t = static_cast<const GstVideoMetaTransform*>(data);
+    return add_copy(dest, src, GST_VIDEO_INFO_WIDTH(t->out_info),
+                    GST_VIDEO_INFO_HEIGHT(t->out_info), 0) != nullptr;
+  }
+  return FALSE;
+}
+
+}  // namespace
+
+GType gst_mozza_landmarks_meta_api_get_type(void) {
+  static gsize type_id = 0;
+  if (g_once_init_enter(&type_id)) {
+    // "size" and "orientation" make scalers transform it and flippers
+    // leave it alone rather than copy it blindly.
+    static const gchar* tags[] = {GST_META_TAG_VIDEO_STR, GST_META_TAG_VIDEO_SIZE_STR,
+                                  GST_META_TAG_VIDEO_ORIENTATION_STR, nullptr};
+    GType t = g_type_from_name("GstMozzaLandmarksMetaAPI");
+    if (!t) t = gst_meta_api_type_register("GstMozzaLandmarksMetaAPI", tags);
+    g_once_init_leave(&type_id, t);
+  }
+  return static_cast<GType>(type_id);
+}
+
+const GstMetaInfo* gst_mozza_landmarks_meta_get_info(void) {
+  static const GstMetaInfo* info = nullptr;
+  if (g_once_init_enter(const_cast<GstMetaInfo**>(&info))) {
+    const GstMetaInfo* i = gst_meta_get_info("GstMozzaLandmarksMeta");
+    if (!i)
+      i = gst_meta_register(GST_MOZZA_LANDMARKS_META_API_TYPE, "GstMozzaLandmarksMeta",
+                            sizeof(GstMozzaLandmarksMeta), meta_init, meta_free, meta_transform);
+    g_once_init_leave(const_cast<GstMetaInfo**>(&info), const_cast<GstMetaInfo*>(i));
+  }
+  return info;
+}
+
+GstMozzaLandmarksMeta* gst_buffer_add_mozza_landmarks_meta(GstBuffer* buffer,
+                                                           const MpFaceResult* res,
+                                                           gint width, gint height) {
+  g_return_val_if_fail(GST_IS_BUFFER(buffer) && res, nullptr);
+  auto* m = reinterpret_cast<GstMozzaLandmarksMeta*>(
+      gst_buffer_add_meta(buffer, GST_MOZZA_LANDMARKS_META_INFO, nullptr));
+  if (!m) return nullptr;
+  m->width = width;
+  m->height = height;
+  m->timestamp_us = res->timestamp_us;
+
+  guint faces = 0, per_face = 0;
+  for (int i = 0; i < res->faces_count; ++i) {
+    if (res->faces[i].landmarks_count <= 0) continue;
+    faces += 1;
+    per_face = std::max<guint>(per_face, res->faces[i].landmarks_count);
+  }
+  if (faces == 0) return m;
+
+  m->landmarks = g_new0(MpLandmark, static_cast<gsize>(faces) * per_face);
+  guint k = 0;
+  for (int i = 0; i < res->faces_count; ++i) {
+    const MpFace& f = res->faces[i];
+    if (f.landmarks_count <= 0) continue;
+    std::memcpy(m->landmarks + static_cast<size_t>(k++) * per_face, f.landmarks,
+                sizeof(MpLandmark) * f.landmarks_count);
+  }
+  m->n_faces = faces;
+  m->n_landmarks = per_face;
+  return m;
+}
+
+void gst_mozza_landmarks_meta_as_result(const GstMozzaLandmarksMeta* meta,
+                                        MpFaceResult* out, std::vector<MpFace>* faces) {
+  faces->assign(meta->n_faces, MpFace{});
+  for (guint i = 0; i < meta->n_faces; ++i) {
+    (*faces)[i].landmarks = meta->landmarks + static_cast<size_t>(i) * meta->n_landmarks;
+    (*faces)[i].landmarks_count = static_cast<int32_t>(meta->n_landmarks);
+  }
+  out->faces = faces->empty() ? nullptr : faces->data();
+  out->faces_count = static_cast<int32_t>(meta->n_faces);
+  out->timestamp_us = meta->timestamp_us;
+}
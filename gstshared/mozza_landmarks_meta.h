@@ -0,0 +1,50 @@
+// gstshared/mozza_landmarks_meta.h
+// GstMozzaLandmarksMeta: face landmarks attached to the video buffer they
+// were detected on, so one inference can feed any number of effects.
+// facelandmarks attaches it; mozza_mp uses it instead of running its own
+// detection when it is present.
+//
+// Landmarks are normalized to the frame (like MpLandmark), so the meta stays
+// valid across copies and scaling (width/height follow the scaled frame).
+// Both plugins carry this code; the API type and GstMetaInfo are registered
+// by whichever loads first and looked up by name by the other.
+#pragma once
+
+#include <gst/gst.h>
+
+#include <vector>
+
+#include "mp_runtime.h"
+
+#define GST_MOZZA_LANDMARKS_META_API_TYPE (gst_mozza_landmarks_meta_api_get_type())
+#define GST_MOZZA_LANDMARKS_META_INFO     (gst_mozza_landmarks_meta_get_info())
+
+typedef struct _GstMozzaLandmarksMeta {
+  GstMeta meta;
+
+  gint    width;            // frame size the landmarks are normalized to
+  gint    height;
+  gint64  timestamp_us;     // timestamp the detector saw (MpFaceResult::timestamp_us)
+  guint   n_faces;
+  guint   n_landmarks;      // per face; shorter faces are zero-padded
+  MpLandmark* landmarks;    // n_faces * n_landmarks, owned by the meta
+  guint64 frame_hash;       // hash of the frame's pixels as detected, 0 = not hashed;
+                            // kept on copies, cleared by scaling and by
+                            // elements that change the pixels
+} GstMozzaLandmarksMeta;
+
+GType gst_mozza_landmarks_meta_api_get_type(void);
+const GstMetaInfo* gst_mozza_landmarks_meta_get_info(void);
+
+// Copies the landmarks of res (faces without landmarks are skipped).
+GstMozzaLandmarksMeta* gst_buffer_add_mozza_landmarks_meta(GstBuffer* buffer,
+                                                           const MpFaceResult* res,
+                                                           gint width, gint height);
+
+#define gst_buffer_get_mozza_landmarks_meta(b) \
+  ((GstMozzaLandmarksMeta*)gst_buffer_get_meta((b), GST_MOZZA_LANDMARKS_META_API_TYPE))
+
+// Presents the meta as an MpFaceResult whose faces point into the meta and
+// into *faces. Valid while both live; never pass it to face_free_result.
+void gst_mozza_landmarks_meta_as_result(const GstMozzaLandmarksMeta* meta,
+                                        MpFaceResult* out, std::vector<MpFace>* faces);
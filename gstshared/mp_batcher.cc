@@ -0,0 +1,161 @@
+// gstshared/mp_batcher.cc
+#include "mp_batcher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "mp_runtime_loader.h"
+
+namespace mp_batcher {
+
+namespace {
+
+// One queued frame; lives on the submitting thread's stack until done.
+struct Slot {
+  MpFaceCtx* ctx;
+  const MpImage* img;
+  int64_t ts_us;
+  MpFaceResult* out;
+  int rc = 0;
+  bool queued = true;   // still in Group::pending
+  bool done = false;
+};
+
+}  // namespace
+
+class Group {
+ public:
+  std::mutex mu;
+  std::condition_variable cv;
+  int members = 0;
+  bool collecting = false;      // a leader is waiting for its window
+  std::vector<Slot*> pending;
+  uint64_t batches = 0;         // since the last take_mean_batch()
+  uint64_t batched_frames = 0;
+
+  void run(std::unique_lock<std::mutex>& lk, Slot* self, int window_us);
+
+ private:
+  void lead(std::unique_lock<std::mutex>& lk, int window_us);
+};
+
+namespace {
+
+std::mutex g_groups_mu;
+std::map<std::string, std::weak_ptr<Group>> g_groups;
+
+std::shared_ptr<Group> group_for(const std::string& key) {
+  std::lock_guard<std::mutex> lock(g_groups_mu);
+  std::shared_ptr<Group> g = g_groups[key].lock();
+  if (!g) {
+    g = std::make_shared<Group>();
+    g_groups[key] = g;
+  }
+  return g;
+}
+
+}  // namespace
+
+// Called with `self` queued. A thread whose frame is queued while nobody is
+// collecting becomes the leader: it waits for the window, takes up to
+// kMaxBatch frames and runs them with the lock released, so later arrivals
+// can start the next window meanwhile. Everyone else waits until their frame
+// is done, or until it is left over and they have to lead.
+void Group::run(std::unique_lock<std::mutex>& lk, Slot* self, int window_us) {
+  while (!self->done) {
+    if (!collecting && self->queued) {
+      lead(lk, window_us);
+      continue;
+    }
+    cv.notify_all();  // the leader may be waiting for a full house
+    cv.wait(lk, [&] { return self->done || (!collecting && self->queued); });
+  }
+}
+
+void Group::lead(std::unique_lock<std::mutex>& lk, int window_us) {
+  collecting = true;
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(window_us);
+  cv.wait_until(lk, deadline, [&] {
+    return (int)pending.size() >= members || (int)pending.size() >= kMaxBatch;
+  });
+  const size_t n = std::min<size_t>(pending.size(), kMaxBatch);
+  std::vector<Slot*> batch(pending.begin(), pending.begin() + n);
+  pending.erase(pending.begin(), pending.begin() + n);
+  for (Slot* s : batch) s->queued = false;
+  collecting = false;
+  batches += 1;
+  batched_frames += n;
+  cv.notify_all();  // leftovers may need a new leader
+  lk.unlock();
+
+  std::vector<MpFaceCtx*> ctxs(n);
+  std::vector<MpImage> imgs(n);
+  std::vector<int64_t> ts(n);
+  std::vector<MpFaceResult> outs(n);
+  std::vector<int32_t> rcs(n, -1);  // frames the runtime left unreported are retried
+  for (size_t i = 0; i < n; ++i) {
+    ctxs[i] = batch[i]->ctx;
+    imgs[i] = *batch[i]->img;
+    ts[i] = batch[i]->ts_us;
+  }
+  const int rc = MpApi().face_detect_batch(ctxs.data(), imgs.data(), ts.data(),
+                                           static_cast<int32_t>(n), outs.data(), rcs.data());
+  // Only the frames that failed are detected again, on their own, so one bad
+  // frame does not cost the other streams their landmarks, and a frame that
+  // succeeded does not advance its context twice.
+  if (rc == 0) {
+    std::fill(rcs.begin(), rcs.end(), 0);
+  } else {
+    for (size_t i = 0; i < n; ++i) {
+      if (rcs[i] == 0) continue;
+      MpApi().face_free_result(&outs[i]);
+      outs[i] = MpFaceResult{};
+      rcs[i] = MpApi().face_detect(ctxs[i], &imgs[i], ts[i], &outs[i]);
+    }
+  }
+
+  lk.lock();
+  for (size_t i = 0; i < n; ++i) {
+    *batch[i]->out = outs[i];
+    batch[i]->rc = rcs[i];
+    batch[i]->done = true;
+  }
+  cv.notify_all();
+}
+
+Member::Member(const std::string& key, MpFaceCtx* ctx, int window_us)
+    : group_(group_for(key)), ctx_(ctx), window_us_(window_us) {
+  std::lock_guard<std::mutex> lock(group_->mu);
+  group_->members += 1;
+}
+
+Member::~Member() {
+  std::lock_guard<std::mutex> lock(group_->mu);
+  group_->members -= 1;
+  group_->cv.notify_all();  // a leader waiting for us should stop waiting
+}
+
+int Member::detect(const MpImage* img, int64_t ts_us, MpFaceResult* out) {
+  if (window_us_ <= 0 || !MpApiHas(6) || !MpApi().face_detect_batch)
+    return MpApi().face_detect(ctx_, img, ts_us, out);
+
+  Slot slot{ctx_, img, ts_us, out};
+  std::unique_lock<std::mutex> lk(group_->mu);
+  group_->pending.push_back(&slot);
+  group_->run(lk, &slot, window_us_);
+  return slot.rc;
+}
+
+double Member::take_mean_batch() {
+  std::lock_guard<std::mutex> lock(group_->mu);
+  const double mean = group_->batches ? (double)group_->batched_frames / group_->batches : 0.0;
+  group_->batches = 0;
+  group_->batched_frames = 0;
+  return mean;
+}
+
+}  // namespace mp_batcher
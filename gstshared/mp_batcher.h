@@ -0,0 +1,47 @@
+// gstshared/mp_batcher.h
+// In-process scheduler that gathers face_detect calls from several element
+// instances sharing a model and runs them as one face_detect_batch (v6).
+//
+// Each instance keeps its own MpFaceCtx (tracking state is per stream) and
+// joins the group for its model. A call blocks until the batch holding its
+// frame has run. The first frame to arrive opens a window of window_us. The
+// batch is dispatched when every member has submitted, when kMaxBatch frames
+// are queued, or when the window expires, whichever comes first.
+// With window_us <= 0, or a runtime older than v6 or without a batch entry
+// point, detect() is a plain face_detect. When a batch call fails, its
+// frames are detected again one by one, so each member gets its own status.
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "mp_runtime.h"
+
+namespace mp_batcher {
+
+constexpr int kMaxBatch = 16;
+
+class Group;
+
+class Member {
+ public:
+  Member(const std::string& key, MpFaceCtx* ctx, int window_us);
+  ~Member();
+  Member(const Member&) = delete;
+  Member& operator=(const Member&) = delete;
+
+  // Same contract as MpRuntimeApi::face_detect for this member's context.
+  int detect(const MpImage* img, int64_t ts_us, MpFaceResult* out);
+
+  // Mean frames per dispatched batch for the whole group since the last call
+  // (0 if no batch ran).
+  double take_mean_batch();
+
+ private:
+  std::shared_ptr<Group> group_;
+  MpFaceCtx* ctx_;
+  int window_us_;
+};
+
+}  // namespace mp_batcher
@@ -0,0 +1,130 @@
+// gstshared/mp_cpu_budget.cc
+#include "mp_cpu_budget.h"
+
+#include <sched.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace mp_cpu_budget {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+int env_int(const char* name, int def) {
+  const char* v = std::getenv(name);
+  return (v && *v) ? std::atoi(v) : def;
+}
+
+int online_cpus() {
+  cpu_set_t set;
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) return std::max(1, CPU_COUNT(&set));
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// MP_CPU_BUDGET: a core count, "auto" for online_cpus(), unset = 0 (off).
+int budget_from_env() {
+  const char* v = std::getenv("MP_CPU_BUDGET");
+  if (!v || !*v) return 0;
+  if (std::strcmp(v, "auto") == 0) return online_cpus();
+  return std::max(0, std::atoi(v));
+}
+
+struct Member {
+  int requested;
+  MpCpuAllocation alloc;
+};
+
+struct Coordinator {
+  std::mutex mu;
+  const int budget = budget_from_env();
+  const int settle_ms = env_int("MP_CPU_BUDGET_SETTLE_MS", 2000);
+  std::map<int, Member> members;   // ordered by id: older contexts first
+  int next_id = 0;
+  uint32_t generation = 0;
+  Clock::time_point changed_at = Clock::now();
+
+  // Even split; the first budget % n contexts get one core more. A share
+  // of one core is all inference, and its warp runs on the caller's
+  // streaming thread. Inference and warp never exceed the share, so the
+  // total stays within the budget unless there are more contexts than
+  // cores: each context still gets one thread, reported as overcommit.
+  void rebalance() {
+    const int n = static_cast<int>(members.size());
+    generation += 1;
+    changed_at = Clock::now();
+    if (n == 0) return;
+    int warp_pool = 0, total = 0, i = 0;
+    for (auto& [id, m] : members) {
+      const int share = std::max(1, budget / n + (i++ < budget % n ? 1 : 0));
+      int inference = std::max(1, share - 1);
+      if (m.requested > 0) inference = std::min(inference, m.requested);
+      m.alloc.inference_threads = inference;
+      m.alloc.warp_threads = share - inference;
+      warp_pool += m.alloc.warp_threads;
+      total += share;
+    }
+    for (auto& [id, m] : members) {
+      m.alloc.budget = budget;
+      m.alloc.contexts = n;
+      m.alloc.warp_pool = warp_pool;
+      m.alloc.generation = generation;
+      m.alloc.overcommit = std::max(0, total - budget);
+    }
+  }
+};
+
+Coordinator& coordinator() {
+  static Coordinator* c = new Coordinator();  // never destroyed: contexts may outlive statics
+  return *c;
+}
+
+}  // namespace
+
+bool enabled() { return coordinator().budget > 0; }
+
+int join(int requested) {
+  Coordinator& c = coordinator();
+  if (c.budget <= 0) return -1;
+  std::lock_guard<std::mutex> lock(c.mu);
+  const int id = c.next_id++;
+  c.members[id] = Member{requested, MpCpuAllocation{}};
+  c.rebalance();
+  return id;
+}
+
+void leave(int id) {
+  if (id < 0) return;
+  Coordinator& c = coordinator();
+  std::lock_guard<std::mutex> lock(c.mu);
+  if (c.members.erase(id)) c.rebalance();
+}
+
+void get(int id, int requested, MpCpuAllocation* out) {
+  Coordinator& c = coordinator();
+  if (id >= 0) {
+    std::lock_guard<std::mutex> lock(c.mu);
+    auto it = c.members.find(id);
+    if (it != c.members.end()) {
+      *out = it->second.alloc;
+      return;
+    }
+  }
+  *out = MpCpuAllocation{};
+  out->budget = std::max(0, c.budget);
+  out->inference_threads = requested;
+}
+
+bool settled() {
+  Coordinator& c = coordinator();
+  std::lock_guard<std::mutex> lock(c.mu);
+  return Clock::now() - c.changed_at >= std::chrono::milliseconds(c.settle_ms);
+}
+
+}  // namespace mp_cpu_budget
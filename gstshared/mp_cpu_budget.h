@@ -0,0 +1,41 @@
+// gstshared/mp_cpu_budget.h
+// Process-wide CPU budget shared by every context of a runtime (v7).
+//
+// Each element instance used to ask for its own `threads`, so a dozen
+// pipelines in one process ran a dozen full-size inference thread pools.
+// With MP_CPU_BUDGET set, contexts join the coordinator instead; the budget
+// is split evenly between live contexts,
+// and each share is divided into inference threads (at most the requested
+// count, leaving one core for the caller) and warp threads. A one-core
+// share has no warp threads. The split is recomputed whenever a context
+// joins or leaves; `generation` changes then.
+//
+//   MP_CPU_BUDGET            cores to divide, or "auto" for the CPUs this
+//                            process may run on; unset or 0 = off (each
+//                            context keeps its requested thread count)
+//   MP_CPU_BUDGET_SETTLE_MS  how long a new split must hold before runtimes
+//                            rebuild contexts for it (default 2000)
+#pragma once
+
+#include "mp_runtime.h"
+
+namespace mp_cpu_budget {
+
+// False unless MP_CPU_BUDGET is set: contexts keep their requested thread
+// counts.
+bool enabled();
+
+// Registers a live context asking for `requested` inference threads
+// (<= 0: no preference) and returns its id (-1 when disabled).
+int join(int requested);
+void leave(int id);
+
+// Current share of context `id`. When disabled (or id < 0) this reports the
+// requested count and no warp threads.
+void get(int id, int requested, MpCpuAllocation* out);
+
+// True once the split has been stable for MP_CPU_BUDGET_SETTLE_MS, so a
+// burst of pipelines starting together does not rebuild contexts each time.
+bool settled();
+
+}  // namespace mp_cpu_budget
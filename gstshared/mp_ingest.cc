@@ -0,0 +1,150 @@
+// gstshared/mp_ingest.cc
+#include "mp_ingest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace mp_ingest {
+
+namespace {
+
+inline uint8_t clamp_u8(int v) {
+  return static_cast<uint8_t>(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+// Source range [b[i], b[i + 1]) covered by each of n output samples.
+// Ranges are floor(src / n) or one more samples wide.
+void area_bounds(int src, int n, std::vector<int>* b) {
+  b->resize(n + 1);
+  for (int i = 0; i <= n; ++i)
+    (*b)[i] = static_cast<int>(static_cast<int64_t>(i) * src / n);
+}
+
+// col[x] += row[x] for x < n: the only loop that reads every source pixel,
+// so it is the one written with intrinsics (16 pixels per step).
+void accumulate_row(uint16_t* col, const uint8_t* row, int n) {
+  int x = 0;
+#if defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  for (; x + 16 <= n; x += 16) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x));
+    __m128i* c = reinterpret_cast<__m128i*>(col + x);
+    _mm_storeu_si128(c, _mm_add_epi16(_mm_loadu_si128(c), _mm_unpacklo_epi8(v, zero)));
+    _mm_storeu_si128(c + 1, _mm_add_epi16(_mm_loadu_si128(c + 1), _mm_unpackhi_epi8(v, zero)));
+  }
+#elif defined(__ARM_NEON)
+  for (; x + 16 <= n; x += 16) {
+    const uint8x16_t v = vld1q_u8(row + x);
+    vst1q_u16(col + x, vaddw_u8(vld1q_u16(col + x), vget_low_u8(v)));
+    vst1q_u16(col + x + 8, vaddw_u8(vld1q_u16(col + x + 8), vget_high_u8(v)));
+  }
+#endif
+  for (; x < n; ++x) col[x] += row[x];
+}
+
+// ceil(2^40 / n): (sum + n / 2) * recip >> 40 == round(sum / n) for any
+// sum of n bytes while n < 65536.
+inline uint64_t recip40(uint32_t n) { return ((uint64_t(1) << 40) + n - 1) / n; }
+
+}  // namespace
+
+int scaled_size(int n, double s) {
+  if (n <= 0) return 1;
+  const int m = static_cast<int>(std::lround(n * s));
+  return std::clamp(m, 1, n);
+}
+
+// Per output row: the rows of its area are summed column-wise into col
+// (accumulate_row), then each output pixel sums its columns and divides by
+// the area. Column widths take at most two values, so the reciprocals are
+// two per row.
+bool yuv420_to_rgb_area(const MpImage& img, int out_w, int out_h, uint8_t* dst,
+                        int dst_stride) {
+  if (img.width <= 0 || img.height <= 0 || !dst) return false;
+  if (img.format != MP_IMAGE_NV12 && img.format != MP_IMAGE_I420) return false;
+
+  const int W = img.width, H = img.height;
+  const int w = out_w, h = out_h;
+  if (w <= 0 || h <= 0 || w > W || h > H) return false;
+  if ((H + h - 1) / h > 257) return false;  // col sums must fit 16 bits
+
+  const uint8_t* y_plane = img.planes[0] ? img.planes[0] : img.data;
+  const int y_stride = img.strides[0] ? img.strides[0] : img.stride;
+  const uint8_t* u_plane = img.planes[1];
+  const uint8_t* v_plane = nullptr;
+  int u_stride = img.strides[1], v_stride = 0, c_step = 1;
+  if (img.format == MP_IMAGE_NV12) {
+    v_plane = u_plane ? u_plane + 1 : nullptr;
+    v_stride = u_stride;
+    c_step = 2;
+  } else {
+    v_plane = img.planes[2];
+    v_stride = img.strides[2];
+  }
+  if (!y_plane || !u_plane || !v_plane) return false;
+
+  const int cw = (W + 1) / 2, ch = (H + 1) / 2;
+  std::vector<int> xb, yb;
+  area_bounds(W, w, &xb);
+  area_bounds(H, h, &yb);
+  const int wmin = W / w;
+
+  std::vector<uint16_t> col(W);
+  std::vector<int16_t> yv(w), uv(w), vv(w);
+  std::vector<int> cx(w);
+  for (int ox = 0; ox < w; ++ox)
+    cx[ox] = std::min(((xb[ox] + xb[ox + 1]) / 2) >> 1, cw - 1) * c_step;
+
+  for (int oy = 0; oy < h; ++oy) {
+    // Luma: vertical sums over the area's rows, then horizontal sums.
+    const int y0 = yb[oy], rows = yb[oy + 1] - y0;
+    const uint8_t* src = y_plane + static_cast<size_t>(y0) * y_stride;
+    std::fill(col.begin(), col.end(), 0);
+    for (int r = 0; r < rows; ++r)
+      accumulate_row(col.data(), src + static_cast<size_t>(r) * y_stride, W);
+
+    if (w == W && rows == 1) {
+      for (int ox = 0; ox < w; ++ox) yv[ox] = static_cast<int16_t>(col[ox]);
+    } else {
+      const uint32_t n0 = static_cast<uint32_t>(wmin * rows), n1 = n0 + rows;
+      const uint64_t rec[2] = {recip40(n0), recip40(n1)};
+      const uint32_t half[2] = {n0 / 2, n1 / 2};
+      for (int ox = 0; ox < w; ++ox) {
+        const int x0 = xb[ox], x1 = xb[ox + 1];
+        uint32_t sum = 0;
+        for (int x = x0; x < x1; ++x) sum += col[x];
+        const int wide = (x1 - x0) - wmin;  // 0 or 1
+        yv[ox] = static_cast<int16_t>(((sum + half[wide]) * rec[wide]) >> 40);
+      }
+    }
+
+    // Chroma: nearest 4:2:0 sample to the area's centre.
+    const int cy = std::min(((y0 + yb[oy + 1]) / 2) >> 1, ch - 1);
+    const uint8_t* urow = u_plane + static_cast<size_t>(cy) * u_stride;
+    const uint8_t* vrow = v_plane + static_cast<size_t>(cy) * v_stride;
+    for (int ox = 0; ox < w; ++ox) {
+      uv[ox] = static_cast<int16_t>(urow[cx[ox]] - 128);
+      vv[ox] = static_cast<int16_t>(vrow[cx[ox]] - 128);
+    }
+
+    // BT.601 limited range, 8-bit fixed point.
+    uint8_t* out = dst + static_cast<size_t>(oy) * dst_stride;
+    for (int ox = 0; ox < w; ++ox) {
+      const int c = 298 * (yv[ox] - 16) + 128;
+      const int d = uv[ox], e = vv[ox];
+      out[3 * ox + 0] = clamp_u8((c + 409 * e) >> 8);
+      out[3 * ox + 1] = clamp_u8((c - 100 * d - 208 * e) >> 8);
+      out[3 * ox + 2] = clamp_u8((c + 516 * d) >> 8);
+    }
+  }
+  return true;
+}
+
+}  // namespace mp_ingest
@@ -0,0 +1,34 @@
+// gstshared/mp_ingest.h
+// Pixel conversion kernels used by the runtime to build model input frames.
+// No MediaPipe or GStreamer dependencies.
+#ifndef MP_INGEST_H_
+#define MP_INGEST_H_
+
+#include <stdint.h>
+
+#include "mp_runtime.h"
+
+namespace mp_ingest {
+
+// Largest reduction supported by yuv420_to_rgb_area: scales below
+// 1 / kMaxBox are raised to it.
+constexpr int kMaxBox = 16;
+
+// Output size of n source samples at scale s (0 < s <= 1): rounded, at
+// least 1 and at most n.
+int scaled_size(int n, double s);
+
+// Converts an NV12 or I420 image to packed RGB888 (BT.601, limited range)
+// at out_w x out_h, in one pass over the source. Each output pixel averages
+// the luma of the source area it covers, so any ratio works (for scales in
+// (0.5, 1) an area is one or two pixels per axis) and no full-resolution RGB
+// image is built. Chroma is sampled at the area's centre. out_w and out_h
+// must not exceed the source size; dst must hold out_h rows of dst_stride
+// bytes with at least 3 * out_w bytes each. Returns false for unsupported
+// formats, missing planes or sizes.
+bool yuv420_to_rgb_area(const MpImage& img, int out_w, int out_h, uint8_t* dst,
+                        int dst_stride);
+
+}  // namespace mp_ingest
+
+#endif  // MP_INGEST_H_
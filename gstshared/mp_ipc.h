@@ -0,0 +1,127 @@
+// gstshared/mp_ipc.h
+// Wire protocol between libmp_runtime_ipc.so (the client shim loaded by the
+// plugins) and mp_runtime_daemon. Local only: AF_UNIX SOCK_SEQPACKET, one
+// fixed-size Request / Reply per message, same uid on both ends.
+//
+// Each client context owns a memfd segment it passes with OP_MAP
+// (SCM_RIGHTS). A context has one request in flight at a time, so the
+// segment is a single slot: one tightly packed frame followed by the result
+// area the daemon fills:
+//   int32 faces_count, int32 landmarks_count[max_faces],
+//   MpLandmark landmarks[max_faces][kMaxLandmarks]   (4-byte aligned)
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "mp_runtime.h"
+
+namespace mp_ipc {
+
+constexpr uint32_t kMagic = 0x3349504Du;  // "MPI3"
+constexpr int kMaxLandmarks = 478;
+constexpr const char* kDefaultSocket = "/tmp/mp_runtime.sock";
+
+enum Op : uint32_t {
+  OP_CREATE = 1,   // -> face_create; Reply.rc
+  OP_MAP    = 2,   // fd attached; map_size bytes
+  OP_DETECT = 3,   // frame in slot; Reply.rc, results in slot
+  OP_STATS  = 4,   // -> Reply.stats
+  OP_CLOSE  = 5,
+  OP_ALLOC  = 6,   // -> Reply.alloc (the daemon's CPU budget share)
+};
+
+struct Request {
+  uint32_t magic;
+  uint32_t op;
+  uint32_t seq;
+
+  // OP_CREATE
+  int32_t max_faces;
+  int32_t num_threads;
+  int32_t prewarm_frames;
+  int32_t prewarm_width;
+  int32_t prewarm_height;
+  float   detect_scale;
+  int32_t detect_max_side;
+  char    model_path[1024];
+
+  // OP_MAP
+  uint64_t map_size;
+
+  // OP_DETECT
+  int64_t  ts_us;
+  int32_t  width, height, format;
+  uint64_t plane_off[3];      // from the start of the segment
+  int32_t  strides[3];
+  uint64_t result_off;        // from the start of the segment
+};
+
+struct Reply {
+  uint32_t magic;
+  uint32_t seq;
+  int32_t  rc;
+  MpRuntimeStats stats;       // OP_STATS
+  MpCpuAllocation alloc;      // OP_ALLOC
+  char     error[256];        // when rc != 0
+};
+
+// Bytes needed after the frame for max_faces results.
+inline size_t result_bytes(int max_faces) {
+  return sizeof(int32_t) * (1 + max_faces) +
+         sizeof(MpLandmark) * kMaxLandmarks * static_cast<size_t>(max_faces);
+}
+
+// Sends one message, optionally passing fd; retries on EINTR.
+inline bool send_msg(int sock, const void* msg, size_t len, int fd = -1) {
+  iovec iov{const_cast<void*>(msg), len};
+  msghdr mh{};
+  mh.msg_iov = &iov;
+  mh.msg_iovlen = 1;
+  alignas(cmsghdr) char ctrl[CMSG_SPACE(sizeof(int))];
+  if (fd >= 0) {
+    std::memset(ctrl, 0, sizeof(ctrl));
+    mh.msg_control = ctrl;
+    mh.msg_controllen = sizeof(ctrl);
+    cmsghdr* c = CMSG_FIRSTHDR(&mh);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type = SCM_RIGHTS;
+    c->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(c), &fd, sizeof(int));
+  }
+  ssize_t n;
+  do { n = sendmsg(sock, &mh, MSG_NOSIGNAL); } while (n < 0 && errno == EINTR);
+  return n == static_cast<ssize_t>(len);
+}
+
+// Receives exactly one message of len bytes; *fd gets a passed descriptor
+// (or -1). False on EOF, error, timeout or a short/truncated message.
+inline bool recv_msg(int sock, void* msg, size_t len, int* fd = nullptr) {
+  iovec iov{msg, len};
+  msghdr mh{};
+  mh.msg_iov = &iov;
+  mh.msg_iovlen = 1;
+  alignas(cmsghdr) char ctrl[CMSG_SPACE(sizeof(int))];
+  mh.msg_control = ctrl;
+  mh.msg_controllen = sizeof(ctrl);
+  if (fd) *fd = -1;
+  ssize_t n;
+  do { n = recvmsg(sock, &mh, MSG_CMSG_CLOEXEC); } while (n < 0 && errno == EINTR);
+  for (cmsghdr* c = CMSG_FIRSTHDR(&mh); c; c = CMSG_NXTHDR(&mh, c)) {
+    if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS) {
+      int got;
+      std::memcpy(&got, CMSG_DATA(c), sizeof(int));
+      if (fd) *fd = got;
+      else close(got);
+    }
+  }
+  return n == static_cast<ssize_t>(len) && !(mh.msg_flags & (MSG_TRUNC | MSG_CTRUNC));
+}
+
+}  // namespace mp_ipc
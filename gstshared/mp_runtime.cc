@@ -1,21 +1,44 @@
 // gstshared/mp_runtime.cc
 #include "mp_runtime.h"
+#include "mp_cpu_budget.h"
+#include "mp_thread_policy.h"
+#include "mp_ingest.h"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cmath>
+#include <condition_variable>
 #include <cstdlib>
 #include <cstring>
 #include <cstdio>
+#include <deque>
+#include <iterator>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <set>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
 #include <GLES2/gl2.h>
 
 #include <gst/gst.h>
 
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
 // MediaPipe / Tasks
 #include "absl/status/statusor.h"
 #include "mediapipe/framework/formats/image.h"
@@ -27,6 +50,8 @@
 #include "mediapipe/tasks/cc/vision/core/running_mode.h"
 #include "mediapipe/tasks/cc/vision/face_landmarker/face_landmarker.h"
 #include "mediapipe/tasks/cc/vision/face_landmarker/face_landmarker_result.h"
+#include "tensorflow/lite/delegates/xnnpack/weight_cache.h"
+#include "tensorflow/lite/version.h"
 
 using mediapipe::Image;
 using mediapipe::ImageFormat;
@@ -53,14 +78,361 @@ static const char* rt_get_last_error() {
     return g_last_runtime_error.c_str();
 }
 
+// ---------- Model asset cache ----------
+// One open descriptor per model file, shared by every context in the process.
+// MediaPipe opens and maps /proc/self/fd/N itself, so the bundle's pages come
+// from the page cache like any other file mapping. Keyed by canonical path +
+// mtime + size so that a model replaced on disk gets a fresh entry while live
+// contexts keep the inode they started with.
+struct ModelAsset {
+  std::string key;
+  std::string path;        // canonical path of the .task bundle
+  int fd = -1;             // kept open: MediaPipe reads it via /proc/self/fd
+
+  ~ModelAsset() {
+    if (fd >= 0) close(fd);
+  }
+};
+
+static std::mutex g_model_mutex;
+static std::map<std::string, std::weak_ptr<ModelAsset>> g_model_cache;
+
+static std::shared_ptr<ModelAsset> acquire_model_asset(const char* path, bool* hit) {
+  *hit = false;
+  char* real = realpath(path, nullptr);
+  if (!real) {
+    set_last_error(std::string("model path not found: ") + path);
+    return nullptr;
+  }
+  std::string canon(real);
+  free(real);
+
+  struct stat st;
+  if (stat(canon.c_str(), &st) != 0 || st.st_size <= 0) {
+    set_last_error("cannot stat model: " + canon);
+    return nullptr;
+  }
+  char key[64];
+  std::snprintf(key, sizeof(key), "|%lld.%09ld|%lld", (long long)st.st_mtim.tv_sec,
+                (long)st.st_mtim.tv_nsec, (long long)st.st_size);
+  const std::string cache_key = canon + key;
+
+  std::lock_guard<std::mutex> lock(g_model_mutex);
+  auto it = g_model_cache.find(cache_key);
+  if (it != g_model_cache.end()) {
+    if (auto asset = it->second.lock()) {
+      *hit = true;
+      return asset;
+    }
+  }
+
+  auto asset = std::make_shared<ModelAsset>();
+  asset->key = cache_key;
+  asset->path = canon;
+  asset->fd = open(canon.c_str(), O_RDONLY | O_CLOEXEC);
+  if (asset->fd < 0) {
+    set_last_error("cannot open model: " + canon);
+    return nullptr;
+  }
+
+  // Drop entries whose last context is gone before inserting the new one.
+  for (auto e = g_model_cache.begin(); e != g_model_cache.end();) {
+    if (e->second.expired()) e = g_model_cache.erase(e);
+    else ++e;
+  }
+  g_model_cache[cache_key] = asset;
+  return asset;
+}
+
+// ---------- XNNPACK weight cache ----------
+// The inference calculator (patched in the Dockerfile) asks
+// mp_runtime_xnnpack_weight_cache() below where to keep XNNPACK's packed
+// weights, "<prefix>.<fnv64 of the .tflite>", and loads them on the next
+// create instead of repacking. Files that do not exist yet are built into
+// "<file>.tmp.<pid>"; the runtime renames them once Create returns, so
+// readers never see a partial cache. The prefix sits next to the model and
+// carries a hash of the CPU feature flags and of the TFLite / XNNPACK
+// cache format versions, so a cache from another machine type or XNNPACK
+// version is never loaded. Rebuilding the runtime keeps the key.
+static uint64_t fnv1a64(const void* data, size_t n, uint64_t h = 1469598103934665603ull) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < n; ++i) h = (h ^ p[i]) * 1099511628211ull;
+  return h;
+}
+
+static uint64_t cpu_build_key() {
+  static const uint64_t key = [] {
+    std::string flags;
+    if (FILE* f = std::fopen("/proc/cpuinfo", "r")) {
+      char line[4096];
+      while (std::fgets(line, sizeof(line), f)) {
+        if (std::strncmp(line, "flags", 5) == 0 || std::strncmp(line, "Features", 8) == 0) {
+          flags = line;
+          break;
+        }
+      }
+      std::fclose(f);
+    }
+    const std::string build = std::string(TFLITE_VERSION_STRING) + "/xnncache-v" +
+        std::to_string(static_cast<uint64_t>(tflite::xnnpack::XNNPackCacheHeader::kVersion));
+    return fnv1a64(build.data(), build.size(), fnv1a64(flags.data(), flags.size()));
+  }();
+  return key;
+}
+
+// XNNPACK settings of the CPU graph being created. Creates are serialized
+// by g_xnnpack_create_mutex, so while one runs the slot belongs to its
+// graph; the calculator reads it from the graph's threads under
+// g_xnnpack_slot_mutex (never the create lock, which Create holds).
+struct XnnpackCreate {
+  int threads = 0;
+  std::string prefix;                                 // "" = no weight cache
+  std::vector<std::pair<std::string, bool>> files;    // cache file, existed
+};
+static std::mutex g_xnnpack_create_mutex;
+static std::mutex g_xnnpack_slot_mutex;
+static XnnpackCreate* g_xnnpack_slot = nullptr;
+// Paths handed to XNNPACK, which keeps the pointer for the delegate's
+// lifetime; one entry per cache file, so the set stays small.
+static std::set<std::string> g_xnnpack_paths;
+
+// Looked up by the patched inference calculator (weak symbols there, so a
+// graph built without this runtime keeps its defaults).
+extern "C" int mp_runtime_xnnpack_threads(void) {
+  std::lock_guard<std::mutex> lock(g_xnnpack_slot_mutex);
+  return g_xnnpack_slot ? g_xnnpack_slot->threads : 0;
+}
+
+extern "C" const char* mp_runtime_xnnpack_weight_cache(const void* model, size_t bytes) {
+  std::lock_guard<std::mutex> lock(g_xnnpack_slot_mutex);
+  if (!g_xnnpack_slot || g_xnnpack_slot->prefix.empty() || !model || !bytes) return nullptr;
+  char key[24];
+  std::snprintf(key, sizeof(key), ".%016llx", (unsigned long long)fnv1a64(model, bytes));
+  const std::string file = g_xnnpack_slot->prefix + key;
+  const bool hit = access(file.c_str(), R_OK) == 0;
+  g_xnnpack_slot->files.emplace_back(file, hit);
+  const std::string path = hit ? file : file + ".tmp." + std::to_string(getpid());
+  return g_xnnpack_paths.insert(path).first->c_str();
+}
+
+// "<model dir>/<model name>.xnncache_<key>", or "" when disabled or the
+// model directory is not writable.
+static std::string weight_cache_prefix(const ModelAsset& model) {
+  const char* env = std::getenv("MP_RUNTIME_WEIGHT_CACHE");
+  if (env && std::strcmp(env, "0") == 0) return "";
+  const auto slash = model.path.rfind('/');
+  const std::string dir = model.path.substr(0, slash);
+  if (access(dir.c_str(), W_OK) != 0) {
+    GST_INFO("XNNPACK weight cache disabled: %s is not writable", dir.c_str());
+    return "";
+  }
+  char key[32];
+  std::snprintf(key, sizeof(key), ".xnncache_%016llx", (unsigned long long)cpu_build_key());
+  return model.path + key;
+}
+
+// Calls fn(name) for directory entries of prefix's directory whose name
+// starts with `stem` (the file name part of a prefix without its key).
+template <typename Fn>
+static void for_each_cache_file(const std::string& prefix, const std::string& stem, Fn fn) {
+  const auto slash = prefix.rfind('/');
+  const std::string dir = prefix.substr(0, slash);
+  DIR* d = opendir(dir.c_str());
+  if (!d) return;
+  while (dirent* e = readdir(d)) {
+    const std::string name = e->d_name;
+    if (name.compare(0, stem.size(), stem) == 0) fn(dir + "/" + name, name);
+  }
+  closedir(d);
+}
+
+// Removes only caches that are provably stale: those older than the model
+// file, and temporaries left behind by dead processes. Caches under another
+// key may belong to another installed runtime sharing the model directory,
+// so they are left alone.
+static void prune_weight_cache(const std::string& prefix) {
+  const std::string file = prefix.substr(prefix.rfind('/') + 1);
+  const std::string stem = file.substr(0, file.rfind(".xnncache_") + 10);
+  const std::string model = prefix.substr(0, prefix.rfind(".xnncache_"));
+  struct stat mst;
+  const bool have_model = stat(model.c_str(), &mst) == 0;
+  for_each_cache_file(prefix, stem, [&](const std::string& path, const std::string& name) {
+    const auto tmp = name.find(".tmp.");
+    if (tmp != std::string::npos) {
+      const long pid = std::strtol(name.c_str() + tmp + 5, nullptr, 10);
+      if (pid > 0 && kill(static_cast<pid_t>(pid), 0) != 0 && errno == ESRCH) unlink(path.c_str());
+      return;
+    }
+    struct stat cst;
+    if (have_model && stat(path.c_str(), &cst) == 0 && cst.st_mtime < mst.st_mtime) {
+      GST_INFO("XNNPACK weight cache: removing stale %s", path.c_str());
+      unlink(path.c_str());
+    }
+  });
+}
+
+// Atomically publishes the cache files a create built (those that did not
+// exist when the calculator asked for them).
+static void publish_weight_cache(const XnnpackCreate& c) {
+  const std::string suffix = ".tmp." + std::to_string(getpid());
+  for (const auto& f : c.files) {
+    if (f.second) continue;
+    const std::string tmp = f.first + suffix;
+    if (rename(tmp.c_str(), f.first.c_str()) == 0)
+      GST_INFO("XNNPACK weight cache written: %s", f.first.c_str());
+    else
+      unlink(tmp.c_str());
+  }
+}
+
+// Warm only if every model of the graph found its own cache file.
+static bool weight_cache_warm(const XnnpackCreate& c) {
+  if (c.files.empty()) return false;
+  for (const auto& f : c.files)
+    if (!f.second) return false;
+  return true;
+}
+
+// Resident set size of the process in KiB (0 if unavailable).
+static long read_rss_kib() {
+  FILE* f = std::fopen("/proc/self/status", "r");
+  if (!f) return 0;
+  char line[256];
+  long kib = 0;
+  while (std::fgets(line, sizeof(line), f)) {
+    if (std::strncmp(line, "VmRSS:", 6) == 0) {
+      kib = std::strtol(line + 6, nullptr, 10);
+      break;
+    }
+  }
+  std::fclose(f);
+  return kib;
+}
+
+// Landmarker built by the rebuild worker for a new inference thread count;
+// face_detect swaps it in once ready.
+struct LandmarkerRebuild {
+  std::atomic<bool> ready{false};
+  int threads = 0;
+  uint32_t generation = 0;                              // budget split it was built for
+  std::unique_ptr<mp_face::FaceLandmarker> landmarker;  // null if Create failed
+  // What to build; the job keeps the model alive on its own.
+  std::shared_ptr<ModelAsset> model;
+  int num_faces = 1;
+  bool with_blendshapes = false, with_geometry = false;
+  std::string cpu_set;
+  int rt_priority = 0;
+};
+
+static absl::StatusOr<std::unique_ptr<mp_face::FaceLandmarker>> create_landmarker(
+    const ModelAsset& model, int num_faces, bool blendshapes, bool geometry, bool gpu,
+    int threads);
+
+// Builds budget rebuilds one at a time on a single joinable thread, so a
+// split change costs one graph creation at a time however many contexts it
+// touches. A job whose context closed before its turn (the queue holds the
+// last reference) is skipped.
+class RebuildWorker {
+ public:
+  ~RebuildWorker() {
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+  }
+
+  void post(std::shared_ptr<LandmarkerRebuild> rb) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (stop_) return;
+    queue_.push_back(std::move(rb));
+    if (!thread_.joinable()) thread_ = std::thread([this] { run(); });
+    cv_.notify_one();
+  }
+
+ private:
+  void run() {
+    std::unique_lock<std::mutex> lock(mu_);
+    for (;;) {
+      cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+      if (stop_) return;
+      std::shared_ptr<LandmarkerRebuild> rb = std::move(queue_.front());
+      queue_.pop_front();
+      if (rb.use_count() == 1) continue;  // context gone
+      lock.unlock();
+      build(*rb);
+      lock.lock();
+    }
+  }
+
+  static void build(LandmarkerRebuild& rb) {
+    // Workers started by Create inherit the context's placement, as they
+    // did when the context was created (failures were reported then).
+    mp_thread_policy::Scope placement(rb.cpu_set.c_str(), rb.rt_priority);
+    auto lm = create_landmarker(*rb.model, rb.num_faces, rb.with_blendshapes, rb.with_geometry,
+                                /*gpu=*/false, rb.threads);
+    if (lm.ok()) {
+      rb.landmarker = std::move(lm.value());
+    } else {
+      GST_WARNING("FaceLandmarker rebuild for %d thread(s) failed: %s", rb.threads,
+                  lm.status().ToString().c_str());
+    }
+    rb.model.reset();
+    rb.ready.store(true, std::memory_order_release);
+  }
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::deque<std::shared_ptr<LandmarkerRebuild>> queue_;
+  bool stop_ = false;
+  std::thread thread_;
+};
+
+static RebuildWorker& rebuild_worker() {
+  static RebuildWorker worker;  // joined at exit
+  return worker;
+}
+
 // 1. The NEW, clean, lock-free Struct
 struct MpFaceCtx {
+  std::shared_ptr<ModelAsset> model;
   std::unique_ptr<mp_face::FaceLandmarker> landmarker;
   std::shared_ptr<mediapipe::GpuResources> gpu_resources;
   EGLDisplay egl_display = EGL_NO_DISPLAY;
   EGLContext egl_context = EGL_NO_CONTEXT;
   EGLSurface egl_surface = EGL_NO_SURFACE;
   int num_faces = 1;
+  bool with_blendshapes = false;
+  bool with_geometry = false;
+
+  // CPU budget (v7). threads is what the current graph was built with.
+  int budget_id = -1;
+  int requested_threads = 0;
+  int threads = 0;
+  uint32_t failed_generation = 0;   // rebuild for this split failed; don't retry
+  std::shared_ptr<LandmarkerRebuild> rebuild;
+
+  // Thread placement for graph rebuilds (v8, see mp_thread_policy.h).
+  std::string cpu_set;
+  int rt_priority = 0;
+
+  ~MpFaceCtx() { mp_cpu_budget::leave(budget_id); }
+
+  // Ingest downscale (see MpFaceLandmarkerOptions::detect_scale).
+  float detect_scale = 1.f;
+  int detect_max_side = 0;
+
+  MpRuntimeStats stats{};
+  int prev_faces = 0;
+
+  // Warm-pool bookkeeping. DetectForVideo needs strictly increasing
+  // timestamps, so a context handed to a new stream rebases the caller's
+  // clock onto the last timestamp it saw.
+  std::string pool_key;
+  int64_t last_ts_ms = -1;
+  int64_t ts_offset_ms = 0;
+  bool rebase_ts = false;
 };
 
 // ---------- Version / build ----------
@@ -121,6 +493,201 @@ static std::shared_ptr<ImageFrame> make_imageframe_from_mp(const MpImage *img) {
   return nullptr;
 }
 
+// Effective ingest scale for a WxH frame; 1 means copy as-is.
+static double ingest_scale(const MpFaceCtx *ctx, int W, int H) {
+  double s = (ctx->detect_scale > 0.f && ctx->detect_scale < 1.f) ? ctx->detect_scale : 1.0;
+  const int side = std::max(W, H);
+  if (ctx->detect_max_side > 0 && side * s > ctx->detect_max_side)
+    s = static_cast<double>(ctx->detect_max_side) / side;
+  return s;
+}
+
+// Downsample straight from the caller's strided buffer into the ImageFrame,
+// so the full-resolution frame is read once and never copied. Integer
+// ratios use INTER_AREA (box filter, OpenCV has SIMD paths for it), other
+// ratios bilinear. The aspect ratio is preserved up to rounding, so the
+// graph's normalized landmarks still map onto the original frame.
+static std::shared_ptr<ImageFrame> make_scaled_imageframe(const MpImage *img, double s) {
+  if (!img || !img->data || img->width <= 0 || img->height <= 0)
+    return nullptr;
+
+  const int W = img->width, H = img->height;
+  const int w = std::max(1, static_cast<int>(std::lround(W * s)));
+  const int h = std::max(1, static_cast<int>(std::lround(H * s)));
+  const double inv = 1.0 / s;
+  const int interp = (std::fabs(inv - std::round(inv)) < 1e-3) ? cv::INTER_AREA : cv::INTER_LINEAR;
+  void *src_data = const_cast<uint8_t *>(img->data);
+
+  switch (img->format) {
+    case MP_IMAGE_RGBA8888:
+    case MP_IMAGE_RGB888: {
+      const bool rgba = img->format == MP_IMAGE_RGBA8888;
+      auto frame = std::make_shared<ImageFrame>(rgba ? ImageFormat::SRGBA : ImageFormat::SRGB,
+                                                w, h, /*alignment*/ 1);
+      const int type = rgba ? CV_8UC4 : CV_8UC3;
+      cv::Mat src(H, W, type, src_data, img->stride);
+      cv::Mat dst(h, w, type, frame->MutablePixelData(), frame->WidthStep());
+      cv::resize(src, dst, dst.size(), 0, 0, interp);
+      return frame;
+    }
+    case MP_IMAGE_GRAY8: {
+      auto frame = std::make_shared<ImageFrame>(ImageFormat::SRGB, w, h, /*alignment*/ 1);
+      cv::Mat src(H, W, CV_8UC1, src_data, img->stride);
+      cv::Mat small;
+      cv::resize(src, small, cv::Size(w, h), 0, 0, interp);
+      cv::Mat dst(h, w, CV_8UC3, frame->MutablePixelData(), frame->WidthStep());
+      cv::cvtColor(small, dst, cv::COLOR_GRAY2RGB);
+      return frame;
+    }
+    default:
+      return nullptr;
+  }
+}
+
+// NV12/I420: the area reduction and colour conversion are one pass
+// (mp_ingest) at any ratio, so no full-resolution RGB frame is ever built.
+static std::shared_ptr<ImageFrame> make_imageframe_from_yuv(const MpImage *img, double s) {
+  if (!img || img->width <= 0 || img->height <= 0)
+    return nullptr;
+
+  s = std::max(s, 1.0 / mp_ingest::kMaxBox);
+  const int w = mp_ingest::scaled_size(img->width, s);
+  const int h = mp_ingest::scaled_size(img->height, s);
+  auto frame = std::make_shared<ImageFrame>(ImageFormat::SRGB, w, h, /*alignment*/ 1);
+  if (!mp_ingest::yuv420_to_rgb_area(*img, w, h, frame->MutablePixelData(), frame->WidthStep()))
+    return nullptr;
+  return frame;
+}
+
+static void destroy_ctx(MpFaceCtx *ctx) {
+  ctx->landmarker.reset();
+  ctx->gpu_resources.reset();
+  if (ctx->egl_display != EGL_NO_DISPLAY) {
+    eglMakeCurrent(ctx->egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (ctx->egl_surface != EGL_NO_SURFACE) {
+      eglDestroySurface(ctx->egl_display, ctx->egl_surface);
+    }
+    if (ctx->egl_context != EGL_NO_CONTEXT) {
+      eglDestroyContext(ctx->egl_display, ctx->egl_context);
+    }
+    eglTerminate(ctx->egl_display);
+  }
+  delete ctx;
+}
+
+// ---------- Warm context pool ----------
+// face_close parks CPU contexts here instead of tearing them down, and
+// face_create takes one back when (model, max_faces, threads, delegate)
+// match, so READY->PAUSED cycles skip FaceLandmarker::Create entirely.
+// Tunables (environment):
+//   MP_RUNTIME_POOL_SIZE     max idle contexts kept (default 4, 0 disables)
+//   MP_RUNTIME_POOL_IDLE_MS  idle contexts are destroyed after this (default 30000)
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct PooledCtx {
+  MpFaceCtx* ctx;
+  Clock::time_point parked;
+};
+
+class ContextPool {
+ public:
+  ContextPool() {
+    const char* sz = std::getenv("MP_RUNTIME_POOL_SIZE");
+    const char* idle = std::getenv("MP_RUNTIME_POOL_IDLE_MS");
+    max_idle_ = sz && *sz ? std::max(0, std::atoi(sz)) : 4;
+    idle_ms_ = idle && *idle ? std::max(0, std::atoi(idle)) : 30000;
+  }
+
+  ~ContextPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    if (reaper_.joinable()) reaper_.join();
+    // Parked contexts are intentionally leaked: the process is exiting and
+    // MediaPipe teardown during static destruction is not safe.
+  }
+
+  bool enabled() const { return max_idle_ > 0; }
+
+  MpFaceCtx* take(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = idle_.rbegin(); it != idle_.rend(); ++it) {
+      if (it->ctx->pool_key == key) {
+        MpFaceCtx* ctx = it->ctx;
+        idle_.erase(std::next(it).base());
+        return ctx;
+      }
+    }
+    return nullptr;
+  }
+
+  // Takes ownership of ctx. Returns contexts that must be destroyed by the
+  // caller (outside the pool lock) to honour the size bound.
+  std::vector<MpFaceCtx*> park(MpFaceCtx* ctx) {
+    std::vector<MpFaceCtx*> evicted;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      idle_.push_back({ctx, Clock::now()});
+      while ((int)idle_.size() > max_idle_) {
+        evicted.push_back(idle_.front().ctx);
+        idle_.erase(idle_.begin());
+      }
+      if (!reaper_.joinable()) reaper_ = std::thread([this] { reap_loop(); });
+    }
+    cv_.notify_all();
+    return evicted;
+  }
+
+  size_t idle_count() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return idle_.size();
+  }
+
+ private:
+  void reap_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_) {
+      if (idle_.empty()) {
+        cv_.wait(lock);
+        continue;
+      }
+      const auto deadline = idle_.front().parked + std::chrono::milliseconds(idle_ms_);
+      if (Clock::now() < deadline) {
+        cv_.wait_until(lock, deadline);
+        continue;
+      }
+      std::vector<MpFaceCtx*> expired;
+      while (!idle_.empty() && idle_.front().parked + std::chrono::milliseconds(idle_ms_) <= Clock::now()) {
+        expired.push_back(idle_.front().ctx);
+        idle_.erase(idle_.begin());
+      }
+      lock.unlock();
+      for (MpFaceCtx* ctx : expired) destroy_ctx(ctx);
+      GST_DEBUG("context pool: destroyed %zu idle context(s)", expired.size());
+      lock.lock();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<PooledCtx> idle_;   // oldest first
+  std::thread reaper_;
+  int max_idle_ = 4;
+  int idle_ms_ = 30000;
+  bool stop_ = false;
+};
+
+ContextPool& context_pool() {
+  static ContextPool pool;
+  return pool;
+}
+
+}  // namespace
+
 static void free_result_owned(MpFaceResult *out) {
   if (!out || !out->faces || out->faces_count <= 0)
     return;
@@ -136,6 +703,158 @@ static void free_result_owned(MpFaceResult *out) {
 }
 
 // ---------- API impl ----------
+static int rt_face_detect(MpFaceCtx *ctx, const MpImage *img, int64_t ts_us,
+                          MpFaceResult *out);
+static void rt_face_free_result(MpFaceResult *out);
+
+// Sample face the prewarm frames are made of: MP_RUNTIME_PREWARM_FACE, or
+// the one the Dockerfile installs. RGB; empty when neither can be read.
+static const cv::Mat& prewarm_face() {
+  static const cv::Mat face = [] {
+    const char* env = std::getenv("MP_RUNTIME_PREWARM_FACE");
+    const std::string path =
+        env && *env ? env : "/usr/local/share/mozza/prewarm_face.jpg";
+    cv::Mat bgr = cv::imread(path, cv::IMREAD_COLOR), rgb;
+    if (bgr.empty()) {
+      GST_WARNING("prewarm: no sample face at %s, prewarming on a blank frame", path.c_str());
+      return rgb;
+    }
+    cv::cvtColor(bgr, rgb, cv::COLOR_BGR2RGB);
+    return rgb;
+  }();
+  return face;
+}
+
+// Push a few frames through a fresh context so lazy tensor allocation,
+// XNNPACK weight packing and graph warm-up happen here rather than on the
+// first live frame. The frames show the sample face, fitted into a mid-grey
+// w x h frame, so the detector finds it and the landmark subgraph runs (and
+// then tracks it) too. *faces_seen tells whether it did: without the sample
+// only the detector path is warm.
+static double prewarm_ctx(MpFaceCtx *ctx, int frames, int w, int h, bool *faces_seen) {
+  if (w <= 0 || h <= 0) { w = 640; h = 480; }
+  std::vector<uint8_t> rgb(static_cast<size_t>(w) * h * 3, 128);
+  const cv::Mat& face = prewarm_face();
+  if (!face.empty()) {
+    const double fit = std::min(double(w) / face.cols, double(h) / face.rows);
+    const int fw = std::max(1, int(face.cols * fit)), fh = std::max(1, int(face.rows * fit));
+    cv::Mat canvas(h, w, CV_8UC3, rgb.data());
+    cv::resize(face, canvas(cv::Rect((w - fw) / 2, (h - fh) / 2, fw, fh)), cv::Size(fw, fh),
+               0, 0, cv::INTER_AREA);
+  }
+  MpImage img{rgb.data(), w, h, w * 3, MP_IMAGE_RGB888};
+
+  *faces_seen = false;
+  const auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < frames; ++i) {
+    MpFaceResult res{};
+    rt_face_detect(ctx, &img, static_cast<int64_t>(i) * 33000, &res);
+    if (res.faces_count > 0) *faces_seen = true;
+    rt_face_free_result(&res);
+  }
+  // Live timestamps usually restart at 0; rebase them past the synthetic ones.
+  ctx->rebase_ts = true;
+  ctx->stats = MpRuntimeStats{};
+  ctx->prev_faces = 0;
+  return std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - t0).count();
+}
+
+// Hand MediaPipe the cached descriptor rather than the bytes: it maps
+// path-based assets itself, so every context reads the same page-cache
+// pages. model_asset_buffer would force a private heap copy per context.
+static std::unique_ptr<mp_face::FaceLandmarkerOptions> landmarker_options(
+    const ModelAsset& model, int num_faces, bool blendshapes, bool geometry, bool gpu) {
+  auto options = std::make_unique<mp_face::FaceLandmarkerOptions>();
+  options->base_options = mp_core::BaseOptions();
+  options->base_options.model_asset_path = "/proc/self/fd/" + std::to_string(model.fd);
+  using MpDelegate = mp_core::BaseOptions::Delegate;
+  options->base_options.delegate = gpu ? MpDelegate::GPU : MpDelegate::CPU;
+
+  // 2. Use synchronous VIDEO mode. No background threads, no callbacks!
+  options->running_mode = mp_vision::core::RunningMode::VIDEO;
+  options->num_faces = num_faces;
+  options->output_face_blendshapes = blendshapes;
+  options->output_facial_transformation_matrixes = geometry;
+  return options;
+}
+
+// FaceLandmarker::Create with the XNNPACK settings of the patched CPU
+// inference calculator (see the Dockerfile) applied: the thread count and
+// the weight cache. The calculator reads them from g_xnnpack_slot while the
+// graph starts, so CPU creates are serialized.
+static absl::StatusOr<std::unique_ptr<mp_face::FaceLandmarker>> create_landmarker(
+    const ModelAsset& model, int num_faces, bool blendshapes, bool geometry, bool gpu,
+    int threads) {
+  auto make = [&] {
+    return mp_face::FaceLandmarker::Create(
+        landmarker_options(model, num_faces, blendshapes, geometry, gpu));
+  };
+  if (gpu) return make();
+
+  std::lock_guard<std::mutex> lock(g_xnnpack_create_mutex);
+  XnnpackCreate c;
+  c.threads = threads > 0 ? threads : 0;
+  c.prefix = weight_cache_prefix(model);
+  if (!c.prefix.empty()) prune_weight_cache(c.prefix);
+  auto run = [&] {
+    {
+      std::lock_guard<std::mutex> slot(g_xnnpack_slot_mutex);
+      c.files.clear();
+      g_xnnpack_slot = &c;
+    }
+    auto lm = make();
+    std::lock_guard<std::mutex> slot(g_xnnpack_slot_mutex);
+    g_xnnpack_slot = nullptr;
+    return lm;
+  };
+
+  absl::StatusOr<std::unique_ptr<mp_face::FaceLandmarker>> lm = run();
+  if (c.prefix.empty()) return lm;
+  const bool any_hit = std::any_of(c.files.begin(), c.files.end(),
+                                   [](const std::pair<std::string, bool>& f) { return f.second; });
+  if (!lm.ok() && any_hit) {
+    GST_WARNING("FaceLandmarker::Create failed with the XNNPACK weight cache (%s); "
+                "discarding the cache and retrying",
+                lm.status().ToString().c_str());
+    for (const auto& f : c.files) unlink(f.first.c_str());
+    c.prefix.clear();
+    return run();
+  }
+  if (!lm.ok()) {
+    const std::string suffix = ".tmp." + std::to_string(getpid());
+    for (const auto& f : c.files)
+      if (!f.second) unlink((f.first + suffix).c_str());
+  } else {
+    // XNNPACK finalizes the cache while the delegate is applied, i.e.
+    // inside Create; publishing under the lock keeps a second create from
+    // rebuilding into the same temporary.
+    publish_weight_cache(c);
+    if (c.files.empty())
+      GST_WARNING("XNNPACK weight cache not used: the inference calculator did not ask for "
+                  "it (runtime built without the Dockerfile patch?)");
+    else
+      GST_INFO("XNNPACK weight cache %s: %s* (%zu models)",
+               weight_cache_warm(c) ? "hit" : "cold", c.prefix.c_str(), c.files.size());
+  }
+  return lm;
+}
+
+// lock_memory: locks the whole process once a context is ready, so the
+// packed weights and graph buffers built by Create are covered, not only the
+// .task mapping (which inference never reads). MCL_FUTURE keeps later
+// contexts resident too, so one successful lock is enough.
+static void lock_process_memory() {
+  static std::mutex m;
+  static bool locked = false;
+  std::lock_guard<std::mutex> lock(m);
+  if (locked) return;
+  const std::string err = mp_thread_policy::lock_all_memory();
+  if (!err.empty()) GST_WARNING("lock_memory ignored: %s", err.c_str());
+  else GST_INFO("process memory locked");
+  locked = err.empty();
+}
+
 static int rt_face_create(const MpFaceLandmarkerOptions *opts,
                           MpFaceCtx **out) {
   ensure_gst_debug();
@@ -144,15 +863,41 @@ static int rt_face_create(const MpFaceLandmarkerOptions *opts,
 
   auto ctx = std::make_unique<MpFaceCtx>();
 
-  auto options = std::make_unique<mp_face::FaceLandmarkerOptions>();
-  options->base_options = mp_core::BaseOptions();
-  options->base_options.model_asset_path = std::string(opts->model_path);
-  using MpDelegate = mp_core::BaseOptions::Delegate;
-  options->base_options.delegate = MpDelegate::CPU;
+  const auto t_start = std::chrono::steady_clock::now();
+  const long rss_before = read_rss_kib();
 
-  if (opts->delegate && std::strcmp(opts->delegate, "gpu") == 0) {
+  bool cache_hit = false;
+  ctx->model = acquire_model_asset(opts->model_path, &cache_hit);
+  if (!ctx->model) return -1;
+
+  const bool gpu = opts->delegate && std::strcmp(opts->delegate, "gpu") == 0;
+  // GPU contexts own an EGL context bound to the creating thread; only CPU
+  // contexts are pooled.
+  if (!gpu && context_pool().enabled()) {
+    char params[112];
+    std::snprintf(params, sizeof(params), "|faces=%d|threads=%d|bs=%d|geo=%d|rt=%d|cpu=",
+                  std::max(1, opts->max_faces), opts->num_threads,
+                  opts->with_blendshapes != 0, opts->with_geometry != 0, opts->rt_priority);
+    ctx->pool_key = ctx->model->key + params + (opts->cpu_set ? opts->cpu_set : "");
+    if (MpFaceCtx* warm = context_pool().take(ctx->pool_key)) {
+      warm->rebase_ts = true;
+      warm->detect_scale = opts->detect_scale;
+      warm->detect_max_side = opts->detect_max_side;
+      warm->stats = MpRuntimeStats{};
+      warm->prev_faces = 0;
+      warm->budget_id = mp_cpu_budget::join(warm->requested_threads);
+      GST_INFO("FaceLandmarker warm context reused in %.3f ms (%zu idle left)",
+               std::chrono::duration<double, std::milli>(
+                   std::chrono::steady_clock::now() - t_start).count(),
+               context_pool().idle_count());
+      if (opts->lock_memory) lock_process_memory();
+      *out = warm;
+      return 0;
+    }
+  }
+
+  if (gpu) {
     GST_INFO("GPU delegate requested, initializing EGL...");
-    options->base_options.delegate = MpDelegate::GPU;
 
     PFNEGLQUERYDEVICESEXTPROC eglQueryDevicesEXT = (PFNEGLQUERYDEVICESEXTPROC)eglGetProcAddress("eglQueryDevicesEXT");
     PFNEGLGETPLATFORMDISPLAYEXTPROC eglGetPlatformDisplayEXT = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
@@ -212,61 +957,175 @@ static int rt_face_create(const MpFaceLandmarkerOptions *opts,
     ctx->gpu_resources = gpu_res_status.value();
   }
 
-  // 2. Use synchronous VIDEO mode. No background threads, no callbacks!
-  options->running_mode = mp_vision::core::RunningMode::VIDEO;
-  
-  options->num_faces = std::max(1, opts->max_faces);
-  options->output_face_blendshapes = (opts->with_blendshapes != 0);
-  options->output_facial_transformation_matrixes = (opts->with_geometry != 0);
+  ctx->num_faces = std::max(1, opts->max_faces);
+  ctx->with_blendshapes = opts->with_blendshapes != 0;
+  ctx->with_geometry = opts->with_geometry != 0;
+  ctx->requested_threads = opts->num_threads;
+  ctx->threads = opts->num_threads;
+  if (!gpu) {
+    ctx->budget_id = mp_cpu_budget::join(opts->num_threads);
+    MpCpuAllocation alloc{};
+    mp_cpu_budget::get(ctx->budget_id, opts->num_threads, &alloc);
+    ctx->threads = alloc.inference_threads;
+    if (ctx->budget_id >= 0)
+      GST_INFO("CPU budget: %d cores over %d context(s), %d inference thread(s) (requested %d)",
+               alloc.budget, alloc.contexts, ctx->threads, opts->num_threads);
+  }
 
-  absl::StatusOr<std::unique_ptr<mp_face::FaceLandmarker>> lm =
-      mp_face::FaceLandmarker::Create(std::move(options));
+  // The graph executor and XNNPACK workers are started inside Create and
+  // inherit this thread's affinity and policy; the caller gets its own back
+  // when create() returns.
+  ctx->cpu_set = opts->cpu_set ? opts->cpu_set : "";
+  ctx->rt_priority = std::max(0, opts->rt_priority);
+  mp_thread_policy::Scope placement(ctx->cpu_set.c_str(), ctx->rt_priority);
+  if (!placement.error().empty())
+    GST_WARNING("thread policy partly ignored: %s", placement.error().c_str());
 
+  absl::StatusOr<std::unique_ptr<mp_face::FaceLandmarker>> lm =
+      create_landmarker(*ctx->model, ctx->num_faces, ctx->with_blendshapes,
+                        ctx->with_geometry, gpu, ctx->threads);
   if (!lm.ok()) {
     std::string err = lm.status().ToString();
     set_last_error("FaceLandmarker::Create failed: " + err);
     GST_FIXME("FaceLandmarker::Create failed: %s", err.c_str());
     return -2;
   }
-
   ctx->landmarker = std::move(lm.value());
-  ctx->num_faces = std::max(1, opts->max_faces);
+  ctx->detect_scale = opts->detect_scale;
+  ctx->detect_max_side = opts->detect_max_side;
+
+  const double create_ms = std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - t_start).count();
+  GST_INFO("FaceLandmarker context created in %.1f ms (model %s, %s, %ld contexts, rss +%ld KiB)",
+           create_ms, ctx->model->path.c_str(), cache_hit ? "cache hit" : "opened",
+           ctx->model.use_count(), read_rss_kib() - rss_before);
+
+  if (opts->prewarm_frames > 0) {
+    bool faces_seen = false;
+    const double warm_ms = prewarm_ctx(ctx.get(), opts->prewarm_frames,
+                                       opts->prewarm_width, opts->prewarm_height, &faces_seen);
+    GST_INFO("FaceLandmarker prewarm: %d frame(s) at %dx%d in %.1f ms (%s)",
+             opts->prewarm_frames,
+             opts->prewarm_width > 0 ? opts->prewarm_width : 640,
+             opts->prewarm_height > 0 ? opts->prewarm_height : 480, warm_ms,
+             faces_seen ? "detector + landmarks" : "detector only");
+  }
+  if (opts->lock_memory) lock_process_memory();
 
   *out = ctx.release();
-  GST_INFO("FaceLandmarker context created successfully");
   return 0;
 }
 
+// Follows the CPU budget: once a new split has settled and this context's
+// share differs from the thread count its graph was built with, a
+// replacement is queued on the rebuild worker and swapped in between frames.
+// Contexts whose share did not change are left alone.
+// Tracking restarts on the new graph, like after a detector miss.
+static void follow_cpu_budget(MpFaceCtx *ctx) {
+  if (ctx->rebuild) {
+    if (!ctx->rebuild->ready.load(std::memory_order_acquire)) return;
+    std::shared_ptr<LandmarkerRebuild> rb = std::move(ctx->rebuild);
+    if (rb->landmarker) {
+      GST_INFO("FaceLandmarker rebuilt for the CPU budget: %d -> %d inference thread(s)",
+               ctx->threads, rb->threads);
+      ctx->landmarker = std::move(rb->landmarker);
+      ctx->threads = rb->threads;
+      ctx->prev_faces = 0;
+    } else {
+      ctx->failed_generation = rb->generation;
+    }
+    return;
+  }
+  MpCpuAllocation alloc{};
+  mp_cpu_budget::get(ctx->budget_id, ctx->requested_threads, &alloc);
+  if (alloc.inference_threads == ctx->threads || alloc.generation == ctx->failed_generation ||
+      !mp_cpu_budget::settled())
+    return;
+
+  auto rb = std::make_shared<LandmarkerRebuild>();
+  rb->threads = alloc.inference_threads;
+  rb->generation = alloc.generation;
+  rb->model = ctx->model;
+  rb->num_faces = ctx->num_faces;
+  rb->with_blendshapes = ctx->with_blendshapes;
+  rb->with_geometry = ctx->with_geometry;
+  rb->cpu_set = ctx->cpu_set;
+  rb->rt_priority = ctx->rt_priority;
+  ctx->rebuild = rb;
+  rebuild_worker().post(std::move(rb));
+}
+
 // 3. The NEW Synchronous rt_face_detect
 static int rt_face_detect(MpFaceCtx *ctx, const MpImage *img, int64_t ts_us,
                           MpFaceResult *out) {
   ensure_gst_debug();
   if (!ctx || !ctx->landmarker || !out)
     return -1;
+  if (ctx->budget_id >= 0) follow_cpu_budget(ctx);
 
   out->faces = nullptr;
   out->faces_count = 0;
   out->timestamp_us = (ts_us < 0) ? 0 : ts_us;
 
-  std::shared_ptr<ImageFrame> frame_ptr = make_imageframe_from_mp(img);
+  using Clock = std::chrono::steady_clock;
+  auto us_since = [](Clock::time_point t) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - t).count();
+  };
+  MpRuntimeStats &st = ctx->stats;
+  const auto t_ingest = Clock::now();
+
+  const double scale = img ? ingest_scale(ctx, img->width, img->height) : 1.0;
+  std::shared_ptr<ImageFrame> frame_ptr;
+  if (img && (img->format == MP_IMAGE_NV12 || img->format == MP_IMAGE_I420))
+    frame_ptr = make_imageframe_from_yuv(img, scale);
+  else if (scale < 0.999)
+    frame_ptr = make_scaled_imageframe(img, scale);
+  else
+    frame_ptr = make_imageframe_from_mp(img);
   if (!frame_ptr) return -3;
+  st.allocations += 1;
+  st.allocated_bytes += static_cast<uint64_t>(frame_ptr->PixelDataSize());
+  st.ingest_us_last = us_since(t_ingest);
+  st.ingest_us_total += st.ingest_us_last;
+  st.frames += 1;
 
   mediapipe::Image mp_image(frame_ptr);
-  const int64_t ts_ms = (ts_us <= 0) ? 0 : (ts_us / 1000);
+  int64_t ts_ms = (ts_us <= 0) ? 0 : (ts_us / 1000);
+  if (ctx->rebase_ts) {
+    ctx->ts_offset_ms = std::max<int64_t>(0, ctx->last_ts_ms + 1 - ts_ms);
+    ctx->rebase_ts = false;
+  }
+  ts_ms += ctx->ts_offset_ms;
+  if (ts_ms <= ctx->last_ts_ms) ts_ms = ctx->last_ts_ms + 1;
+  ctx->last_ts_ms = ts_ms;
 
   // Synchronous processing! Fast and lock-free.
+  const auto t_graph = Clock::now();
   auto res_or = ctx->landmarker->DetectForVideo(mp_image, ts_ms);
+  st.graph_us_last = us_since(t_graph);
+  st.graph_us_total += st.graph_us_last;
+  if (ctx->prev_faces < ctx->num_faces) st.detector_runs += 1;
+  if (ctx->prev_faces > 0) st.tracker_runs += 1;
 
   if (!res_or.ok()) {
     GST_ERROR("FaceLandmarker DetectForVideo error: %s", res_or.status().ToString().c_str());
+    ctx->prev_faces = 0;
+    st.marshal_us_last = 0;
     out->faces = nullptr;
     out->faces_count = 0;
     out->timestamp_us = ts_us;
     return 0;
   }
 
+  const auto t_marshal = Clock::now();
   const mp_face::FaceLandmarkerResult &res = res_or.value();
   const int F = static_cast<int>(res.face_landmarks.size());
+  ctx->prev_faces = F;
+  if (F > 0) {
+    st.frames_with_face += 1;
+    st.allocations += 1;
+    st.allocated_bytes += sizeof(MpFace) * F;
+  }
   MpFace *faces = nullptr;
   if (F > 0) {
     faces = static_cast<MpFace *>(malloc(sizeof(MpFace) * F));
@@ -297,7 +1156,13 @@ static int rt_face_detect(MpFaceCtx *ctx, const MpImage *img, int64_t ts_us,
     }
     faces[fi].landmarks = pts;
     faces[fi].landmarks_count = N;
+    if (N > 0) {
+      st.allocations += 1;
+      st.allocated_bytes += sizeof(MpLandmark) * N;
+    }
   }
+  st.marshal_us_last = us_since(t_marshal);
+  st.marshal_us_total += st.marshal_us_last;
 
   out->faces = faces;
   out->faces_count = F;
@@ -307,27 +1172,52 @@ static int rt_face_detect(MpFaceCtx *ctx, const MpImage *img, int64_t ts_us,
 
 static void rt_face_free_result(MpFaceResult *out) { free_result_owned(out); }
 
+static int rt_face_get_stats(MpFaceCtx *ctx, MpRuntimeStats *out) {
+  if (!ctx || !out) return -1;
+  *out = ctx->stats;
+  return 0;
+}
+
+// The Tasks graph runs at batch size 1, so a batch is just the per-context
+// calls back to back on the caller's thread. Only the flat export offers
+// it; the API table leaves face_detect_batch NULL so mp_batcher does not
+// serialize streams that would otherwise detect on their own threads.
+static int rt_face_detect_batch(MpFaceCtx *const *ctxs, const MpImage *imgs,
+                                const int64_t *ts_us, int32_t n,
+                                MpFaceResult *outs, int32_t *rcs) {
+  if (!ctxs || !imgs || !ts_us || !outs || n < 0) return -1;
+  int rc = 0;
+  for (int32_t i = 0; i < n; ++i) {
+    const int r = rt_face_detect(ctxs[i], &imgs[i], ts_us[i], &outs[i]);
+    if (rcs) rcs[i] = r;
+    if (r != 0 && rc == 0) rc = r;
+  }
+  return rc;
+}
+
 // 4. RESTORED rt_face_close
 static void rt_face_close(MpFaceCtx **pctx) {
   if (pctx && *pctx) {
     auto ctx = *pctx;
-    ctx->landmarker.reset();
-    ctx->gpu_resources.reset();
-    if (ctx->egl_display != EGL_NO_DISPLAY) {
-      eglMakeCurrent(ctx->egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
-      if (ctx->egl_surface != EGL_NO_SURFACE) {
-        eglDestroySurface(ctx->egl_display, ctx->egl_surface);
-      }
-      if (ctx->egl_context != EGL_NO_CONTEXT) {
-        eglDestroyContext(ctx->egl_display, ctx->egl_context);
-      }
-      eglTerminate(ctx->egl_display);
-    }
-    delete ctx;
     *pctx = nullptr;
+    if (!ctx->pool_key.empty() && ctx->landmarker && context_pool().enabled()) {
+      mp_cpu_budget::leave(ctx->budget_id);  // idle contexts use no CPU
+      ctx->budget_id = -1;
+      for (MpFaceCtx* evicted : context_pool().park(ctx)) destroy_ctx(evicted);
+      GST_INFO("FaceLandmarker context parked in warm pool");
+      return;
+    }
+    destroy_ctx(ctx);
   }
 }
 
+static int rt_face_get_allocation(MpFaceCtx *ctx, MpCpuAllocation *out) {
+  if (!ctx || !out) return -1;
+  mp_cpu_budget::get(ctx->budget_id, ctx->requested_threads, out);
+  out->inference_threads = ctx->threads;  // the running graph's, until a rebuild lands
+  return 0;
+}
+
 // ---------- API table ----------
 static const MpRuntimeApi g_api = {
     /*api_version=*/MP_RUNTIME_API_VERSION,
@@ -338,6 +1228,9 @@ static const MpRuntimeApi g_api = {
     /*face_free_result=*/rt_face_free_result,
     /*face_close=*/rt_face_close,
     /*get_last_error=*/rt_get_last_error,
+    /*face_get_stats=*/rt_face_get_stats,
+    /*face_detect_batch=*/nullptr,  // see rt_face_detect_batch
+    /*face_get_allocation=*/rt_face_get_allocation,
 };
 
 extern "C" const MpRuntimeApi *mp_runtime_get_api(void) { return &g_api; }
@@ -357,6 +1250,18 @@ extern "C" void mp_face_landmarker_free_result(MpFaceResult *r) {
   rt_face_free_result(r);
 }
 extern "C" void mp_face_landmarker_close(MpFaceCtx **c) { rt_face_close(c); }
+extern "C" int mp_face_landmarker_get_stats(MpFaceCtx *c, MpRuntimeStats *s) {
+  return rt_face_get_stats(c, s);
+}
+extern "C" int mp_face_landmarker_detect_batch(MpFaceCtx *const *c,
+                                               const MpImage *i,
+                                               const int64_t *t, int32_t n,
+                                               MpFaceResult *r, int32_t *rcs) {
+  return rt_face_detect_batch(c, i, t, n, r, rcs);
+}
+extern "C" int mp_face_landmarker_get_allocation(MpFaceCtx *c, MpCpuAllocation *a) {
+  return rt_face_get_allocation(c, a);
+}
 extern "C" int face_create(const MpFaceLandmarkerOptions *o, MpFaceCtx **c) {
   return rt_face_create(o, c);
 }
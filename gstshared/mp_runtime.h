@@ -9,9 +9,16 @@ extern "C" {
 #endif
 
 // ---------- Version ----------
-#define MP_RUNTIME_API_VERSION     1
+// 2: MpFaceLandmarkerOptions gained prewarm_* (appended).
+// 3: MpFaceLandmarkerOptions gained detect_scale / detect_max_side (appended).
+// 4: MP_IMAGE_NV12 / MP_IMAGE_I420 and per-plane pointers in MpImage (appended).
+// 5: MpRuntimeApi::face_get_stats.
+// 6: MpRuntimeApi::face_detect_batch.
+// 7: MpRuntimeApi::face_get_allocation (process-wide CPU budget).
+// 8: MpFaceLandmarkerOptions gained cpu_set / rt_priority / lock_memory (appended).
+#define MP_RUNTIME_API_VERSION     8
 #define MP_RUNTIME_API_MIN_VERSION 1
-#define MP_RUNTIME_API_MAX_VERSION 1
+#define MP_RUNTIME_API_MAX_VERSION 8
 
 // ---------- Image ----------
 typedef enum MpImageFormat {
@@ -19,6 +26,8 @@ typedef enum MpImageFormat {
   MP_IMAGE_RGBA8888 = 1,
   MP_IMAGE_RGB888   = 2,
   MP_IMAGE_GRAY8    = 3,
+  MP_IMAGE_NV12     = 4,   // v4: Y plane + interleaved UV, 4:2:0
+  MP_IMAGE_I420     = 5,   // v4: Y, U, V planes, 4:2:0
 } MpImageFormat;
 
 typedef struct MpImage {
@@ -27,6 +36,12 @@ typedef struct MpImage {
   int32_t height;
   int32_t stride;      // bytes per row in 'data'
   MpImageFormat format;
+
+  // v4: multi-plane formats. planes[0]/strides[0] are the Y plane (data and
+  // stride are used when they are unset); NV12 uses planes[1] for UV,
+  // I420 uses planes[1] = U and planes[2] = V. Ignored for packed formats.
+  const uint8_t* planes[3];
+  int32_t        strides[3];
 } MpImage;
 
 // ---------- Face outputs ----------
@@ -56,6 +71,48 @@ typedef struct MpFaceResult {
   int64_t       timestamp_us; // echoed timestamp in microseconds
 } MpFaceResult;
 
+// ---------- Telemetry (v5) ----------
+// Per-context counters since face_create (or since the context was taken
+// from the warm pool). Times are microseconds. Stages:
+//   ingest  : MpImage -> model input frame (copy / downscale / YUV convert)
+//   graph   : FaceLandmarker DetectForVideo (detector + landmark regression)
+//   marshal : MediaPipe result -> MpFaceResult
+typedef struct MpRuntimeStats {
+  uint64_t frames;            // face_detect calls
+  uint64_t frames_with_face;
+
+  double ingest_us_total;
+  double graph_us_total;
+  double marshal_us_total;
+  double ingest_us_last;
+  double graph_us_last;
+  double marshal_us_last;
+
+  // Face detector vs. landmark tracker invocations. The VIDEO graph only
+  // runs the detector while fewer than max_faces faces are tracked, so these
+  // are derived from the previous frame's face count; -1 if unknown.
+  int64_t detector_runs;
+  int64_t tracker_runs;
+
+  uint64_t allocations;       // heap blocks allocated by ingest + marshal
+  uint64_t allocated_bytes;
+} MpRuntimeStats;
+
+// ---------- CPU budget (v7) ----------
+// The runtime divides one CPU budget between all live contexts of the
+// process (see mp_cpu_budget.h) and rebalances as contexts come and go.
+typedef struct MpCpuAllocation {
+  int32_t  budget;             // cores divided between contexts (0: not coordinated)
+  int32_t  contexts;           // live contexts sharing the budget
+  int32_t  inference_threads;  // this context's inference threads
+  int32_t  warp_threads;       // threads left for the caller's own per-frame work
+  int32_t  warp_pool;          // size for a process-wide pool running that work
+                               // (e.g. OpenCV's), summed over all contexts
+  uint32_t generation;         // changes whenever the split is recomputed
+  int32_t  overcommit;         // threads handed out beyond the budget: with more
+                               // contexts than cores, each still gets one
+} MpCpuAllocation;
+
 // ---------- Options / ctx ----------
 typedef struct MpFaceCtx MpFaceCtx;
 
@@ -64,8 +121,28 @@ typedef struct MpFaceLandmarkerOptions {
   int32_t     max_faces;       // >=1
   int32_t     with_blendshapes;
   int32_t     with_geometry;   // pose matrices, etc.
-  int32_t     num_threads;     // hint; may be ignored by backend
+  int32_t     num_threads;     // hint; capped by the CPU budget (v7)
   const char* delegate;        // e.g. "gpu", "cpu" (informational)
+
+  // v2: run N synthetic inferences inside create() so the first real frame
+  // runs at steady-state latency. 0 disables. Size <= 0 falls back to 640x480.
+  int32_t     prewarm_frames;
+  int32_t     prewarm_width;
+  int32_t     prewarm_height;
+
+  // v3: downscale frames on ingest before they reach the graph. The result
+  // is min(detect_scale, detect_max_side / max(w, h)); values <= 0 (or a
+  // scale >= 1) mean "no limit". Landmarks stay normalized to the input frame.
+  float       detect_scale;
+  int32_t     detect_max_side;
+
+  // v8: placement of the worker threads the runtime starts for this context
+  // (they inherit it from the thread that builds the graph), and whether the
+  // model stays resident. Settings that cannot be applied (e.g. without
+  // CAP_SYS_NICE) are logged and ignored; create() still succeeds.
+  const char* cpu_set;         // CPU list, e.g. "2-5,8"; NULL/"" = inherit
+  int32_t     rt_priority;     // 1..99: SCHED_FIFO at this priority; 0 = inherit
+  int32_t     lock_memory;     // 1: mlock the model pages
 } MpFaceLandmarkerOptions;
 
 // ---------- Flat C API ----------
@@ -77,6 +154,11 @@ int   mp_face_landmarker_create(const MpFaceLandmarkerOptions*, MpFaceCtx**);
 int   mp_face_landmarker_detect(MpFaceCtx*, const MpImage*, int64_t timestamp_us, MpFaceResult*);
 void  mp_face_landmarker_free_result(MpFaceResult*);
 void  mp_face_landmarker_close(MpFaceCtx**);
+int   mp_face_landmarker_get_stats(MpFaceCtx*, MpRuntimeStats*);
+int   mp_face_landmarker_detect_batch(MpFaceCtx* const* ctxs, const MpImage* imgs,
+                                      const int64_t* timestamps_us, int32_t n,
+                                      MpFaceResult* outs, int32_t* rcs);
+int   mp_face_landmarker_get_allocation(MpFaceCtx*, MpCpuAllocation*);
 
 // Short aliases (some loaders look for these names)
 int   face_create(const MpFaceLandmarkerOptions*, MpFaceCtx**);
@@ -95,6 +177,25 @@ typedef struct MpRuntimeApi {
   void  (*face_free_result)(MpFaceResult*);
   void  (*face_close)(MpFaceCtx**);
   const char* (*get_last_error)(void);
+
+  // v5+: check api_version before use (see MpApiHas() in the loader).
+  int   (*face_get_stats)(MpFaceCtx*, MpRuntimeStats*);
+
+  // v6+: n frames from n contexts (one per stream, so tracking state and
+  // timestamps stay per stream) in one call. Contexts must have been created
+  // from the same model. Backends that can run the networks batched do so;
+  // others leave this NULL and callers detect frame by frame. outs[i] is
+  // freed with face_free_result. rcs (may be NULL) gets each frame's own
+  // status, so a caller can retry just the frames that failed. Returns 0,
+  // or the first error (every outs[i] is still valid, maybe empty).
+  int   (*face_detect_batch)(MpFaceCtx* const* ctxs, const MpImage* imgs,
+                             const int64_t* timestamps_us, int32_t n,
+                             MpFaceResult* outs, int32_t* rcs);
+
+  // v7+: this context's share of the process CPU budget. Backends whose
+  // thread count is fixed when the graph is built rebuild the context in
+  // the background once a new split has settled.
+  int   (*face_get_allocation)(MpFaceCtx*, MpCpuAllocation*);
 } MpRuntimeApi;
 
 // Exported by the runtime shared object:
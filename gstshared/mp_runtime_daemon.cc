@@ -0,0 +1,289 @@
+// gstshared/mp_runtime_daemon.cc
+// Local face-landmark server for libmp_runtime_ipc.so clients (protocol in
+// mp_ipc.h). Loads the real runtime once through mp_runtime_loader
+// (MP_RUNTIME_PATH as usual), serves every client process on the machine,
+// and batches their frames per model with mp_batcher.
+//
+//   mp_runtime_daemon [--socket PATH] [--batch-window-us N]
+//                     [--cpu-set LIST] [--rt-priority N] [--lock-memory]
+//
+// --cpu-set / --rt-priority pin the daemon's main thread before anything
+// starts, so client threads and runtime workers inherit them;
+// --lock-memory asks the runtime to mlock each model. Failures are printed
+// and ignored.
+//
+// Only peers with the daemon's own uid are accepted; the socket is 0600.
+#include "mp_batcher.h"
+#include "mp_ipc.h"
+#include "mp_runtime.h"
+#include "mp_runtime_loader.h"
+#include "mp_thread_policy.h"
+
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace {
+
+std::atomic<int> g_clients{0};
+bool g_lock_memory = false;
+
+struct Client {
+  int sock = -1;
+  MpFaceCtx* ctx = nullptr;
+  int max_faces = 1;
+  std::unique_ptr<mp_batcher::Member> batcher;
+  uint8_t* map = nullptr;
+  size_t map_size = 0;
+
+  ~Client() {
+    batcher.reset();
+    if (ctx) MpApi().face_close(&ctx);
+    if (map) munmap(map, map_size);
+    if (sock >= 0) close(sock);
+  }
+};
+
+void reply(Client& c, const mp_ipc::Request& req, int rc, const char* err = nullptr,
+           const MpRuntimeStats* stats = nullptr, const MpCpuAllocation* alloc = nullptr) {
+  mp_ipc::Reply rep{};
+  rep.magic = mp_ipc::kMagic;
+  rep.seq = req.seq;
+  rep.rc = rc;
+  if (stats) rep.stats = *stats;
+  if (alloc) rep.alloc = *alloc;
+  if (rc != 0) std::snprintf(rep.error, sizeof(rep.error), "%s", err ? err : mp_runtime_loader::last_error());
+  mp_ipc::send_msg(c.sock, &rep, sizeof(rep));
+}
+
+int handle_create(Client& c, const mp_ipc::Request& req, int batch_window_us) {
+  if (c.ctx) return -1;
+  char model[sizeof(req.model_path)];
+  std::memcpy(model, req.model_path, sizeof(model));
+  model[sizeof(model) - 1] = '\0';
+
+  MpFaceLandmarkerOptions opts{};
+  opts.model_path = model;
+  opts.max_faces = std::clamp(req.max_faces, 1, 16);
+  opts.num_threads = req.num_threads;
+  opts.delegate = "cpu";
+  opts.prewarm_frames = req.prewarm_frames;
+  opts.prewarm_width = req.prewarm_width;
+  opts.prewarm_height = req.prewarm_height;
+  opts.detect_scale = req.detect_scale;
+  opts.detect_max_side = req.detect_max_side;
+  opts.lock_memory = g_lock_memory;
+  const int rc = MpApi().face_create(&opts, &c.ctx);
+  if (rc != 0 || !c.ctx) return rc ? rc : -1;
+  c.max_faces = opts.max_faces;
+  if (batch_window_us > 0)
+    c.batcher = std::make_unique<mp_batcher::Member>(model, c.ctx, batch_window_us);
+  return 0;
+}
+
+int handle_map(Client& c, const mp_ipc::Request& req, int fd) {
+  if (fd < 0) return -1;
+  if (req.map_size == 0) {
+    close(fd);
+    return -1;
+  }
+  struct stat st{};
+  if (fstat(fd, &st) != 0 || static_cast<uint64_t>(st.st_size) < req.map_size) {
+    close(fd);
+    return -1;
+  }
+  void* p = mmap(nullptr, req.map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) return -2;
+  if (c.map) munmap(c.map, c.map_size);
+  c.map = static_cast<uint8_t*>(p);
+  c.map_size = req.map_size;
+  return 0;
+}
+
+int handle_detect(Client& c, const mp_ipc::Request& req) {
+  if (!c.ctx || !c.map) return -1;
+  if (req.width <= 0 || req.height <= 0) return -3;
+  uint8_t* seg = c.map;
+
+  // Everything the client points at must stay inside its segment.
+  const size_t W = req.width, H = req.height, cw = (W + 1) / 2, ch = (H + 1) / 2;
+  size_t plane_bytes[3] = {0, 0, 0};
+  int nplanes = 1;
+  switch (req.format) {
+    case MP_IMAGE_RGBA8888: plane_bytes[0] = W * 4 * H; break;
+    case MP_IMAGE_RGB888:   plane_bytes[0] = W * 3 * H; break;
+    case MP_IMAGE_GRAY8:    plane_bytes[0] = W * H; break;
+    case MP_IMAGE_NV12:     plane_bytes[0] = W * H; plane_bytes[1] = cw * 2 * ch; nplanes = 2; break;
+    case MP_IMAGE_I420:
+      plane_bytes[0] = W * H; plane_bytes[1] = plane_bytes[2] = cw * ch; nplanes = 3; break;
+    default: return -3;
+  }
+  for (int p = 0; p < nplanes; ++p)
+    if (req.plane_off[p] > c.map_size || plane_bytes[p] > c.map_size - req.plane_off[p]) return -3;
+  const size_t res_bytes = mp_ipc::result_bytes(c.max_faces);
+  if (req.result_off % 4 || req.result_off > c.map_size || res_bytes > c.map_size - req.result_off)
+    return -3;
+
+  MpImage img{};
+  img.data = seg + req.plane_off[0];
+  img.width = req.width;
+  img.height = req.height;
+  img.format = static_cast<MpImageFormat>(req.format);
+  img.stride = static_cast<int32_t>(plane_bytes[0] / H);
+  if (nplanes > 1) {
+    for (int p = 0; p < nplanes; ++p) {
+      img.planes[p] = seg + req.plane_off[p];
+      img.strides[p] = static_cast<int32_t>(plane_bytes[p] / (p == 0 ? H : ch));
+    }
+  }
+
+  MpFaceResult out{};
+  const int rc = c.batcher ? c.batcher->detect(&img, req.ts_us, &out)
+                           : MpApi().face_detect(c.ctx, &img, req.ts_us, &out);
+  uint8_t* res = seg + req.result_off;
+  const int32_t F = (rc == 0) ? std::min<int32_t>(out.faces_count, c.max_faces) : 0;
+  std::memcpy(res, &F, sizeof(F));
+  auto* counts = reinterpret_cast<int32_t*>(res) + 1;
+  auto* lm = reinterpret_cast<MpLandmark*>(counts + c.max_faces);
+  for (int fi = 0; fi < F; ++fi) {
+    const int32_t N = std::min<int32_t>(out.faces[fi].landmarks_count, mp_ipc::kMaxLandmarks);
+    counts[fi] = N;
+    std::memcpy(lm + static_cast<size_t>(fi) * mp_ipc::kMaxLandmarks, out.faces[fi].landmarks,
+                sizeof(MpLandmark) * N);
+  }
+  MpApi().face_free_result(&out);
+  return rc;
+}
+
+void serve(int sock, int batch_window_us) {
+  Client c;
+  c.sock = sock;
+  const int n = ++g_clients;
+  fprintf(stderr, "[mp_runtime_daemon] client connected (%d active)\n", n);
+  bool open = true;
+  while (open) {
+    mp_ipc::Request req{};
+    int fd = -1;
+    if (!mp_ipc::recv_msg(sock, &req, sizeof(req), &fd) || req.magic != mp_ipc::kMagic) {
+      if (fd >= 0) close(fd);
+      break;
+    }
+    if (req.op != mp_ipc::OP_MAP && fd >= 0) {
+      close(fd);
+      fd = -1;
+    }
+    switch (req.op) {
+      case mp_ipc::OP_CREATE: reply(c, req, handle_create(c, req, batch_window_us)); break;
+      case mp_ipc::OP_MAP:    reply(c, req, handle_map(c, req, fd), "invalid segment"); break;
+      case mp_ipc::OP_DETECT: reply(c, req, handle_detect(c, req)); break;
+      case mp_ipc::OP_STATS: {
+        MpRuntimeStats st{};
+        const int rc = (c.ctx && MpApiHas(5) && MpApi().face_get_stats)
+                           ? MpApi().face_get_stats(c.ctx, &st) : -1;
+        reply(c, req, rc, "stats unavailable", &st);
+        break;
+      }
+      case mp_ipc::OP_ALLOC: {
+        MpCpuAllocation a{};
+        const int rc = (c.ctx && MpApiHas(7) && MpApi().face_get_allocation)
+                           ? MpApi().face_get_allocation(c.ctx, &a) : -1;
+        reply(c, req, rc, "allocation unavailable", nullptr, &a);
+        break;
+      }
+      case mp_ipc::OP_CLOSE:
+      default:
+        open = false;
+        break;
+    }
+  }
+  fprintf(stderr, "[mp_runtime_daemon] client disconnected (%d active)\n", --g_clients);
+}
+
+bool same_uid(int sock) {
+  ucred cred{};
+  socklen_t len = sizeof(cred);
+  return getsockopt(sock, SOL_SOCKET, SO_PEERCRED, &cred, &len) == 0 && cred.uid == getuid();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string path = mp_ipc::kDefaultSocket;
+  int batch_window_us = 0;
+  std::string cpu_set;
+  int rt_priority = 0;
+  for (int i = 1; i < argc; ++i) {
+    const std::string a = argv[i];
+    if (a == "--socket" && i + 1 < argc) path = argv[++i];
+    else if (a == "--batch-window-us" && i + 1 < argc) batch_window_us = std::atoi(argv[++i]);
+    else if (a == "--cpu-set" && i + 1 < argc) cpu_set = argv[++i];
+    else if (a == "--rt-priority" && i + 1 < argc) rt_priority = std::atoi(argv[++i]);
+    else if (a == "--lock-memory") g_lock_memory = true;
+    else {
+      fprintf(stderr,
+              "usage: %s [--socket PATH] [--batch-window-us N] [--cpu-set LIST] "
+              "[--rt-priority N] [--lock-memory]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+  signal(SIGPIPE, SIG_IGN);
+  const std::string policy_err = mp_thread_policy::apply(cpu_set.c_str(), rt_priority);
+  if (!policy_err.empty())
+    fprintf(stderr, "[mp_runtime_daemon] thread policy partly ignored: %s\n", policy_err.c_str());
+
+  if (!MpApiOK()) {
+    fprintf(stderr, "[mp_runtime_daemon] cannot load runtime: %s\n", mp_runtime_loader::last_error());
+    return 1;
+  }
+  fprintf(stderr, "[mp_runtime_daemon] runtime %s (api v%d)\n", MpApi().runtime_build(),
+          MpApi().api_version);
+
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "[mp_runtime_daemon] socket path too long\n");
+    return 1;
+  }
+  std::strcpy(addr.sun_path, path.c_str());
+  const int ls = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  unlink(path.c_str());
+  const mode_t old_mask = umask(0177);
+  const bool bound = ls >= 0 && bind(ls, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+  umask(old_mask);
+  if (!bound || listen(ls, 64) != 0) {
+    fprintf(stderr, "[mp_runtime_daemon] cannot listen on %s: %s\n", path.c_str(), std::strerror(errno));
+    return 1;
+  }
+  fprintf(stderr, "[mp_runtime_daemon] listening on %s (batch window %d us)\n", path.c_str(),
+          batch_window_us);
+
+  for (;;) {
+    const int s = accept4(ls, nullptr, nullptr, SOCK_CLOEXEC);
+    if (s < 0) {
+      if (errno == EINTR) continue;
+      fprintf(stderr, "[mp_runtime_daemon] accept: %s\n", std::strerror(errno));
+      continue;
+    }
+    if (!same_uid(s)) {
+      fprintf(stderr, "[mp_runtime_daemon] rejected peer with a different uid\n");
+      close(s);
+      continue;
+    }
+    std::thread(serve, s, batch_window_us).detach();
+  }
+}
@@ -0,0 +1,402 @@
+// gstshared/mp_runtime_ipc.cc
+// MpRuntimeApi client shim: forwards every context to mp_runtime_daemon over
+// a Unix socket, with frames and landmarks passed through a memfd segment
+// (see mp_ipc.h). Load it with
+//   MP_RUNTIME_PATH=/path/to/libmp_runtime_ipc.so
+// Environment:
+//   MP_IPC_SOCKET       daemon socket (default /tmp/mp_runtime.sock)
+//   MP_IPC_TIMEOUT_MS   per-request reply timeout (default 2000)
+//
+// If the daemon dies or stops answering, calls fail with -5 (frames pass
+// through untouched in the plugins) and the connection is dropped. A later
+// call reconnects, after a backoff growing from 100 ms to 5 s, and creates
+// the daemon-side context and shared segment again; the media pipeline
+// itself is unaffected.
+#include "mp_runtime.h"
+#include "mp_ipc.h"
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+
+namespace {
+
+std::mutex g_error_mutex;
+std::string g_last_runtime_error;
+
+void set_last_error(const std::string& err) {
+  std::lock_guard<std::mutex> lock(g_error_mutex);
+  g_last_runtime_error = err;
+  fprintf(stderr, "[mp_runtime_ipc] ERROR: %s\n", err.c_str());
+}
+
+const char* rt_get_last_error() {
+  std::lock_guard<std::mutex> lock(g_error_mutex);
+  return g_last_runtime_error.c_str();
+}
+
+long env_long(const char* name, long def) {
+  const char* v = std::getenv(name);
+  return (v && *v) ? std::strtol(v, nullptr, 10) : def;
+}
+
+size_t align_up(size_t v, size_t a) { return (v + a - 1) / a * a; }
+
+using Clock = std::chrono::steady_clock;
+constexpr int kMinBackoffMs = 100;
+constexpr int kMaxBackoffMs = 5000;
+
+}  // namespace
+
+struct MpFaceCtx {
+  int sock = -1;               // -1 while disconnected
+  int memfd = -1;
+  uint8_t* map = nullptr;
+  size_t map_size = 0;
+  uint32_t seq = 0;
+  int max_faces = 1;
+  long timeout_ms = 2000;
+  std::string socket_path;
+  mp_ipc::Request create_req{};  // sent again on reconnect
+  int backoff_ms = 0;            // 0 while connected
+  Clock::time_point retry_at{};
+};
+
+static int rt_version(void) { return 1; }
+static const char* rt_build(void) { return "ipc " __DATE__ " " __TIME__; }
+
+static void unmap(MpFaceCtx* ctx) {
+  if (ctx->map) munmap(ctx->map, ctx->map_size);
+  if (ctx->memfd >= 0) close(ctx->memfd);
+  ctx->map = nullptr;
+  ctx->memfd = -1;
+  ctx->map_size = 0;
+}
+
+// Sends req and waits for its reply; false (with the error recorded) on
+// transport failure. The daemon's own rc is left to the caller.
+static bool exchange(MpFaceCtx* ctx, mp_ipc::Request* req, mp_ipc::Reply* rep, int fd = -1) {
+  errno = 0;
+  req->magic = mp_ipc::kMagic;
+  req->seq = ++ctx->seq;
+  if (!mp_ipc::send_msg(ctx->sock, req, sizeof(*req), fd) ||
+      !mp_ipc::recv_msg(ctx->sock, rep, sizeof(*rep)) ||
+      rep->magic != mp_ipc::kMagic || rep->seq != req->seq) {
+    set_last_error(std::string("mp_runtime daemon not responding: ") +
+                   (errno ? std::strerror(errno) : "protocol error"));
+    return false;
+  }
+  if (rep->rc != 0) {
+    rep->error[sizeof(rep->error) - 1] = '\0';
+    set_last_error(rep->error);
+  }
+  return true;
+}
+
+// Connects, creates the daemon-side context from create_req and hands over
+// the current segment, if any. Leaves the socket open on failure.
+static int open_session(MpFaceCtx* ctx) {
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  std::strcpy(addr.sun_path, ctx->socket_path.c_str());
+  ctx->sock = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if (ctx->sock < 0 || connect(ctx->sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+    set_last_error("cannot connect to mp_runtime daemon at " + ctx->socket_path + ": " +
+                   std::strerror(errno));
+    return -1;
+  }
+  // Creation may include model load + prewarm on the daemon side; only the
+  // per-frame requests get the short timeout.
+  timeval create_tv{120, 0};
+  setsockopt(ctx->sock, SOL_SOCKET, SO_RCVTIMEO, &create_tv, sizeof(create_tv));
+  mp_ipc::Request req = ctx->create_req;
+  mp_ipc::Reply rep{};
+  if (!exchange(ctx, &req, &rep)) return -5;
+  if (rep.rc != 0) return rep.rc;
+  timeval tv{ctx->timeout_ms / 1000, (ctx->timeout_ms % 1000) * 1000};
+  setsockopt(ctx->sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  setsockopt(ctx->sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+  if (ctx->memfd >= 0) {
+    mp_ipc::Request map{};
+    map.op = mp_ipc::OP_MAP;
+    map.map_size = ctx->map_size;
+    if (!exchange(ctx, &map, &rep, ctx->memfd)) return -5;
+    if (rep.rc != 0) return rep.rc;
+  }
+  return 0;
+}
+
+// Drops the connection; the next call after the backoff reconnects.
+static void disconnect(MpFaceCtx* ctx) {
+  if (ctx->sock >= 0) close(ctx->sock);
+  ctx->sock = -1;
+  ctx->backoff_ms = ctx->backoff_ms ? std::min(ctx->backoff_ms * 2, kMaxBackoffMs) : kMinBackoffMs;
+  ctx->retry_at = Clock::now() + std::chrono::milliseconds(ctx->backoff_ms);
+}
+
+// One request/response round trip. A transport failure drops the
+// connection, so later calls fail fast until the backoff has passed and
+// then reconnect.
+static int roundtrip(MpFaceCtx* ctx, mp_ipc::Request* req, mp_ipc::Reply* rep, int fd = -1) {
+  if (ctx->sock < 0) {
+    if (Clock::now() < ctx->retry_at) return -5;
+    if (open_session(ctx) != 0) {
+      disconnect(ctx);
+      return -5;
+    }
+    std::fprintf(stderr, "[mp_runtime_ipc] reconnected to %s\n", ctx->socket_path.c_str());
+    ctx->backoff_ms = 0;
+  }
+  if (!exchange(ctx, req, rep, fd)) {
+    disconnect(ctx);
+    return -5;
+  }
+  return rep->rc;
+}
+
+static int rt_face_create(const MpFaceLandmarkerOptions* opts, MpFaceCtx** out) {
+  if (!out || !opts || !opts->model_path || !*opts->model_path) return -1;
+
+  mp_ipc::Request req{};
+  req.op = mp_ipc::OP_CREATE;
+  // The daemon resolves the path itself, so make it absolute.
+  char* abs = realpath(opts->model_path, nullptr);
+  const std::string model = abs ? abs : opts->model_path;
+  std::free(abs);
+  if (model.size() >= sizeof(req.model_path)) {
+    set_last_error("model path too long");
+    return -1;
+  }
+  std::memcpy(req.model_path, model.c_str(), model.size() + 1);
+  req.max_faces = std::max(1, opts->max_faces);
+  req.num_threads = opts->num_threads;
+  req.prewarm_frames = opts->prewarm_frames;
+  req.prewarm_width = opts->prewarm_width;
+  req.prewarm_height = opts->prewarm_height;
+  req.detect_scale = opts->detect_scale;
+  req.detect_max_side = opts->detect_max_side;
+  // cpu_set / rt_priority / lock_memory do not cross the socket: the
+  // daemon's threads follow the daemon's own flags.
+
+  const char* path = std::getenv("MP_IPC_SOCKET");
+  if (!path || !*path) path = mp_ipc::kDefaultSocket;
+  if (std::strlen(path) >= sizeof(sockaddr_un::sun_path)) {
+    set_last_error(std::string("socket path too long: ") + path);
+    return -1;
+  }
+
+  auto ctx = new MpFaceCtx();
+  ctx->max_faces = req.max_faces;
+  ctx->timeout_ms = std::max(1L, env_long("MP_IPC_TIMEOUT_MS", 2000));
+  ctx->socket_path = path;
+  ctx->create_req = req;
+  if (const int rc = open_session(ctx)) {
+    if (ctx->sock >= 0) close(ctx->sock);
+    delete ctx;
+    return rc;
+  }
+  *out = ctx;
+  return 0;
+}
+
+// Grows the shared segment (new memfd, handed over with OP_MAP) when a
+// frame and its results do not fit.
+static int ensure_segment(MpFaceCtx* ctx, size_t frame_bytes) {
+  const size_t need = align_up(frame_bytes, 64) + mp_ipc::result_bytes(ctx->max_faces);
+  if (need <= ctx->map_size) return 0;
+  const size_t size = align_up(need, 4096);
+
+  int fd = memfd_create("mp_runtime_ipc", MFD_CLOEXEC);
+  if (fd < 0 || ftruncate(fd, static_cast<off_t>(size)) != 0) {
+    set_last_error(std::string("memfd: ") + std::strerror(errno));
+    if (fd >= 0) close(fd);
+    return -2;
+  }
+  void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (p == MAP_FAILED) {
+    set_last_error(std::string("mmap: ") + std::strerror(errno));
+    close(fd);
+    return -2;
+  }
+  mp_ipc::Request req{};
+  req.op = mp_ipc::OP_MAP;
+  req.map_size = size;
+  mp_ipc::Reply rep{};
+  const int rc = roundtrip(ctx, &req, &rep, fd);
+  if (rc != 0) {
+    munmap(p, size);
+    close(fd);
+    return rc;
+  }
+  unmap(ctx);
+  ctx->memfd = fd;
+  ctx->map = static_cast<uint8_t*>(p);
+  ctx->map_size = size;
+  return 0;
+}
+
+static void copy_plane(uint8_t* dst, const uint8_t* src, int src_stride, int row_bytes, int rows) {
+  for (int y = 0; y < rows; ++y)
+    std::memcpy(dst + static_cast<size_t>(y) * row_bytes, src + static_cast<size_t>(y) * src_stride,
+                row_bytes);
+}
+
+static int rt_face_detect(MpFaceCtx* ctx, const MpImage* img, int64_t ts_us,
+                          MpFaceResult* out) {
+  if (!ctx || !out) return -1;
+  out->faces = nullptr;
+  out->faces_count = 0;
+  out->timestamp_us = (ts_us < 0) ? 0 : ts_us;
+  if (!img || img->width <= 0 || img->height <= 0) return -3;
+
+  // Tightly packed plane layout of the frame inside the slot.
+  const int W = img->width, H = img->height;
+  const int cw = (W + 1) / 2, ch = (H + 1) / 2;
+  int bpp = 0, nplanes = 1;
+  switch (img->format) {
+    case MP_IMAGE_RGBA8888: bpp = 4; break;
+    case MP_IMAGE_RGB888:   bpp = 3; break;
+    case MP_IMAGE_GRAY8:    bpp = 1; break;
+    case MP_IMAGE_NV12:     bpp = 1; nplanes = 2; break;
+    case MP_IMAGE_I420:     bpp = 1; nplanes = 3; break;
+    default: return -3;
+  }
+  const uint8_t* src[3] = {img->planes[0] ? img->planes[0] : img->data, img->planes[1],
+                           img->planes[2]};
+  const int src_stride[3] = {img->planes[0] ? img->strides[0] : img->stride, img->strides[1],
+                             img->strides[2]};
+  int row_bytes[3] = {W * bpp, 0, 0};
+  int rows[3] = {H, 0, 0};
+  if (nplanes == 2) { row_bytes[1] = cw * 2; rows[1] = ch; }
+  if (nplanes == 3) { row_bytes[1] = row_bytes[2] = cw; rows[1] = rows[2] = ch; }
+  for (int p = 0; p < nplanes; ++p)
+    if (!src[p]) return -3;
+
+  size_t off[3] = {0, 0, 0}, frame_bytes = 0;
+  for (int p = 0; p < nplanes; ++p) {
+    off[p] = frame_bytes;
+    frame_bytes += static_cast<size_t>(row_bytes[p]) * rows[p];
+  }
+  if (const int rc = ensure_segment(ctx, frame_bytes)) return rc;
+
+  for (int p = 0; p < nplanes; ++p)
+    copy_plane(ctx->map + off[p], src[p], src_stride[p], row_bytes[p], rows[p]);
+
+  mp_ipc::Request req{};
+  req.op = mp_ipc::OP_DETECT;
+  req.ts_us = ts_us;
+  req.width = W;
+  req.height = H;
+  req.format = img->format;
+  for (int p = 0; p < 3; ++p) {
+    req.plane_off[p] = off[p];
+    req.strides[p] = row_bytes[p];
+  }
+  req.result_off = align_up(frame_bytes, 64);
+  mp_ipc::Reply rep{};
+  if (const int rc = roundtrip(ctx, &req, &rep)) return rc;
+
+  // Results: counts, then landmark arrays; copied out so the segment can be reused.
+  const uint8_t* res = ctx->map + req.result_off;
+  int32_t F = 0;
+  std::memcpy(&F, res, sizeof(F));
+  F = std::clamp(F, 0, ctx->max_faces);
+  if (F == 0) return 0;
+  const int32_t* counts = reinterpret_cast<const int32_t*>(res) + 1;
+  const MpLandmark* lm = reinterpret_cast<const MpLandmark*>(counts + ctx->max_faces);
+  auto* faces = static_cast<MpFace*>(std::calloc(F, sizeof(MpFace)));
+  if (!faces) return -2;
+  for (int fi = 0; fi < F; ++fi) {
+    const int N = std::clamp(counts[fi], 0, mp_ipc::kMaxLandmarks);
+    auto* pts = static_cast<MpLandmark*>(std::malloc(sizeof(MpLandmark) * std::max(N, 1)));
+    if (!pts) {
+      for (int j = 0; j < fi; ++j) std::free(const_cast<MpLandmark*>(faces[j].landmarks));
+      std::free(faces);
+      return -2;
+    }
+    std::memcpy(pts, lm + static_cast<size_t>(fi) * mp_ipc::kMaxLandmarks, sizeof(MpLandmark) * N);
+    faces[fi].landmarks = pts;
+    faces[fi].landmarks_count = N;
+  }
+  out->faces = faces;
+  out->faces_count = F;
+  return 0;
+}
+
+static void rt_face_free_result(MpFaceResult* out) {
+  if (!out || !out->faces) return;
+  for (int i = 0; i < out->faces_count; ++i)
+    std::free(const_cast<MpLandmark*>(out->faces[i].landmarks));
+  std::free(const_cast<MpFace*>(out->faces));
+  out->faces = nullptr;
+  out->faces_count = 0;
+}
+
+static void rt_face_close(MpFaceCtx** pctx) {
+  if (pctx && *pctx) {
+    MpFaceCtx* ctx = *pctx;
+    *pctx = nullptr;
+    if (ctx->sock >= 0) {
+      mp_ipc::Request req{};
+      req.magic = mp_ipc::kMagic;
+      req.op = mp_ipc::OP_CLOSE;
+      mp_ipc::send_msg(ctx->sock, &req, sizeof(req));
+      close(ctx->sock);
+    }
+    unmap(ctx);
+    delete ctx;
+  }
+}
+
+static int rt_face_get_stats(MpFaceCtx* ctx, MpRuntimeStats* out) {
+  if (!ctx || !out) return -1;
+  mp_ipc::Request req{};
+  req.op = mp_ipc::OP_STATS;
+  mp_ipc::Reply rep{};
+  if (const int rc = roundtrip(ctx, &req, &rep)) return rc;
+  *out = rep.stats;
+  return 0;
+}
+
+// The share of the daemon's budget. Inference runs there; the caller's own
+// work in this process is not coordinated, so no warp threads are reported.
+static int rt_face_get_allocation(MpFaceCtx* ctx, MpCpuAllocation* out) {
+  if (!ctx || !out) return -1;
+  mp_ipc::Request req{};
+  req.op = mp_ipc::OP_ALLOC;
+  mp_ipc::Reply rep{};
+  if (const int rc = roundtrip(ctx, &req, &rep)) return rc;
+  *out = rep.alloc;
+  out->warp_threads = 0;
+  out->warp_pool = 0;
+  return 0;
+}
+
+// ---------- API table ----------
+static const MpRuntimeApi g_api = {
+    /*api_version=*/MP_RUNTIME_API_VERSION,
+    /*runtime_version=*/rt_version,
+    /*runtime_build=*/rt_build,
+    /*face_create=*/rt_face_create,
+    /*face_detect=*/rt_face_detect,
+    /*face_free_result=*/rt_face_free_result,
+    /*face_close=*/rt_face_close,
+    /*get_last_error=*/rt_get_last_error,
+    /*face_get_stats=*/rt_face_get_stats,
+    /*face_detect_batch=*/nullptr,  // cross-stream batching happens in the daemon
+    /*face_get_allocation=*/rt_face_get_allocation,
+};
+
+extern "C" const MpRuntimeApi* mp_runtime_get_api(void) { return &g_api; }
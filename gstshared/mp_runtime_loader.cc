@@ -64,7 +64,8 @@ static bool init_impl(const char* path) {
     return false;
   }
 
-  g_api_fallback.api_version   = MP_RUNTIME_API_VERSION;
+  // Flat symbols predate the table; they only ever implemented v1.
+  g_api_fallback.api_version   = 1;
   g_api_fallback.runtime_version = v_fn ? v_fn : [](){ return 0; };
   g_api_fallback.runtime_build   = b_fn ? b_fn : [](){ return "unknown"; };
   g_api_fallback.face_create     = fc;
@@ -46,6 +46,9 @@ namespace mp_runtime_loader {
 // Global helpers used by your plugin code
 inline bool MpApiOK()                       { return mp_runtime_loader::Init(nullptr); }
 inline const MpRuntimeApi& MpApi()          { return mp_runtime_loader::MpApi(); }
+// True when the loaded runtime implements API version >= v (table entries
+// added after v1 must be guarded with this).
+inline bool MpApiHas(int v)                 { return MpApiOK() && MpApi().api_version >= v; }
 #endif  // __cplusplus
 
 #endif  // MP_RUNTIME_LOADER_H_
\ No newline at end of file
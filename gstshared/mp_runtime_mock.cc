@@ -0,0 +1,298 @@
+// gstshared/mp_runtime_mock.cc
+// Drop-in MpRuntimeApi implementation without MediaPipe, for benchmarking
+// and regression-testing the warp side of the plugins. Load it with
+//   MP_RUNTIME_PATH=/path/to/libmp_runtime_mock.so
+//
+// Landmarks come from, in order of preference:
+//   MP_MOCK_REPLAY=<file>   a LANDMARK_OUTPUT_FILE dump ("Frame N Face K:" then
+//                           one "x,y,z" line per landmark), replayed in a loop
+//   otherwise               synthetic 478-point faces moving on a fixed path
+// Other knobs (environment):
+//   MP_MOCK_LATENCY_US      artificial per-frame latency (default 0)
+//   MP_MOCK_JITTER_US       +/- jitter on top, from a seeded PRNG (default 0)
+//   MP_MOCK_SPIN=1          busy-wait instead of sleeping (emulates CPU load)
+//   MP_MOCK_FACES           synthetic faces per frame (default 1, <= max_faces)
+//
+// Output depends only on the call index, never on wall-clock time or the
+// timestamps passed in, so two runs with the same settings are identical.
+#include "mp_runtime.h"
+#include "mp_cpu_budget.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr int kNumLandmarks = 478;
+
+std::mutex g_error_mutex;
+std::string g_last_runtime_error;
+
+void set_last_error(const std::string& err) {
+  std::lock_guard<std::mutex> lock(g_error_mutex);
+  g_last_runtime_error = err;
+  fprintf(stderr, "[mp_runtime_mock] ERROR: %s\n", err.c_str());
+}
+
+const char* rt_get_last_error() {
+  std::lock_guard<std::mutex> lock(g_error_mutex);
+  return g_last_runtime_error.c_str();
+}
+
+long env_long(const char* name, long def) {
+  const char* v = std::getenv(name);
+  return (v && *v) ? std::strtol(v, nullptr, 10) : def;
+}
+
+using Face = std::vector<MpLandmark>;
+using Frame = std::vector<Face>;
+
+// Parses the LANDMARK_OUTPUT_FILE format written by mozza_mp/mozza_mp_gpu.
+// Consecutive headers with the same frame number are extra faces of that
+// frame; a header with no landmark lines is a frame without a face.
+bool load_replay(const char* path, std::vector<Frame>* frames) {
+  FILE* f = std::fopen(path, "r");
+  if (!f) return false;
+  char line[256];
+  long cur_id = -1;
+  while (std::fgets(line, sizeof(line), f)) {
+    unsigned long long fid = 0;
+    int face = 0;
+    if (std::sscanf(line, "Frame %llu Face %d", &fid, &face) == 2) {
+      if (frames->empty() || (long)fid != cur_id) frames->emplace_back();
+      cur_id = (long)fid;
+      frames->back().emplace_back();
+      continue;
+    }
+    MpLandmark lm{};
+    if (!frames->empty() && std::sscanf(line, "%f,%f,%f", &lm.x, &lm.y, &lm.z) == 3)
+      frames->back().back().push_back(lm);
+  }
+  std::fclose(f);
+  for (Frame& fr : *frames)
+    fr.erase(std::remove_if(fr.begin(), fr.end(), [](const Face& fc) { return fc.empty(); }),
+             fr.end());
+  return !frames->empty();
+}
+
+// A face-sized cloud of 478 points (sunflower layout inside an ellipse)
+// drifting on a Lissajous path, with a slow scale "breathing".
+void synth_face(uint64_t n, int face_idx, Face* out) {
+  const double t = static_cast<double>(n);
+  const double ph = face_idx * 1.7;
+  const double base_x = face_idx == 0 ? 0.5 : (face_idx % 2 ? 0.8 : 0.2);
+  const double cx = base_x + 0.15 * std::sin(2 * M_PI * t / 240.0 + ph);
+  const double cy = 0.5 + 0.08 * std::sin(2 * M_PI * t / 180.0 + ph);
+  const double s = 1.0 + 0.03 * std::sin(2 * M_PI * t / 90.0);
+  const double rx = 0.12 * s, ry = 0.17 * s;
+  out->resize(kNumLandmarks);
+  for (int i = 0; i < kNumLandmarks; ++i) {
+    const double r = std::sqrt((i + 0.5) / kNumLandmarks);
+    const double a = i * 2.399963229728653;  // golden angle
+    (*out)[i].x = static_cast<float>(cx + rx * r * std::cos(a));
+    (*out)[i].y = static_cast<float>(cy + ry * r * std::sin(a));
+    (*out)[i].z = static_cast<float>(-0.05 * (1.0 - r));
+  }
+}
+
+}  // namespace
+
+struct MpFaceCtx {
+  std::vector<Frame> replay;
+  int max_faces = 1;
+  int synth_faces = 1;
+  long latency_us = 0;
+  long jitter_us = 0;
+  bool spin = false;
+  uint64_t calls = 0;
+  uint64_t rng = 0x9E3779B97F4A7C15ull;
+  MpRuntimeStats stats{};
+  int prev_faces = 0;
+
+  // Registered with the CPU budget so allocations can be inspected without
+  // MediaPipe; the emulated latency does not depend on it.
+  int budget_id = -1;
+  int requested_threads = 0;
+  ~MpFaceCtx() { mp_cpu_budget::leave(budget_id); }
+};
+
+static int rt_version(void) { return 1; }
+static const char* rt_build(void) { return "mock " __DATE__ " " __TIME__; }
+
+static int rt_face_create(const MpFaceLandmarkerOptions* opts, MpFaceCtx** out) {
+  if (!out || !opts) return -1;
+  auto ctx = new MpFaceCtx();
+  ctx->max_faces = std::max(1, opts->max_faces);
+  ctx->synth_faces = std::clamp<int>(env_long("MP_MOCK_FACES", 1), 0, ctx->max_faces);
+  ctx->latency_us = std::max(0L, env_long("MP_MOCK_LATENCY_US", 0));
+  ctx->jitter_us = std::max(0L, env_long("MP_MOCK_JITTER_US", 0));
+  ctx->spin = env_long("MP_MOCK_SPIN", 0) != 0;
+  ctx->requested_threads = opts->num_threads;
+  ctx->budget_id = mp_cpu_budget::join(opts->num_threads);
+
+  if (const char* path = std::getenv("MP_MOCK_REPLAY")) {
+    if (*path && !load_replay(path, &ctx->replay)) {
+      set_last_error(std::string("cannot load replay file: ") + path);
+      delete ctx;
+      return -1;
+    }
+  }
+  fprintf(stderr, "[mp_runtime_mock] %s, latency=%ldus jitter=%ldus%s\n",
+          ctx->replay.empty() ? "synthetic faces" : "replay",
+          ctx->latency_us, ctx->jitter_us, ctx->spin ? " (spin)" : "");
+  *out = ctx;
+  return 0;
+}
+
+static void emulate_latency(MpFaceCtx* ctx) {
+  long us = ctx->latency_us;
+  if (ctx->jitter_us > 0) {
+    ctx->rng ^= ctx->rng << 13; ctx->rng ^= ctx->rng >> 7; ctx->rng ^= ctx->rng << 17;
+    us += static_cast<long>(ctx->rng % (2 * ctx->jitter_us + 1)) - ctx->jitter_us;
+  }
+  if (us <= 0) return;
+  const auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(us);
+  if (ctx->spin) {
+    while (std::chrono::steady_clock::now() < until) {}
+  } else {
+    std::this_thread::sleep_until(until);
+  }
+}
+
+static int detect_one(MpFaceCtx* ctx, const MpImage* img, int64_t ts_us,
+                      MpFaceResult* out, bool with_latency) {
+  if (!ctx || !out) return -1;
+  out->faces = nullptr;
+  out->faces_count = 0;
+  out->timestamp_us = (ts_us < 0) ? 0 : ts_us;
+  if (!img || img->width <= 0 || img->height <= 0) return -3;
+
+  using Clock = std::chrono::steady_clock;
+  auto us_since = [](Clock::time_point t) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - t).count();
+  };
+  MpRuntimeStats& st = ctx->stats;
+  const uint64_t n = ctx->calls++;
+  st.frames += 1;
+  st.ingest_us_last = 0;
+
+  const auto t_graph = Clock::now();
+  if (with_latency) emulate_latency(ctx);
+  Frame synth;
+  const Frame* src = nullptr;
+  if (!ctx->replay.empty()) {
+    src = &ctx->replay[n % ctx->replay.size()];
+  } else {
+    synth.resize(ctx->synth_faces);
+    for (int i = 0; i < ctx->synth_faces; ++i) synth_face(n, i, &synth[i]);
+    src = &synth;
+  }
+  st.graph_us_last = us_since(t_graph);
+  st.graph_us_total += st.graph_us_last;
+  if (ctx->prev_faces < ctx->max_faces) st.detector_runs += 1;
+  if (ctx->prev_faces > 0) st.tracker_runs += 1;
+
+  // Same ownership model as the real runtime: malloc'd, freed by free_result.
+  const auto t_marshal = Clock::now();
+  const int F = std::min<int>(static_cast<int>(src->size()), ctx->max_faces);
+  ctx->prev_faces = F;
+  if (F > 0) {
+    auto* faces = static_cast<MpFace*>(std::calloc(F, sizeof(MpFace)));
+    if (!faces) return -2;
+    for (int fi = 0; fi < F; ++fi) {
+      const Face& face = (*src)[fi];
+      auto* pts = static_cast<MpLandmark*>(std::malloc(sizeof(MpLandmark) * face.size()));
+      if (!pts) {
+        for (int j = 0; j < fi; ++j) std::free(const_cast<MpLandmark*>(faces[j].landmarks));
+        std::free(faces);
+        return -2;
+      }
+      std::memcpy(pts, face.data(), sizeof(MpLandmark) * face.size());
+      faces[fi].landmarks = pts;
+      faces[fi].landmarks_count = static_cast<int32_t>(face.size());
+      st.allocations += 1;
+      st.allocated_bytes += sizeof(MpLandmark) * face.size();
+    }
+    out->faces = faces;
+    out->faces_count = F;
+    st.frames_with_face += 1;
+    st.allocations += 1;
+    st.allocated_bytes += sizeof(MpFace) * F;
+  }
+  st.marshal_us_last = us_since(t_marshal);
+  st.marshal_us_total += st.marshal_us_last;
+  return 0;
+}
+
+static int rt_face_detect(MpFaceCtx* ctx, const MpImage* img, int64_t ts_us,
+                          MpFaceResult* out) {
+  return detect_one(ctx, img, ts_us, out, true);
+}
+
+// Models an ideally batched backend: the latency is paid once per batch
+// (by the first context's settings), not once per frame.
+static int rt_face_detect_batch(MpFaceCtx* const* ctxs, const MpImage* imgs,
+                                const int64_t* ts_us, int32_t n, MpFaceResult* outs,
+                                int32_t* rcs) {
+  if (!ctxs || !imgs || !ts_us || !outs || n < 0) return -1;
+  int rc = 0;
+  for (int32_t i = 0; i < n; ++i) {
+    const int r = detect_one(ctxs[i], &imgs[i], ts_us[i], &outs[i], i == 0);
+    if (rcs) rcs[i] = r;
+    if (r != 0 && rc == 0) rc = r;
+  }
+  return rc;
+}
+
+static void rt_face_free_result(MpFaceResult* out) {
+  if (!out || !out->faces) return;
+  for (int i = 0; i < out->faces_count; ++i)
+    std::free(const_cast<MpLandmark*>(out->faces[i].landmarks));
+  std::free(const_cast<MpFace*>(out->faces));
+  out->faces = nullptr;
+  out->faces_count = 0;
+}
+
+static void rt_face_close(MpFaceCtx** pctx) {
+  if (pctx && *pctx) {
+    delete *pctx;
+    *pctx = nullptr;
+  }
+}
+
+static int rt_face_get_stats(MpFaceCtx* ctx, MpRuntimeStats* out) {
+  if (!ctx || !out) return -1;
+  *out = ctx->stats;
+  return 0;
+}
+
+static int rt_face_get_allocation(MpFaceCtx* ctx, MpCpuAllocation* out) {
+  if (!ctx || !out) return -1;
+  mp_cpu_budget::get(ctx->budget_id, ctx->requested_threads, out);
+  return 0;
+}
+
+// ---------- API table ----------
+static const MpRuntimeApi g_api = {
+    /*api_version=*/MP_RUNTIME_API_VERSION,
+    /*runtime_version=*/rt_version,
+    /*runtime_build=*/rt_build,
+    /*face_create=*/rt_face_create,
+    /*face_detect=*/rt_face_detect,
+    /*face_free_result=*/rt_face_free_result,
+    /*face_close=*/rt_face_close,
+    /*get_last_error=*/rt_get_last_error,
+    /*face_get_stats=*/rt_face_get_stats,
+    /*face_detect_batch=*/rt_face_detect_batch,
+    /*face_get_allocation=*/rt_face_get_allocation,
+};
+
+extern "C" const MpRuntimeApi* mp_runtime_get_api(void) { return &g_api; }
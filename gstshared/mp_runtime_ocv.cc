@@ -0,0 +1,700 @@
+// gstshared/mp_runtime_ocv.cc
+// MpRuntimeApi implementation running the two-stage BlazeFace + landmark
+// pipeline on the CPU through OpenCV DNN, without MediaPipe's graph.
+// Uses the same ONNX models as mozza_mp_gpu (face_detector.onnx and
+// face_landmarks.onnx next to the .task file, see convert_models.py) and the
+// shared decode/crop code in face_pipeline.
+//
+// Select it with MP_RUNTIME_PATH=/path/to/libmp_runtime_ocv.so.
+//
+// MP_OCV_LANDMARKS=int8 also loads face_landmarks_int8.onnx
+// (convert_models.py --int8). For the first MP_OCV_INT8_VALIDATE_FACES face
+// crops both landmark models run and the float results are returned; the
+// int8 model is then kept only if its mean landmark error against the float
+// one is at most MP_OCV_INT8_MAX_ERR_PX pixels, otherwise the context stays
+// on the float model.
+// Note: OpenCV's thread pool is process-wide and runs one parallel region
+// at a time; a second context entering one meanwhile runs it on its own
+// thread. With the CPU budget enabled (MP_CPU_BUDGET, see mp_cpu_budget.h)
+// the pool is sized to one context's share (inference + warp threads, which
+// the plugins' OpenCV warp also uses), so no context gets more than its
+// share and the sum stays near the budget. Without it, num_threads applies
+// to all contexts in the process (last create wins).
+#include "mp_runtime.h"
+#include "mp_cpu_budget.h"
+#include "mp_thread_policy.h"
+#include "face_pipeline.h"
+#include "mp_ingest.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/dnn.hpp>
+#include <opencv2/imgproc.hpp>
+
+namespace fp = face_pipeline;
+
+namespace {
+
+std::mutex g_error_mutex;
+std::string g_last_runtime_error;
+
+void set_last_error(const std::string& err) {
+  std::lock_guard<std::mutex> lock(g_error_mutex);
+  g_last_runtime_error = err;
+  fprintf(stderr, "[mp_runtime_ocv] ERROR: %s\n", err.c_str());
+}
+
+const char* rt_get_last_error() {
+  std::lock_guard<std::mutex> lock(g_error_mutex);
+  return g_last_runtime_error.c_str();
+}
+
+bool file_exists(const std::string& path) {
+  FILE* f = std::fopen(path.c_str(), "rb");
+  if (!f) return false;
+  std::fclose(f);
+  return true;
+}
+
+// Item i of an N x H x W x 3 float blob (models keep TFLite's NHWC), as an
+// H x W 3-channel image to fill or as a 1 x H x W x 3 blob to run alone.
+cv::Mat blob_item(cv::Mat& blob, int i) {
+  return cv::Mat(blob.size[1], blob.size[2], CV_32FC3,
+                 blob.ptr<float>() + static_cast<size_t>(i) * blob.size[1] * blob.size[2] * 3);
+}
+cv::Mat blob_single(cv::Mat& blob, int i) {
+  const int sz[4] = {1, blob.size[1], blob.size[2], 3};
+  return cv::Mat(4, sz, CV_32F, blob_item(blob, i).data);
+}
+
+// Picks network outputs by element count; tf2onnx does not keep stable names.
+const cv::Mat* output_with_size(const std::vector<cv::Mat>& outs, size_t n) {
+  for (const cv::Mat& m : outs)
+    if (m.total() == n) return &m;
+  return nullptr;
+}
+
+// Runs net on an N-item blob and gathers, for each per-item output size in
+// `sizes`, the N outputs back to back into (*gathered)[k]. One batched
+// forward is tried first; models exported without a dynamic batch dimension
+// (convert_models.py --dynamic-batch) fall back to one forward per item, and
+// *batch_ok is cleared so later calls go there directly.
+bool forward_gather(cv::dnn::Net& net, const std::vector<std::string>& names,
+                    cv::Mat& blob, const std::vector<size_t>& sizes, bool* batch_ok,
+                    std::vector<std::vector<float>>* gathered) {
+  const int n = blob.size[0];
+  std::vector<cv::Mat> outs;
+  auto collect = [&](int items) {
+    for (size_t k = 0; k < sizes.size(); ++k) {
+      const cv::Mat* m = output_with_size(outs, sizes[k] * items);
+      if (!m) return false;
+      (*gathered)[k].insert((*gathered)[k].end(), m->ptr<float>(),
+                            m->ptr<float>() + sizes[k] * items);
+    }
+    return true;
+  };
+  gathered->assign(sizes.size(), {});
+  if (n == 1 || *batch_ok) {
+    try {
+      net.setInput(blob);
+      net.forward(outs, names);
+      if (collect(n)) return true;
+    } catch (const cv::Exception&) {
+      if (n == 1) throw;
+    }
+    if (n == 1) return false;
+    *batch_ok = false;
+    gathered->assign(sizes.size(), {});
+    fprintf(stderr, "[mp_runtime_ocv] model has no dynamic batch dimension; "
+                    "running batches one frame at a time\n");
+  }
+  for (int i = 0; i < n; ++i) {
+    net.setInput(blob_single(blob, i));
+    net.forward(outs, names);
+    if (!collect(1)) return false;
+  }
+  return true;
+}
+
+int env_int(const char* name, int def) {
+  const char* v = std::getenv(name);
+  return (v && *v) ? std::atoi(v) : def;
+}
+
+double env_double(const char* name, double def) {
+  const char* v = std::getenv(name);
+  return (v && *v) ? std::atof(v) : def;
+}
+
+// Landmark error of the int8 model against the float one, in image pixels
+// (same metrics as compare_landmarks.py).
+struct LmValidation {
+  int faces = 0;           // crops compared so far
+  int target = 150;        // crops to compare before deciding
+  double max_mean_px = 1.0;
+  double sum = 0.0, sum_sq = 0.0, max = 0.0;
+  uint64_t points = 0;
+
+  void add(const float* ref, const float* q, int width, int height) {
+    for (int i = 0; i < face_pipeline::kNumLandmarks; ++i) {
+      const double dx = (q[i * 3] - ref[i * 3]) * width;
+      const double dy = (q[i * 3 + 1] - ref[i * 3 + 1]) * height;
+      const double d = std::sqrt(dx * dx + dy * dy);
+      sum += d;
+      sum_sq += d * d;
+      max = std::max(max, d);
+    }
+    points += face_pipeline::kNumLandmarks;
+    faces += 1;
+  }
+  void reset() {
+    faces = 0;
+    sum = sum_sq = max = 0.0;
+    points = 0;
+  }
+  double mean() const { return points ? sum / points : 0.0; }
+  double rmse() const { return points ? std::sqrt(sum_sq / points) : 0.0; }
+};
+
+}  // namespace
+
+struct MpFaceCtx {
+  cv::dnn::Net det_net;
+  cv::dnn::Net lm_net;
+  std::vector<std::string> det_out_names;
+  std::vector<std::string> lm_out_names;
+
+  // int8 landmark model (MP_OCV_LANDMARKS=int8) and its validation.
+  enum class LmMode { kFloat, kValidating, kInt8 };
+  LmMode lm_mode = LmMode::kFloat;
+  cv::dnn::Net lm_net_q;
+  std::vector<std::string> lm_q_out_names;
+  std::vector<std::vector<float>> lm_q_out;
+  bool batch_q_ok = true;
+  LmValidation lm_check;
+
+  int num_faces = 1;
+  float det_threshold = 0.5f;
+  float detect_scale = 1.f;
+  int detect_max_side = 0;
+
+  // Reused buffers. The frame buffer is per stream; the blobs and scratch
+  // images belong to whichever context leads a batch.
+  cv::Mat rgb;            // frame as RGB when it has to be converted first
+  cv::Mat small;          // letterboxed content, frame channels
+  cv::Mat det_canvas;     // 128x128x3 u8 letterbox
+  cv::Mat det_blob;       // N x 128 x 128 x 3 f32
+  cv::Mat lm_crop;        // 256x256 crop (frame channels)
+  cv::Mat lm_rgb;         // 256x256x3 u8
+  cv::Mat lm_blob;        // M x 256 x 256 x 3 f32
+  std::vector<std::vector<float>> det_out, lm_out;
+  bool batch_ok = true;   // models accept N > 1
+
+  std::vector<fp::RoiSmoother> roi_filters;
+  int64_t prev_ts_us = -1;
+
+  MpRuntimeStats stats{};
+
+  int budget_id = -1;
+  int requested_threads = 0;
+  uint32_t budget_generation = 0;   // split the pool was last sized for
+  ~MpFaceCtx() { mp_cpu_budget::leave(budget_id); }
+};
+
+// Sizes OpenCV's pool to this context's share whenever the split changes.
+static void follow_cpu_budget(MpFaceCtx* ctx) {
+  if (ctx->budget_id < 0) return;
+  MpCpuAllocation alloc{};
+  mp_cpu_budget::get(ctx->budget_id, ctx->requested_threads, &alloc);
+  if (alloc.generation == ctx->budget_generation) return;
+  ctx->budget_generation = alloc.generation;
+  const int share = alloc.inference_threads + alloc.warp_threads;
+  if (share > 0 && share != cv::getNumThreads()) cv::setNumThreads(share);
+}
+
+static int rt_version(void) { return 1; }
+static const char* rt_build(void) { return "opencv-dnn " CV_VERSION " " __DATE__; }
+
+static int rt_face_detect(MpFaceCtx* ctx, const MpImage* img, int64_t ts_us,
+                          MpFaceResult* out);
+static void rt_face_free_result(MpFaceResult* out);
+
+static int rt_face_create(const MpFaceLandmarkerOptions* opts, MpFaceCtx** out) {
+  if (!out || !opts || !opts->model_path || !*opts->model_path) return -1;
+
+  // Same convention as mozza_mp_gpu: ONNX files live next to the .task file.
+  std::string model(opts->model_path);
+  auto slash = model.rfind('/');
+  const std::string dir = (slash != std::string::npos) ? model.substr(0, slash + 1) : "./";
+  const std::string det_onnx = dir + "face_detector.onnx";
+  const std::string lm_onnx = dir + "face_landmarks.onnx";
+  if (!file_exists(det_onnx) || !file_exists(lm_onnx)) {
+    set_last_error("ONNX models not found next to " + model +
+                   " (run convert_models.py): expected " + det_onnx + " and " + lm_onnx);
+    return -1;
+  }
+
+  const auto t0 = std::chrono::steady_clock::now();
+  auto ctx = new MpFaceCtx();
+  try {
+    ctx->det_net = cv::dnn::readNetFromONNX(det_onnx);
+    ctx->lm_net = cv::dnn::readNetFromONNX(lm_onnx);
+  } catch (const cv::Exception& e) {
+    set_last_error(std::string("readNetFromONNX failed: ") + e.what());
+    delete ctx;
+    return -2;
+  }
+  for (cv::dnn::Net* net : {&ctx->det_net, &ctx->lm_net}) {
+    net->setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+    net->setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+  }
+  ctx->det_out_names = ctx->det_net.getUnconnectedOutLayersNames();
+  ctx->lm_out_names = ctx->lm_net.getUnconnectedOutLayersNames();
+
+  const char* lm_variant = std::getenv("MP_OCV_LANDMARKS");
+  if (lm_variant && std::strcmp(lm_variant, "int8") == 0) {
+    const std::string q_onnx = dir + "face_landmarks_int8.onnx";
+    try {
+      if (!file_exists(q_onnx)) throw std::runtime_error("not found (convert_models.py --int8)");
+      ctx->lm_net_q = cv::dnn::readNetFromONNX(q_onnx);
+      ctx->lm_net_q.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+      ctx->lm_net_q.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+      ctx->lm_q_out_names = ctx->lm_net_q.getUnconnectedOutLayersNames();
+      ctx->lm_check.target = env_int("MP_OCV_INT8_VALIDATE_FACES", 150);
+      ctx->lm_check.max_mean_px = env_double("MP_OCV_INT8_MAX_ERR_PX", 1.0);
+      ctx->lm_mode = ctx->lm_check.target > 0 ? MpFaceCtx::LmMode::kValidating
+                                              : MpFaceCtx::LmMode::kInt8;
+    } catch (const std::exception& e) {
+      fprintf(stderr, "[mp_runtime_ocv] int8 landmark model unusable, keeping float: %s: %s\n",
+              q_onnx.c_str(), e.what());
+    }
+  }
+  ctx->requested_threads = opts->num_threads;
+  ctx->budget_id = mp_cpu_budget::join(opts->num_threads);
+  if (ctx->budget_id >= 0) {
+    follow_cpu_budget(ctx);
+  } else if (opts->num_threads > 0) {
+    cv::setNumThreads(opts->num_threads);
+  }
+
+  ctx->num_faces = std::max(1, opts->max_faces);
+  ctx->roi_filters.resize(ctx->num_faces);
+  ctx->detect_scale = opts->detect_scale;
+  ctx->detect_max_side = opts->detect_max_side;
+  ctx->det_canvas.create(fp::kDetSize, fp::kDetSize, CV_8UC3);
+
+  fprintf(stderr, "[mp_runtime_ocv] context created in %.1f ms (%s, %s)\n",
+          std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count(),
+          det_onnx.c_str(), lm_onnx.c_str());
+
+  // Inference runs on the caller's thread and OpenCV's pool, which is
+  // started by whichever thread first runs parallel work; pin the caller
+  // here so a pool started by the prewarm gets the same placement (v8).
+  mp_thread_policy::Scope placement(opts->cpu_set, opts->rt_priority);
+  if (!placement.error().empty())
+    fprintf(stderr, "[mp_runtime_ocv] thread policy partly ignored: %s\n", placement.error().c_str());
+
+  if (opts->prewarm_frames > 0) {
+    const int w = opts->prewarm_width > 0 ? opts->prewarm_width : 640;
+    const int h = opts->prewarm_height > 0 ? opts->prewarm_height : 480;
+    std::vector<uint8_t> grey(static_cast<size_t>(w) * h * 3, 128);
+    MpImage im{grey.data(), w, h, w * 3, MP_IMAGE_RGB888};
+    for (int i = 0; i < opts->prewarm_frames; ++i) {
+      MpFaceResult r{};
+      rt_face_detect(ctx, &im, 0, &r);
+      rt_face_free_result(&r);
+    }
+    // A blank frame has no face, so the landmark nets never ran: run them
+    // directly on a grey crop.
+    try {
+      const int lm_sz[4] = {1, fp::kLmSize, fp::kLmSize, 3};
+      cv::Mat crop(4, lm_sz, CV_32F, cv::Scalar(0.5));
+      std::vector<cv::Mat> outs;
+      for (int i = 0; i < opts->prewarm_frames; ++i) {
+        if (ctx->lm_mode != MpFaceCtx::LmMode::kInt8) {
+          ctx->lm_net.setInput(crop);
+          ctx->lm_net.forward(outs, ctx->lm_out_names);
+        }
+        if (ctx->lm_mode != MpFaceCtx::LmMode::kFloat) {
+          ctx->lm_net_q.setInput(crop);
+          ctx->lm_net_q.forward(outs, ctx->lm_q_out_names);
+        }
+      }
+    } catch (const cv::Exception& e) {
+      fprintf(stderr, "[mp_runtime_ocv] landmark prewarm failed: %s\n", e.what());
+    }
+    ctx->stats = MpRuntimeStats{};
+    ctx->lm_check.reset();
+    ctx->prev_ts_us = -1;
+    for (auto& f : ctx->roi_filters) f.reset();
+  }
+  // The nets' weights live in OpenCV's heap: lock the whole process
+  // (mlockall covers the heap and later allocations).
+  if (opts->lock_memory) {
+    const std::string err = mp_thread_policy::lock_all_memory();
+    if (!err.empty()) fprintf(stderr, "[mp_runtime_ocv] lock_memory ignored: %s\n", err.c_str());
+  }
+
+  *out = ctx;
+  return 0;
+}
+
+// Returns a view of the frame the two stages can sample from: packed
+// formats are used in place, 4:2:0 is converted (and area-downscaled when
+// detect_scale / detect_max_side ask for it) into ctx->rgb.
+static bool frame_view(MpFaceCtx* ctx, const MpImage* img, cv::Mat* view) {
+  const int W = img->width, H = img->height;
+  void* data = const_cast<uint8_t*>(img->data);
+  switch (img->format) {
+    case MP_IMAGE_RGBA8888: *view = cv::Mat(H, W, CV_8UC4, data, img->stride); return true;
+    case MP_IMAGE_RGB888:   *view = cv::Mat(H, W, CV_8UC3, data, img->stride); return true;
+    case MP_IMAGE_GRAY8:    *view = cv::Mat(H, W, CV_8UC1, data, img->stride); return true;
+    case MP_IMAGE_NV12:
+    case MP_IMAGE_I420: {
+      double s = (ctx->detect_scale > 0.f && ctx->detect_scale < 1.f) ? ctx->detect_scale : 1.0;
+      if (ctx->detect_max_side > 0 && std::max(W, H) * s > ctx->detect_max_side)
+        s = static_cast<double>(ctx->detect_max_side) / std::max(W, H);
+      s = std::max(s, 1.0 / mp_ingest::kMaxBox);
+      const int w = mp_ingest::scaled_size(W, s), h = mp_ingest::scaled_size(H, s);
+      ctx->rgb.create(h, w, CV_8UC3);
+      if (!mp_ingest::yuv420_to_rgb_area(*img, w, h, ctx->rgb.data, static_cast<int>(ctx->rgb.step)))
+        return false;
+      *view = ctx->rgb;
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+static void to_rgb(const cv::Mat& src, cv::Mat* dst) {
+  if (src.channels() == 4) cv::cvtColor(src, *dst, cv::COLOR_RGBA2RGB);
+  else if (src.channels() == 1) cv::cvtColor(src, *dst, cv::COLOR_GRAY2RGB);
+  else src.copyTo(*dst);
+}
+
+// Fills item i of blob with the letterboxed RGB frame, scaled by `scale`.
+static void letterbox_into(MpFaceCtx* lead, const cv::Mat& frame, float scale,
+                           cv::Mat& blob, int i) {
+  const int cw = std::max(1, (int)std::lround(frame.cols * scale));
+  const int ch = std::max(1, (int)std::lround(frame.rows * scale));
+  const int px = (fp::kDetSize - cw) / 2, py = (fp::kDetSize - ch) / 2;
+  cv::resize(frame, lead->small, cv::Size(cw, ch), 0, 0, cv::INTER_AREA);
+  lead->det_canvas.setTo(cv::Scalar::all(0));
+  to_rgb(lead->small, &lead->small);
+  lead->small.copyTo(lead->det_canvas(cv::Rect(px, py, cw, ch)));
+  cv::Mat dst = blob_item(blob, i);
+  lead->det_canvas.convertTo(dst, CV_32F, 1.0 / 255.0);
+}
+
+// Heap result in the same ownership model as the MediaPipe runtime
+// (malloc'd, freed by face_free_result).
+static int marshal(MpFaceCtx* ctx, const std::vector<const float*>& faces_xyz,
+                   MpFaceResult* out) {
+  MpRuntimeStats& st = ctx->stats;
+  const int F = static_cast<int>(faces_xyz.size());
+  if (F == 0) return 0;
+  auto* faces = static_cast<MpFace*>(std::calloc(F, sizeof(MpFace)));
+  if (!faces) return -2;
+  for (int fi = 0; fi < F; ++fi) {
+    auto* pts = static_cast<MpLandmark*>(std::malloc(sizeof(MpLandmark) * fp::kNumLandmarks));
+    if (!pts) {
+      for (int j = 0; j < fi; ++j) std::free(const_cast<MpLandmark*>(faces[j].landmarks));
+      std::free(faces);
+      return -2;
+    }
+    for (int i = 0; i < fp::kNumLandmarks; ++i) {
+      pts[i].x = faces_xyz[fi][i * 3 + 0];
+      pts[i].y = faces_xyz[fi][i * 3 + 1];
+      pts[i].z = faces_xyz[fi][i * 3 + 2];
+    }
+    faces[fi].landmarks = pts;
+    faces[fi].landmarks_count = fp::kNumLandmarks;
+    st.allocations += 1;
+    st.allocated_bytes += sizeof(MpLandmark) * fp::kNumLandmarks;
+  }
+  out->faces = faces;
+  out->faces_count = F;
+  st.frames_with_face += 1;
+  st.allocations += 1;
+  st.allocated_bytes += sizeof(MpFace) * F;
+  return 0;
+}
+
+// Runs n frames (one per context) through the two stages: one detector
+// forward over all frames, then one landmark forward over all face crops.
+// The detector net and scratch buffers come from ctxs[0]; tracking state
+// (ROI filters, timestamps, stats) and the int8 landmark validation stay
+// with each frame's own context. Every stream's
+// graph time is the latency of the whole batch. A frame that cannot be
+// ingested or marshalled fails alone; a network error fails every frame
+// that reached the networks.
+static int rt_face_detect_batch(MpFaceCtx* const* ctxs, const MpImage* imgs,
+                                const int64_t* ts_us, int32_t n, MpFaceResult* outs,
+                                int32_t* rcs) {
+  if (!ctxs || !imgs || !ts_us || !outs || n < 0) return -1;
+  std::vector<int32_t> own_rcs;
+  if (!rcs) {
+    own_rcs.resize(n);
+    rcs = own_rcs.data();
+  }
+  for (int32_t i = 0; i < n; ++i) {
+    outs[i].faces = nullptr;
+    outs[i].faces_count = 0;
+    outs[i].timestamp_us = (ts_us[i] < 0) ? 0 : ts_us[i];
+    rcs[i] = ctxs[i] ? 0 : -1;
+  }
+  for (int32_t i = 0; i < n; ++i)
+    if (!ctxs[i]) return -1;
+  if (n == 0) return 0;
+  follow_cpu_budget(ctxs[0]);  // the pool runs the whole batch
+
+  using Clock = std::chrono::steady_clock;
+  auto us_since = [](Clock::time_point t) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - t).count();
+  };
+  MpFaceCtx* lead = ctxs[0];
+  int rc = 0;
+
+  // ── Ingest ──
+  struct Job { int idx; cv::Mat frame; float dt; };
+  std::vector<Job> jobs;
+  jobs.reserve(n);
+  for (int32_t i = 0; i < n; ++i) {
+    MpFaceCtx* ctx = ctxs[i];
+    MpRuntimeStats& st = ctx->stats;
+    const auto t_ingest = Clock::now();
+    cv::Mat frame;
+    if (imgs[i].width <= 0 || imgs[i].height <= 0 || !frame_view(ctx, &imgs[i], &frame)) {
+      rcs[i] = -3;
+      if (rc == 0) rc = -3;
+      continue;
+    }
+    st.ingest_us_last = us_since(t_ingest);
+    st.ingest_us_total += st.ingest_us_last;
+    st.frames += 1;
+
+    // dt for the ROI filters from the stream clock; 30 fps when unknown.
+    float dt = 1.0f / 30.0f;
+    const int64_t ts = ts_us[i];
+    if (ctx->prev_ts_us >= 0 && ts > ctx->prev_ts_us && ts - ctx->prev_ts_us < 1000000)
+      dt = (ts - ctx->prev_ts_us) / 1e6f;
+    ctx->prev_ts_us = ts;
+    jobs.push_back({i, frame, dt});
+  }
+  if (jobs.empty()) return rc;
+  const int J = static_cast<int>(jobs.size());
+  auto fail_jobs = [&](int r) {
+    for (const Job& job : jobs) rcs[job.idx] = r;
+    return r;
+  };
+
+  struct Crop { int job; int slot; float m[6]; };
+  std::vector<Crop> crops;
+  // Each stream validates the int8 landmark model on its own faces and
+  // decides for itself. The batch runs the float and/or int8 net as its
+  // streams need, taken from the first context that still holds it.
+  using LmMode = MpFaceCtx::LmMode;
+  MpFaceCtx* f_net = nullptr;
+  MpFaceCtx* q_net = nullptr;
+  for (const Job& job : jobs) {
+    MpFaceCtx* ctx = ctxs[job.idx];
+    if (!f_net && ctx->lm_mode != LmMode::kInt8) f_net = ctx;
+    if (!q_net && ctx->lm_mode != LmMode::kFloat) q_net = ctx;
+  }
+  const auto t_graph = Clock::now();
+  try {
+    // ── Stage 1: letterboxed detector inputs, one forward ──
+    const int det_sz[4] = {J, fp::kDetSize, fp::kDetSize, 3};
+    lead->det_blob.create(4, det_sz, CV_32F);
+    for (int j = 0; j < J; ++j) {
+      const cv::Mat& f = jobs[j].frame;
+      const float scale = std::min((float)fp::kDetSize / f.cols, (float)fp::kDetSize / f.rows);
+      letterbox_into(lead, f, scale, lead->det_blob, j);
+    }
+    if (!forward_gather(lead->det_net, lead->det_out_names, lead->det_blob,
+                        {(size_t)fp::kNumAnchors * fp::kBoxValues, (size_t)fp::kNumAnchors},
+                        &lead->batch_ok, &lead->det_out)) {
+      set_last_error("unexpected detector outputs");
+      return fail_jobs(-4);
+    }
+
+    for (int j = 0; j < J; ++j) {
+      MpFaceCtx* ctx = ctxs[jobs[j].idx];
+      const cv::Mat& f = jobs[j].frame;
+      ctx->stats.detector_runs += 1;
+      auto dets = fp::decode_detections(
+          lead->det_out[0].data() + (size_t)j * fp::kNumAnchors * fp::kBoxValues,
+          lead->det_out[1].data() + (size_t)j * fp::kNumAnchors,
+          fp::anchors_128(), ctx->det_threshold, f.cols, f.rows);
+      const int nf = std::min<int>(static_cast<int>(dets.size()), ctx->num_faces);
+      for (int fi = nf; fi < ctx->num_faces; ++fi) ctx->roi_filters[fi].reset();
+      for (int fi = 0; fi < nf; ++fi) {
+        fp::FaceRoi roi = fp::roi_from_detection(dets[fi], f.cols, f.rows);
+        ctx->roi_filters[fi].smooth(&roi, jobs[j].dt);
+        Crop c{j, fi, {}};
+        fp::crop_affine(roi, c.m);
+        crops.push_back(c);
+      }
+    }
+
+    // ── Stage 2: aligned crops of every face, one forward ──
+    if (!crops.empty()) {
+      const int lm_sz[4] = {(int)crops.size(), fp::kLmSize, fp::kLmSize, 3};
+      lead->lm_blob.create(4, lm_sz, CV_32F);
+      for (size_t c = 0; c < crops.size(); ++c) {
+        const float* m = crops[c].m;
+        const cv::Mat M = (cv::Mat_<double>(2, 3) << m[0], m[1], m[2], m[3], m[4], m[5]);
+        cv::warpAffine(jobs[crops[c].job].frame, lead->lm_crop, M,
+                       cv::Size(fp::kLmSize, fp::kLmSize),
+                       cv::INTER_LINEAR | cv::WARP_INVERSE_MAP, cv::BORDER_CONSTANT);
+        to_rgb(lead->lm_crop, &lead->lm_rgb);
+        cv::Mat dst = blob_item(lead->lm_blob, (int)c);
+        lead->lm_rgb.convertTo(dst, CV_32F, 1.0 / 255.0);
+      }
+      if (q_net &&
+          !forward_gather(q_net->lm_net_q, q_net->lm_q_out_names, lead->lm_blob,
+                          {(size_t)fp::kNumLandmarks * 3}, &q_net->batch_q_ok, &lead->lm_q_out)) {
+        set_last_error("unexpected int8 landmark outputs");
+        return fail_jobs(-4);
+      }
+      if (f_net &&
+          !forward_gather(f_net->lm_net, f_net->lm_out_names, lead->lm_blob,
+                          {(size_t)fp::kNumLandmarks * 3}, &f_net->batch_ok, &lead->lm_out)) {
+        set_last_error("unexpected landmark outputs");
+        return fail_jobs(-4);
+      }
+    }
+  } catch (const cv::Exception& e) {
+    set_last_error(std::string("OpenCV DNN error: ") + e.what());
+    return fail_jobs(-4);
+  }
+  const double graph_us = us_since(t_graph);
+
+  // ── Back-project and marshal per stream ──
+  std::vector<float> xyz(crops.size() * fp::kNumLandmarks * 3);
+  std::vector<float> xyz_q(q_net && f_net ? fp::kNumLandmarks * 3 : 0);
+  size_t c = 0;
+  for (int j = 0; j < J; ++j) {
+    MpFaceCtx* ctx = ctxs[jobs[j].idx];
+    MpRuntimeStats& st = ctx->stats;
+    const bool validating = ctx->lm_mode == LmMode::kValidating;
+    const auto& lm_res = ctx->lm_mode == LmMode::kInt8 ? lead->lm_q_out : lead->lm_out;
+    st.graph_us_last = graph_us;
+    st.graph_us_total += graph_us;
+
+    const auto t_marshal = Clock::now();
+    std::vector<const float*> faces_xyz;
+    for (; c < crops.size() && crops[c].job == j; ++c) {
+      float* p = xyz.data() + c * fp::kNumLandmarks * 3;
+      st.tracker_runs += 1;
+      fp::backproject_landmarks(lm_res[0].data() + c * fp::kNumLandmarks * 3,
+                                crops[c].m, jobs[j].frame.cols, jobs[j].frame.rows, p);
+      if (!fp::landmarks_plausible(p)) {
+        ctx->roi_filters[crops[c].slot].reset();
+        continue;
+      }
+      faces_xyz.push_back(p);
+      if (validating) {
+        fp::backproject_landmarks(lead->lm_q_out[0].data() + c * fp::kNumLandmarks * 3,
+                                  crops[c].m, jobs[j].frame.cols, jobs[j].frame.rows,
+                                  xyz_q.data());
+        const MpImage& im = imgs[jobs[j].idx];
+        ctx->lm_check.add(p, xyz_q.data(), im.width, im.height);
+      }
+    }
+    const int r = marshal(ctx, faces_xyz, &outs[jobs[j].idx]);
+    rcs[jobs[j].idx] = r;
+    if (r != 0 && rc == 0) rc = r;
+    st.marshal_us_last = us_since(t_marshal);
+    st.marshal_us_total += st.marshal_us_last;
+  }
+
+  for (const Job& job : jobs) {
+    MpFaceCtx* ctx = ctxs[job.idx];
+    LmValidation& v = ctx->lm_check;
+    if (ctx->lm_mode != LmMode::kValidating || v.faces < v.target) continue;
+    const bool ok = v.mean() <= v.max_mean_px;
+    fprintf(stderr, "[mp_runtime_ocv] int8 landmark model %s: mean error %.3f px, RMSE %.3f px, "
+                    "max %.3f px over %d face(s) (limit %.3f px)\n",
+            ok ? "accepted" : "rejected", v.mean(), v.rmse(), v.max, v.faces, v.max_mean_px);
+    if (ok) {
+      ctx->lm_mode = LmMode::kInt8;
+      ctx->lm_net = cv::dnn::Net();
+    } else {
+      ctx->lm_mode = LmMode::kFloat;
+      ctx->lm_net_q = cv::dnn::Net();
+    }
+  }
+  return rc;
+}
+
+static int rt_face_detect(MpFaceCtx* ctx, const MpImage* img, int64_t ts_us,
+                          MpFaceResult* out) {
+  if (!ctx || !out) return -1;
+  if (!img) {
+    out->faces = nullptr;
+    out->faces_count = 0;
+    out->timestamp_us = (ts_us < 0) ? 0 : ts_us;
+    return -3;
+  }
+  return rt_face_detect_batch(&ctx, img, &ts_us, 1, out, nullptr);
+}
+
+static void rt_face_free_result(MpFaceResult* out) {
+  if (!out || !out->faces) return;
+  for (int i = 0; i < out->faces_count; ++i)
+    std::free(const_cast<MpLandmark*>(out->faces[i].landmarks));
+  std::free(const_cast<MpFace*>(out->faces));
+  out->faces = nullptr;
+  out->faces_count = 0;
+}
+
+static void rt_face_close(MpFaceCtx** pctx) {
+  if (pctx && *pctx) {
+    delete *pctx;
+    *pctx = nullptr;
+  }
+}
+
+static int rt_face_get_stats(MpFaceCtx* ctx, MpRuntimeStats* out) {
+  if (!ctx || !out) return -1;
+  *out = ctx->stats;
+  return 0;
+}
+
+static int rt_face_get_allocation(MpFaceCtx* ctx, MpCpuAllocation* out) {
+  if (!ctx || !out) return -1;
+  mp_cpu_budget::get(ctx->budget_id, ctx->requested_threads, out);
+  // Inference and the caller's OpenCV work share one process-wide pool,
+  // sized to a context's share (see follow_cpu_budget).
+  if (ctx->budget_id >= 0) out->warp_pool = out->inference_threads + out->warp_threads;
+  return 0;
+}
+
+// ---------- API table ----------
+static const MpRuntimeApi g_api = {
+    /*api_version=*/MP_RUNTIME_API_VERSION,
+    /*runtime_version=*/rt_version,
+    /*runtime_build=*/rt_build,
+    /*face_create=*/rt_face_create,
+    /*face_detect=*/rt_face_detect,
+    /*face_free_result=*/rt_face_free_result,
+    /*face_close=*/rt_face_close,
+    /*get_last_error=*/rt_get_last_error,
+    /*face_get_stats=*/rt_face_get_stats,
+    /*face_detect_batch=*/rt_face_detect_batch,
+    /*face_get_allocation=*/rt_face_get_allocation,
+};
+
+extern "C" const MpRuntimeApi* mp_runtime_get_api(void) { return &g_api; }
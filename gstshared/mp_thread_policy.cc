@@ -0,0 +1,96 @@
+// gstshared/mp_thread_policy.cc
+#include "mp_thread_policy.h"
+
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+namespace mp_thread_policy {
+
+namespace {
+
+void append(std::string* err, const std::string& msg) {
+  if (!err->empty()) *err += "; ";
+  *err += msg;
+}
+
+bool has_cpu_list(const char* cpu_list) { return cpu_list && *cpu_list; }
+
+}  // namespace
+
+bool parse_cpu_list(const char* spec, cpu_set_t* out) {
+  CPU_ZERO(out);
+  if (!spec) return false;
+  const char* p = spec;
+  bool any = false;
+  while (*p) {
+    char* end = nullptr;
+    errno = 0;
+    const long lo = std::strtol(p, &end, 10);
+    if (end == p || errno || lo < 0) return false;
+    long hi = lo;
+    p = end;
+    if (*p == '-') {
+      hi = std::strtol(++p, &end, 10);
+      if (end == p || errno || hi < lo) return false;
+      p = end;
+    }
+    if (hi >= CPU_SETSIZE) return false;
+    for (long c = lo; c <= hi; ++c) CPU_SET(static_cast<int>(c), out);
+    any = true;
+    if (*p == ',') ++p;
+    else if (*p) return false;
+  }
+  return any;
+}
+
+std::string apply(const char* cpu_list, int rt_priority) {
+  std::string err;
+  if (has_cpu_list(cpu_list)) {
+    cpu_set_t set;
+    if (!parse_cpu_list(cpu_list, &set)) {
+      append(&err, std::string("invalid cpu-set \"") + cpu_list + "\"");
+    } else if (const int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set)) {
+      append(&err, std::string("cannot pin to CPUs ") + cpu_list + ": " + std::strerror(rc) +
+                       (rc == EINVAL ? " (none of them is available to this process)" : ""));
+    }
+  }
+  if (rt_priority > 0) {
+    const int lo = sched_get_priority_min(SCHED_FIFO), hi = sched_get_priority_max(SCHED_FIFO);
+    sched_param sp{};
+    sp.sched_priority = rt_priority < lo ? lo : (rt_priority > hi ? hi : rt_priority);
+    if (const int rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp)) {
+      append(&err, "cannot switch to SCHED_FIFO priority " + std::to_string(sp.sched_priority) +
+                       ": " + std::strerror(rc) +
+                       (rc == EPERM ? " (needs CAP_SYS_NICE or a high enough RLIMIT_RTPRIO)" : ""));
+    }
+  }
+  return err;
+}
+
+Scope::Scope(const char* cpu_list, int rt_priority) {
+  active_ = has_cpu_list(cpu_list) || rt_priority > 0;
+  if (!active_) return;
+  saved_affinity_ =
+      pthread_getaffinity_np(pthread_self(), sizeof(affinity_), &affinity_) == 0;
+  saved_sched_ = pthread_getschedparam(pthread_self(), &policy_, &param_) == 0;
+  error_ = apply(cpu_list, rt_priority);
+}
+
+Scope::~Scope() {
+  if (!active_) return;
+  if (saved_sched_) pthread_setschedparam(pthread_self(), policy_, &param_);
+  if (saved_affinity_) pthread_setaffinity_np(pthread_self(), sizeof(affinity_), &affinity_);
+}
+
+std::string lock_all_memory() {
+  if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0) return "";
+  const int e = errno;
+  return std::string("cannot lock the process in memory: ") + std::strerror(e) +
+         ((e == EPERM || e == ENOMEM) ? " (needs CAP_IPC_LOCK or a larger RLIMIT_MEMLOCK)" : "");
+}
+
+}  // namespace mp_thread_policy
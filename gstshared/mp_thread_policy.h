@@ -0,0 +1,58 @@
+// gstshared/mp_thread_policy.h
+// CPU affinity, SCHED_FIFO priority and memory locking for the threads that
+// process frames (v8).
+//
+// Linux threads inherit the affinity mask and scheduling policy of the
+// thread that creates them, so a Scope around graph creation covers the
+// graph and XNNPACK workers, and one around a frame covers pools started
+// while it runs (OpenCV's). Threads the caller does not own, such as
+// GStreamer's pooled streaming threads, only ever get a Scope, so they go
+// back to the pool as they came. Nothing here is
+// fatal: every call reports what could not be applied (missing
+// CAP_SYS_NICE, RLIMIT_MEMLOCK, a CPU outside the cgroup...) and leaves the
+// thread as it was for that part.
+#pragma once
+
+#include <sched.h>
+
+#include <string>
+
+namespace mp_thread_policy {
+
+// Parses a CPU list in taskset -c / cpuset syntax ("2-5,8"). False on a
+// syntax error or a CPU beyond CPU_SETSIZE.
+bool parse_cpu_list(const char* spec, cpu_set_t* out);
+
+// Pins the calling thread to cpu_list (null or "" = leave as is) and, when
+// rt_priority is 1..99, switches it to SCHED_FIFO at that priority. Returns
+// "" on success, else one "; "-separated message per failed part.
+std::string apply(const char* cpu_list, int rt_priority);
+
+// apply() for the lifetime of the scope, then the calling thread's previous
+// affinity and policy are restored. Threads started inside the scope keep
+// the policy.
+class Scope {
+ public:
+  Scope(const char* cpu_list, int rt_priority);
+  ~Scope();
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+
+  const std::string& error() const { return error_; }
+
+ private:
+  bool active_ = false;
+  bool saved_affinity_ = false;
+  bool saved_sched_ = false;
+  cpu_set_t affinity_;
+  int policy_ = SCHED_OTHER;
+  sched_param param_{};
+  std::string error_;
+};
+
+// mlockall(MCL_CURRENT | MCL_FUTURE): every page of the process, including
+// XNNPACK's packed weights and the graph's buffers, stays resident, and so
+// do later allocations. Process-wide; "" on success.
+std::string lock_all_memory();
+
+}  // namespace mp_thread_policy